@@ -0,0 +1,62 @@
+// Cost of the local time of a tick: localtime_r() and the cached calendar for every minute of a year
+//
+//   benchCalendar [TZ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "reScheduler.cpp"
+
+#define BENCH_FROM        1704067200  // Mon Jan 01 2024 00:00:00 UTC
+#define BENCH_MINUTES     (366 * 1440)
+
+static int64_t benchNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void benchRun(const char* zone)
+{
+  setenv("TZ", zone, 1);
+  tzset();
+  schedulerCalendarReset();
+  volatile int sink = 0;
+  struct tm local;
+
+  int64_t start = benchNow();
+  for (uint32_t i = 0; i < BENCH_MINUTES; i++) {
+    time_t t = BENCH_FROM + (time_t)i * 60;
+    localtime_r(&t, &local);
+    sink += local.tm_min;
+  };
+  int64_t system = benchNow() - start;
+
+  start = benchNow();
+  for (uint32_t i = 0; i < BENCH_MINUTES; i++) {
+    schedulerCalendarLocal(BENCH_FROM + (time_t)i * 60, &local);
+    sink += local.tm_min;
+  };
+  int64_t calendar = benchNow() - start;
+
+  uint32_t anchors, tables;
+  schedulerCalendarStats(&anchors, &tables);
+  printf("%-40s %14.1f %14.1f %8u\n", zone, (double)system / BENCH_MINUTES, (double)calendar / BENCH_MINUTES, tables);
+}
+
+int main(int argc, char** argv)
+{
+  printf("%-40s %14s %14s %8s\n", "TZ", "localtime_r ns", "calendar ns", "tables");
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      benchRun(argv[i]);
+    };
+  } else {
+    benchRun("UTC0");
+    benchRun("CET-1CEST,M3.5.0,M10.5.0/3");
+    benchRun("EST5EDT,M3.2.0,M11.1.0");
+    benchRun("<+1030>-10:30<+11>-11,M10.1.0,M4.1.0");
+  };
+  return 0;
+}
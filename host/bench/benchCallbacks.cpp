@@ -0,0 +1,101 @@
+// Event loop traffic of one simulated day for timespans with one subscriber module each: broadcast of the transitions
+// to all modules (schedulerRegister()) against direct calls of the owners (schedulerRegisterCallback())
+//
+//   benchCallbacks [count...]
+//
+// The host event loop has room for about 50 modules, which is also the default count
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_START_TIME  1700006430  // Wed Nov 15 2023 00:00:30 UTC
+#define BENCH_COUNT_MAX   50
+
+static timespan_t _benchTimespans[BENCH_COUNT_MAX];
+static uint32_t _benchEvents = 0;       // RE_TIME_TIMESPAN_BATCH events
+static uint32_t _benchTransitions = 0;  // Transitions carried by them
+static uint32_t _benchCalls = 0;        // Calls of the handlers of the modules
+static uint32_t _benchUseful = 0;       // ...that found a transition of their own timespan
+static uint32_t _benchCallbacks = 0;
+
+static void benchCounter(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  _benchEvents++;
+  _benchTransitions += ((schedulerTransitions_t*)event_data)->count;
+}
+
+static void benchModule(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+  _benchCalls++;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    if (batch->items[i].value == (uint32_t)(uintptr_t)arg) {
+      _benchUseful++;
+    };
+  };
+}
+
+static void benchCallback(schedulerHandle_t handle, bool state, void* arg)
+{
+  _benchCallbacks++;
+}
+
+static void benchRun(uint32_t count, bool callbacks)
+{
+  _benchEvents = 0;
+  _benchTransitions = 0;
+  _benchCalls = 0;
+  _benchUseful = 0;
+  _benchCallbacks = 0;
+  schedulerPortStart(true);
+  schedulerPortSetTime(BENCH_START_TIME);
+  schedulerInit();
+  for (uint32_t i = 0; i < count; i++) {
+    if (callbacks) {
+      schedulerRegisterCallback(&_benchTimespans[i], benchCallback, (void*)(uintptr_t)i);
+    } else {
+      schedulerRegister(&_benchTimespans[i], i);
+    };
+    eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, benchModule, (void*)(uintptr_t)i);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, benchCounter, nullptr);
+  schedulerStart(false);
+  schedulerPortStatsReset();
+  schedulerPortAdvance(24 * 3600 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerPortStats_t port;
+  schedulerPortStats(&port);
+  printf("%8u %10s %8u %12u %12u %8u %10u %8u\n", count, callbacks ? "callbacks" : "broadcast", _benchEvents,
+    _benchTransitions + _benchCallbacks, _benchCalls, _benchUseful, _benchCallbacks, port.posts);
+  eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, benchCounter);
+  for (uint32_t i = 0; i < count; i++) {
+    eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, benchModule);
+  };
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main(int argc, char* argv[])
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < BENCH_COUNT_MAX; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _benchTimespans[i] = begin * 10000 + end;
+  };
+  printf("%8s %10s %8s %12s %12s %8s %10s %8s\n", "count", "mode", "events", "transitions", "handlers", "useful",
+    "callbacks", "posts");
+  for (int i = 1; i < argc || i == 1; i++) {
+    uint32_t count = argc > 1 ? strtoul(argv[i], nullptr, 10) : BENCH_COUNT_MAX;
+    if (count > BENCH_COUNT_MAX) count = BENCH_COUNT_MAX;
+    benchRun(count, false);
+    benchRun(count, true);
+  };
+  return 0;
+}
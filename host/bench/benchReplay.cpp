@@ -0,0 +1,94 @@
+// Throughput of the replay: simulated minute ticks per second for 10...10k timespans and a few crons
+//
+//   benchReplay [-d days] [count...]
+//
+// The timespans get random bounds (the same for every run); the range starts on Jan 01 2024 in CET, so a year covers
+// both changes of DST. The figures come from schedulerReplayStats_t
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_FROM        1704067200  // Mon Jan 01 2024 00:00:00 UTC
+#define BENCH_CRONS       3
+
+static const char* _benchExpressions[BENCH_CRONS] = { "30 2 * * *", "0 0 29 2 *", "*/20 9-17 * * 1-5" };
+static uint32_t _benchRecords = 0;
+
+static void benchReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  _benchRecords++;
+}
+
+static uint32_t benchRandom(uint32_t* seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7FFF;
+}
+
+static bool benchRun(uint32_t count, uint32_t days)
+{
+  timespan_t* spans = (timespan_t*)calloc(count, sizeof(timespan_t));
+  if (!spans) return false;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t begin = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    uint32_t end = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    spans[i] = begin * 10000 + end;
+  };
+  schedulerCron_t crons[BENCH_CRONS];
+
+  bool ret = schedulerPortStart(false) && schedulerInit();
+  for (uint32_t i = 0; ret && (i < count); i++) {
+    ret = schedulerRegister(&spans[i], i) != SCHEDULER_HANDLE_INVALID;
+  };
+  for (uint32_t i = 0; ret && (i < BENCH_CRONS); i++) {
+    ret = schedulerCronParse(_benchExpressions[i], &crons[i]) 
+       && (schedulerRegisterCron(&crons[i], count + i) != SCHEDULER_HANDLE_INVALID);
+  };
+  if (ret) {
+    _benchRecords = 0;
+    schedulerReplayStats_t stats;
+    ret = schedulerReplay(BENCH_FROM, BENCH_FROM + (time_t)days * 86400, benchReplayLog, nullptr, &stats);
+    if (ret) {
+      printf("%8u %10u %12u %12u %10.1f %12u %12.1f\n", count, stats.ticks, stats.events, stats.transitions, 
+        (double)stats.elapsed_us / 1000, stats.ticks_per_sec, stats.ticks ? (double)stats.elapsed_us * 1000 / stats.ticks : 0.0);
+    };
+  };
+  schedulerDelete();
+  schedulerPortStop();
+  free(spans);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t days = 366;
+  uint32_t counts[16];
+  uint32_t count = 0;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) {
+      days = strtoul(argv[++i], nullptr, 10);
+    } else if (count < sizeof(counts) / sizeof(counts[0])) {
+      counts[count++] = strtoul(argv[i], nullptr, 10);
+    };
+  };
+  if (count == 0) {
+    const uint32_t defaults[] = { 10, 100, 1000, 10000 };
+    for (uint32_t value : defaults) counts[count++] = value;
+  };
+  if (days == 0) days = 1;
+
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  printf("%8s %10s %12s %12s %10s %12s %12s\n", "items", "ticks", "records", "transitions", "ms", "ticks/s", "ns/tick");
+  for (uint32_t i = 0; i < count; i++) {
+    if (!benchRun(counts[i], days)) {
+      fprintf(stderr, "Failed to run the replay for %u items\n", counts[i]);
+      return 1;
+    };
+  };
+  return 0;
+}
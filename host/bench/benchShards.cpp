@@ -0,0 +1,114 @@
+// Split of the checks between shards: a rebuild tick and a tick where every item is due, for 512...60000 items
+// (75% timespans, 25% crons)
+//
+//   benchShards [count...]
+//
+// The replay runs the shards one after another, so their times are not disturbed by the other shards: the speedup 
+// is projected as (busy + merge) / (critical + merge). The live ticks run the helper tasks on the cores of this 
+// machine, their time is measured with the wall clock (the simulated clock stands still while a tick runs)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_FROM        1718438340  // Sat Jun 15 2024 07:59:00 UTC
+
+static timespan_t _benchTimespan = 8002000;  // 08:00 - 20:00
+static schedulerCron_t _benchCron;
+
+static void benchCallback(schedulerHandle_t handle, bool state, void* arg)
+{
+}
+
+static void benchReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+}
+
+static int64_t benchNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void benchReplay(uint32_t count)
+{
+  schedulerPortStart(false);
+  schedulerInit();
+  for (uint32_t i = 0; i < count; i++) {
+    if (i % 4 == 3) {
+      schedulerRegisterCron(&_benchCron, i);
+    } else {
+      schedulerRegister(&_benchTimespan, i);
+    };
+  };
+  // 07:59 is the rebuild, at 08:00 every item is due; the statistics are not reset by schedulerInit()
+  schedulerShardsStats_t before, stats;
+  schedulerShardsStats(&before);
+  schedulerReplayStats_t replay;
+  schedulerReplay(BENCH_FROM, BENCH_FROM + 120, benchReplayLog, nullptr, &replay);
+  schedulerShardsStats(&stats);
+  stats.runs -= before.runs;
+  stats.busy_us -= before.busy_us;
+  stats.critical_us -= before.critical_us;
+  stats.merge_us -= before.merge_us;
+  uint32_t parallel = stats.critical_us + stats.merge_us;
+  printf("%8u %8u %10u %10u %10u %10.2f %9.2f%%", count, stats.runs, stats.busy_us, stats.critical_us, stats.merge_us, 
+    parallel ? (double)(stats.busy_us + stats.merge_us) / parallel : 0.0, 
+    stats.busy_us ? (double)stats.merge_us * 100 / stats.busy_us : 0.0);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+static void benchLive(uint32_t count)
+{
+  schedulerPortStart(true);
+  schedulerPortSetTime(BENCH_FROM - 30);
+  schedulerInit();
+  for (uint32_t i = 0; i < count; i++) {
+    if (i % 4 == 3) {
+      schedulerRegisterCronCallback(&_benchCron, benchCallback, nullptr);
+    } else {
+      schedulerRegisterCallback(&_benchTimespan, benchCallback, nullptr);
+    };
+  };
+  schedulerStart(false);
+  int64_t start = benchNow();
+  schedulerPortAdvance(60000000);
+  int64_t rebuild = benchNow() - start;
+  start = benchNow();
+  schedulerPortAdvance(60000000);
+  int64_t due = benchNow() - start;
+  printf(" %12.0f %12.0f\n", (double)rebuild / 1000, (double)due / 1000);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main(int argc, char** argv)
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  schedulerCronParse("0 8 * * *", &_benchCron);
+  printf("%d shards, %ld CPUs online\n", CONFIG_SCHEDULER_SHARDS, sysconf(_SC_NPROCESSORS_ONLN));
+  printf("%8s %8s %10s %10s %10s %10s %10s %12s %12s\n", "items", "runs", "busy us", "critical", "merge", 
+    "speedup", "merge", "live rebuild", "live due");
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      uint32_t count = strtoul(argv[i], nullptr, 10);
+      if (count > 0) {
+        benchReplay(count);
+        benchLive(count);
+      };
+    };
+  } else {
+    const uint32_t counts[] = { 512, 2048, 8192, 32768, 60000 };
+    for (uint32_t count : counts) {
+      benchReplay(count);
+      benchLive(count);
+    };
+  };
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Full check of all timespans: a loop of checkTimespan() through the pointers of the items, packing followed by
+// schedulerSpanEvaluate(), and schedulerSpanEvaluate() alone; ns per item for one pass at every minute of a day
+//
+//   benchSpans [count...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "reScheduler.cpp"
+
+static uint32_t benchRandom(uint32_t* seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7FFF;
+}
+
+static int64_t benchNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void benchRun(uint32_t count)
+{
+  uint32_t seed = 1;
+  std::vector<timespan_t> timespans(count);
+  std::vector<timespan_t*> items(count);
+  std::vector<uint16_t> begin(count), end(count);
+  std::vector<uint32_t> bits(SCHEDULER_BITSET_WORDS(count));
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t on = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    uint32_t off = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    timespans[i] = on * 10000 + off;
+    items[i] = &timespans[i];
+  };
+  _schedulerSpanBegin = begin.data();
+  _schedulerSpanEnd = end.data();
+  volatile uint32_t sink = 0;
+
+  int64_t start = benchNow();
+  for (uint32_t minute = 0; minute < 1440; minute++) {
+    struct tm local = { 0 };
+    local.tm_hour = minute / 60;
+    local.tm_min = minute % 60;
+    uint32_t word = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (checkTimespan(&local, *items[i])) word |= 1U << (i % 32);
+      if ((i % 32 == 31) || (i == count - 1)) {
+        bits[i / 32] = word;
+        word = 0;
+      };
+    };
+    sink += bits[0];
+  };
+  int64_t loop = benchNow() - start;
+
+  start = benchNow();
+  for (uint32_t minute = 0; minute < 1440; minute++) {
+    for (uint32_t i = 0; i < count; i++) {
+      schedulerSpanPack(i, *items[i]);
+    };
+    schedulerSpanEvaluate(begin.data(), end.data(), count, (minute / 60) * 100 + minute % 60, bits.data());
+    sink += bits[0];
+  };
+  int64_t packed = benchNow() - start;
+
+  start = benchNow();
+  for (uint32_t minute = 0; minute < 1440; minute++) {
+    schedulerSpanEvaluate(begin.data(), end.data(), count, (minute / 60) * 100 + minute % 60, bits.data());
+    sink += bits[0];
+  };
+  int64_t evaluate = benchNow() - start;
+
+  _schedulerSpanBegin = nullptr;
+  _schedulerSpanEnd = nullptr;
+  double passes = 1440.0 * count;
+  printf("%8u %20.2f %20.2f %20.2f\n", count, loop / passes, packed / passes, evaluate / passes);
+}
+
+int main(int argc, char** argv)
+{
+  printf("%8s %20s %20s %20s\n", "items", "checkTimespan ns", "pack+evaluate ns", "evaluate ns");
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      uint32_t count = strtoul(argv[i], nullptr, 10);
+      if (count > 0) benchRun(count);
+    };
+  } else {
+    benchRun(1000);
+    benchRun(10000);
+    benchRun(100000);
+  };
+  return 0;
+}
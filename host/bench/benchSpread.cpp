@@ -0,0 +1,96 @@
+// Fleet of devices with the same schedules: every device has 50 timespans that begin at 08:00 and 2 immediate ones.
+// Events of the whole fleet per second after 08:00, first with all items immediate (as without the load smoothing),
+// then with the delays of the devices (consecutive identifiers); a batch counts as its transitions
+//
+//   benchSpread [devices...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_BOOT_TIME   1700035170  // Wed Nov 15 2023 07:59:30 UTC
+#define BENCH_EDGE_TIME   1700035200  // 08:00:00
+#define BENCH_ITEMS       50
+#define BENCH_IMMEDIATE   2
+#define BENCH_SECONDS     60
+
+static timespan_t _benchTimespan = 8000900;
+static uint32_t _benchPerSecond[BENCH_SECONDS];
+static uint32_t _benchStalls = 0;
+static uint32_t _benchOverflows = 0;
+
+static void benchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  struct timeval now;
+  schedPortWallTime(&now);
+  if ((now.tv_sec < BENCH_EDGE_TIME) || (now.tv_sec >= BENCH_EDGE_TIME + BENCH_SECONDS)) return;
+  if (event_id == RE_TIME_TIMESPAN_BATCH) {
+    _benchPerSecond[now.tv_sec - BENCH_EDGE_TIME] += ((schedulerTransitions_t*)event_data)->count;
+  } else {
+    _benchPerSecond[now.tv_sec - BENCH_EDGE_TIME]++;
+  };
+}
+
+static void benchDevice(uint32_t device, bool immediate)
+{
+  schedulerPortSetDeviceId(device);
+  schedulerPortStart(true);
+  schedulerPortSetTime(BENCH_BOOT_TIME);
+  schedulerStart(false);
+  for (uint32_t i = 0; i < BENCH_ITEMS + BENCH_IMMEDIATE; i++) {
+    schedulerHandle_t handle = schedulerRegister(&_benchTimespan, i);
+    if (immediate || (i >= BENCH_ITEMS)) {
+      schedulerSetFlags(handle, SCHEDULER_FLAG_IMMEDIATE);
+    };
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchHandler, nullptr);
+  schedulerPortAdvance((30 + BENCH_SECONDS) * 1000000LL);
+  schedulerSpreadStats_t stats;
+  schedulerSpreadStats(&stats);
+  _benchStalls += stats.stalls;
+  _benchOverflows += stats.overflows;
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+static void benchFleet(uint32_t devices, bool immediate)
+{
+  memset(_benchPerSecond, 0, sizeof(_benchPerSecond));
+  _benchStalls = 0;
+  _benchOverflows = 0;
+  for (uint32_t d = 0; d < devices; d++) {
+    benchDevice(d + 1, immediate);
+  };
+  uint32_t total = 0, peak = 0, busy = 0, last = 0;
+  for (uint32_t s = 0; s < BENCH_SECONDS; s++) {
+    total += _benchPerSecond[s];
+    if (_benchPerSecond[s] > peak) peak = _benchPerSecond[s];
+    if (_benchPerSecond[s] > 0) {
+      busy++;
+      last = s;
+    };
+  };
+  uint32_t after = 0;
+  for (uint32_t s = 1; s < BENCH_SECONDS; s++) {
+    if (_benchPerSecond[s] > after) after = _benchPerSecond[s];
+  };
+  printf("%8u %10s %8u %10u %10u %8u %8u %8u %10u\n", devices, immediate ? "immediate" : "spread", total,
+    _benchPerSecond[0], after, peak, busy, last, _benchStalls + _benchOverflows);
+}
+
+int main(int argc, char* argv[])
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  printf("%8s %10s %8s %10s %10s %8s %8s %8s %10s\n", "devices", "mode", "events", "second 0", "max after", "peak/s",
+    "seconds", "last", "stalls");
+  for (int i = 1; i < argc || i == 1; i++) {
+    uint32_t devices = argc > 1 ? strtoul(argv[i], nullptr, 10) : 200;
+    benchFleet(devices, true);
+    benchFleet(devices, false);
+  };
+  return 0;
+}
@@ -0,0 +1,180 @@
+// Registration of 100 schedules as a static table and at runtime: allocations, heap, the first tick and the wakeups
+// of the tickless timer over a day
+//
+//   benchTables
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <malloc.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_START_TIME  1700035170  // Wed Nov 15 2023 07:59:30 UTC
+
+SCHEDULER_TABLE(benchTable,
+  { 30, 101 },
+  { 2170340, 102 },
+  { 4340650, 103 },
+  { 6511000, 104 },
+  { 9081310, 105 },
+  { 11251620, 106 },
+  { 13421930, 107 },
+  { 15592240, 108 },
+  { 18160150, 109 },
+  { 20330500, 110 },
+  { 22500810, 111 },
+  { 1071120, 112 },
+  { 3240430, 113 },
+  { 5410740, 114 },
+  { 7581050, 115 },
+  { 10151400, 116 },
+  { 12321710, 117 },
+  { 14492020, 118 },
+  { 17062330, 119 },
+  { 19230240, 120 },
+  { 21400550, 121 },
+  { 23570900, 122 },
+  { 2141210, 123 },
+  { 4310520, 124 },
+  { 6480830, 125 },
+  { 9051140, 126 },
+  { 11221450, 127 },
+  { 13391800, 128 },
+  { 15562110, 129 },
+  { 18130020, 130 },
+  { 20300330, 131 },
+  { 22470640, 132 },
+  { 1040950, 133 },
+  { 3211300, 134 },
+  { 5380610, 135 },
+  { 7550920, 136 },
+  { 10121230, 137 },
+  { 12291540, 138 },
+  { 14461850, 139 },
+  { 17032200, 140 },
+  { 19200110, 141 },
+  { 21370420, 142 },
+  { 23540730, 143 },
+  { 2111040, 144 },
+  { 4281350, 145 },
+  { 6451700, 146 },
+  { 9021010, 147 },
+  { 11191320, 148 },
+  { 13361630, 149 },
+  { 15531940, 150 },
+  { 18102250, 151 },
+  { 20270200, 152 },
+  { 22440510, 153 },
+  { 1010820, 154 },
+  { 3181130, 155 },
+  { 5351440, 156 },
+  { 7521750, 157 },
+  { 10091100, 158 },
+  { 12261410, 159 },
+  { 14431720, 160 },
+  { 17002030, 161 },
+  { 19172340, 162 },
+  { 21340250, 163 },
+  { 23510600, 164 },
+  { 2080910, 165 },
+  { 4251220, 166 },
+  { 6421530, 167 },
+  { 8591840, 168 },
+  { 11161150, 169 },
+  { 13331500, 170 },
+  { 15501810, 171 },
+  { 18072120, 172 },
+  { 20240030, 173 },
+  { 22410340, 174 },
+  { 580650, 175 },
+  { 3151000, 176 },
+  { 5321310, 177 },
+  { 7491620, 178 },
+  { 10061930, 179 },
+  { 12232240, 180 },
+  { 14401550, 181 },
+  { 16571900, 182 },
+  { 19142210, 183 },
+  { 21310120, 184 },
+  { 23480430, 185 },
+  { 2050740, 186 },
+  { 4221050, 187 },
+  { 6391400, 188 },
+  { 8561710, 189 },
+  { 11132020, 190 },
+  { 13302330, 191 },
+  { 15471640, 192 },
+  { 18041950, 193 },
+  { 20212300, 194 },
+  { 22380210, 195 },
+  { 550520, 196 },
+  { 3120830, 197 },
+  { 5291140, 198 },
+  { 7461450, 199 },
+  { 10031800, 200 }
+);
+
+static timespan_t _benchRuntime[sizeof(benchTableItems) / sizeof(benchTableItems[0])];
+
+static int64_t benchNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void benchRun(bool table)
+{
+  schedulerPortStart(true);
+  schedulerPortSetTime(BENCH_START_TIME);
+  schedulerInit();
+  schedulerPortStatsReset();
+  size_t heap = mallinfo2().uordblks;
+  int64_t start = benchNow();
+  if (table) {
+    schedulerTableRegister(&benchTable);
+  } else {
+    for (uint32_t i = 0; i < benchTable.count; i++) {
+      _benchRuntime[i] = benchTableItems[i].timespan;
+      schedulerRegister(&_benchRuntime[i], benchTableItems[i].value);
+    };
+  };
+  int64_t registered = benchNow() - start;
+  heap = mallinfo2().uordblks - heap;
+  schedulerPortStats_t stats;
+  schedulerPortStats(&stats);
+  uint32_t allocs = stats.allocs;
+
+  // The simulated monotonic clock stands still while the tick runs, so the first tick is timed here
+  schedulerStart(false);
+  start = benchNow();
+  schedulerPortAdvance(30000000);
+  schedulerPortDispatch();
+  int64_t first = benchNow() - start;
+  schedulerMemoryStats_t memory;
+  schedulerMemoryStats(&memory);
+
+  uint32_t wakeups0, skipped0, wakeups1, skipped1;
+  schedulerTicklessStats(&wakeups0, &skipped0);
+  for (uint32_t i = 0; i < 1440; i++) {
+    schedulerPortAdvance(60000000);
+    schedulerPortDispatch();
+  };
+  schedulerTicklessStats(&wakeups1, &skipped1);
+  printf("%-8s %10.1f %8u %10zu %10.1f %10u %10u\n", table ? "table" : "runtime", (double)registered / 1000, allocs, heap, 
+    (double)first / 1000, memory.count, wakeups1 - wakeups0);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  printf("%u schedules, table: %u bytes of constant data\n", benchTable.count, (uint32_t)(sizeof(benchTableData) + sizeof(benchTable)));
+  printf("%-8s %10s %8s %10s %10s %10s %10s\n", "", "us", "allocs", "heap", "us first", "pool", "wakeups");
+  benchRun(false);
+  benchRun(true);
+  return 0;
+}
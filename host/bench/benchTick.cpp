@@ -0,0 +1,120 @@
+// Per-tick cost of the scheduler for 10...100k registered timespans
+//
+//   benchTick [-m minutes] [count...]
+//
+// For every count the timespans are registered with random bounds (the same for every run), then the simulated clock 
+// is moved forward minute by minute. The time is measured around every schedulerPortAdvance(), so one tick includes 
+// schedulerTimerMainExec() and the dispatch of the events it has posted. Allocations and posts come from schedulerPortStats()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_START_TIME  1700000000  // Tue Nov 14 2023 22:13:20 UTC
+
+static uint32_t _benchEvents = 0;
+
+static void benchEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  _benchEvents++;
+}
+
+static uint32_t benchRandom(uint32_t* seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7FFF;
+}
+
+static int64_t benchNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool benchRun(uint32_t count, uint32_t minutes)
+{
+  timespan_t* spans = (timespan_t*)calloc(count, sizeof(timespan_t));
+  if (!spans) return false;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t begin = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    uint32_t end = (benchRandom(&seed) % 24) * 100 + benchRandom(&seed) % 60;
+    spans[i] = begin * 10000 + end;
+  };
+
+  _benchEvents = 0;
+  if (!schedulerPortStart(true)) return false;
+  schedulerPortSetTime(BENCH_START_TIME);
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchEventHandler, nullptr);
+  bool ret = schedulerInit();
+  for (uint32_t i = 0; ret && (i < count); i++) {
+    ret = schedulerRegister(&spans[i], i) != 0;
+  };
+  ret = ret && schedulerStart(false);
+  if (ret) {
+    // The first tick evaluates every item, it is reported separately
+    schedulerPortStatsReset();
+    int64_t start = benchNow();
+    schedulerPortAdvance(60000000);
+    int64_t first = benchNow() - start;
+    schedulerPortStats_t stats;
+    schedulerPortStats(&stats);
+    uint32_t firstAllocs = stats.allocs;
+
+    schedulerPortStatsReset();
+    _benchEvents = 0;
+    int64_t total = 0;
+    int64_t worst = 0;
+    for (uint32_t i = 0; i < minutes; i++) {
+      start = benchNow();
+      schedulerPortAdvance(60000000);
+      int64_t tick = benchNow() - start;
+      total += tick;
+      if (tick > worst) worst = tick;
+    };
+    schedulerPortStats(&stats);
+    printf("%8u %8u %12.0f %12.0f %12.0f %12.3f %12.3f %12.3f %12u\n", 
+      count, minutes, (double)total / minutes, (double)worst, (double)first,
+      (double)stats.allocs / minutes, (double)stats.posts / minutes, (double)_benchEvents / minutes, firstAllocs);
+  };
+  schedulerDelete();
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchEventHandler);
+  schedulerPortStop();
+  free(spans);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t minutes = 1440;
+  uint32_t counts[16];
+  uint32_t count = 0;
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc)) {
+      minutes = strtoul(argv[++i], nullptr, 10);
+    } else if (count < sizeof(counts) / sizeof(counts[0])) {
+      counts[count++] = strtoul(argv[i], nullptr, 10);
+    };
+  };
+  if (count == 0) {
+    const uint32_t defaults[] = { 10, 100, 1000, 10000, 100000 };
+    for (uint32_t value : defaults) counts[count++] = value;
+  };
+  if (minutes == 0) minutes = 1;
+
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  printf("%8s %8s %12s %12s %12s %12s %12s %12s %12s\n", "items", "ticks", "ns/tick", "ns worst", "ns first", 
+    "allocs/tick", "posts/tick", "events/tick", "first allocs");
+  for (uint32_t i = 0; i < count; i++) {
+    if (!benchRun(counts[i], minutes)) {
+      fprintf(stderr, "Failed to run the benchmark for %u items\n", counts[i]);
+      return 1;
+    };
+  };
+  return 0;
+}
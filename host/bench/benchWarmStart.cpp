@@ -0,0 +1,110 @@
+// Events posted by the first tick after a boot: a cold boot and warm boots 0, 7, 95 and 600 minutes after the last 
+// snapshot, for 1000 and 5000 timespans; also the snapshots written during an hour of running
+//
+//   benchWarmStart [count...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define BENCH_START_TIME  1700000010  // Tue Nov 14 2023 22:13:30 UTC
+
+static const uint32_t _benchGaps[] = { 0, 7, 95, 600 };
+static timespan_t* _benchTimespans = nullptr;
+static uint32_t _benchCount = 0;
+static uint32_t _benchPosted = 0;
+
+static void benchBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id == RE_TIME_TIMESPAN_BATCH) {
+    _benchPosted += ((schedulerTransitions_t*)event_data)->count;
+  };
+}
+
+static uint32_t benchBoot(time_t time)
+{
+  schedulerPortStart(true);
+  schedulerPortSetTime(time);
+  schedulerInit();
+  for (uint32_t i = 0; i < _benchCount; i++) {
+    schedulerRegister(&_benchTimespans[i], i);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchBatchHandler, nullptr);
+  _benchPosted = 0;
+  schedulerStart(false);
+  schedulerPortAdvance(1000000);
+  schedulerPortDispatch();
+  return _benchPosted;
+}
+
+static void benchShutdown()
+{
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, benchBatchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+static void benchRun(uint32_t count)
+{
+  _benchCount = count;
+  _benchTimespans = (timespan_t*)calloc(count, sizeof(timespan_t));
+  if (!_benchTimespans) return;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < count; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _benchTimespans[i] = begin * 10000 + end;
+  };
+  schedulerPortStoreClear();
+
+  printf("%8u %8u", count, benchBoot(BENCH_START_TIME));
+  schedulerPortAdvance(20 * 60 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerWarmStartSave();
+  struct timeval now;
+  schedPortWallTime(&now);
+  time_t saved = now.tv_sec - now.tv_sec % 60;
+  benchShutdown();
+
+  for (uint32_t gap : _benchGaps) {
+    printf(" %8u", benchBoot(saved + gap * 60 + 10));
+    benchShutdown();
+  };
+
+  benchBoot(saved + 10);
+  schedulerPortStatsReset();
+  schedulerPortAdvance(3600 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerPortStats_t stats;
+  schedulerPortStats(&stats);
+  printf(" %10u\n", stats.store_writes);
+  benchShutdown();
+
+  schedulerPortStoreClear();
+  free(_benchTimespans);
+  _benchTimespans = nullptr;
+}
+
+int main(int argc, char** argv)
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  printf("%8s %8s", "items", "cold");
+  for (uint32_t gap : _benchGaps) {
+    printf(" %6um", gap);
+  };
+  printf(" %10s\n", "writes/h");
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      uint32_t count = strtoul(argv[i], nullptr, 10);
+      if (count > 0) benchRun(count);
+    };
+  } else {
+    benchRun(1000);
+    benchRun(5000);
+  };
+  return 0;
+}
@@ -0,0 +1,5 @@
+// Host stand-in for def_consts.h of the project
+#ifndef __DEF_CONSTS_H__
+#define __DEF_CONSTS_H__
+
+#endif // __DEF_CONSTS_H__
@@ -0,0 +1,45 @@
+// Host stand-in for project_config.h: MQTT and silent mode are off, every value can be overridden by the target
+#ifndef __PROJECT_CONFIG_H__
+#define __PROJECT_CONFIG_H__
+
+#ifndef CONFIG_FORMAT_FIRST_DAY_OF_WEEK
+#define CONFIG_FORMAT_FIRST_DAY_OF_WEEK 1
+#endif // CONFIG_FORMAT_FIRST_DAY_OF_WEEK
+
+#ifndef CONFIG_MQTT_PARAMS_QOS
+#define CONFIG_MQTT_PARAMS_QOS 1
+#endif // CONFIG_MQTT_PARAMS_QOS
+#ifndef CONFIG_MQTT_STATUS_ONLINE
+#define CONFIG_MQTT_STATUS_ONLINE 0
+#endif // CONFIG_MQTT_STATUS_ONLINE
+#ifndef CONFIG_MQTT_SYSINFO_ENABLE
+#define CONFIG_MQTT_SYSINFO_ENABLE 0
+#endif // CONFIG_MQTT_SYSINFO_ENABLE
+#ifndef CONFIG_MQTT_SYSINFO_INTERVAL
+#define CONFIG_MQTT_SYSINFO_INTERVAL 60000
+#endif // CONFIG_MQTT_SYSINFO_INTERVAL
+#ifndef CONFIG_MQTT_TASKLIST_ENABLE
+#define CONFIG_MQTT_TASKLIST_ENABLE 0
+#endif // CONFIG_MQTT_TASKLIST_ENABLE
+#ifndef CONFIG_MQTT_TASKLIST_INTERVAL
+#define CONFIG_MQTT_TASKLIST_INTERVAL 60000
+#endif // CONFIG_MQTT_TASKLIST_INTERVAL
+#ifndef CONFIG_MQTT_TIME_ENABLE
+#define CONFIG_MQTT_TIME_ENABLE 0
+#endif // CONFIG_MQTT_TIME_ENABLE
+
+#ifndef CONFIG_SILENT_MODE_ENABLE
+#define CONFIG_SILENT_MODE_ENABLE 0
+#endif // CONFIG_SILENT_MODE_ENABLE
+#define CONFIG_SILENT_MODE_INTERVAL 22000600
+#define CONFIG_SILENT_MODE_TOPIC "silent_mode"
+#define CONFIG_SILENT_MODE_FRIENDLY "Silent mode"
+#define CONFIG_SILENT_MODE_PGROUP_KEY "silent_mode"
+#define CONFIG_SILENT_MODE_PGROUP_TOPIC "silent_mode"
+#define CONFIG_SILENT_MODE_PGROUP_FRIENDLY "Silent mode"
+#define CONFIG_SILENT_MODE_ENABLE_TOPIC "enabled"
+#define CONFIG_SILENT_MODE_ENABLE_FRIENDLY "Enabled"
+#define CONFIG_SILENT_MODE_TIMESPAN_TOPIC "timespan"
+#define CONFIG_SILENT_MODE_TIMESPAN_FRIENDLY "Timespan"
+
+#endif // __PROJECT_CONFIG_H__
@@ -0,0 +1,13 @@
+// Host stand-in for rLog (https://github.com/kotyara12/rLog): errors and warnings go to stderr, the rest is dropped
+#ifndef __RLOG_H__
+#define __RLOG_H__
+
+#include <stdio.h>
+
+#define rlog_e(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define rlog_w(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define rlog_i(tag, fmt, ...)
+#define rlog_d(tag, fmt, ...)
+#define rlog_v(tag, fmt, ...)
+
+#endif // __RLOG_H__
@@ -0,0 +1,37 @@
+// Host stand-in for rTypes (https://github.com/kotyara12/rTypes): only what the scheduler uses
+#ifndef __RTYPES_H__
+#define __RTYPES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+typedef uint32_t timespan_t;
+
+typedef enum {
+  OPT_KIND_PARAMETER = 0,
+  OPT_KIND_OTHER
+} param_kind_t;
+
+typedef enum {
+  OPT_TYPE_U8 = 0,
+  OPT_TYPE_I16,
+  OPT_TYPE_U16,
+  OPT_TYPE_I32,
+  OPT_TYPE_U32,
+  OPT_TYPE_FLOAT,
+  OPT_TYPE_TIMESPAN,
+  OPT_TYPE_STRING
+} param_type_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool checkTimespan(struct tm* timeinfo, timespan_t timespan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RTYPES_H__
@@ -0,0 +1,18 @@
+// Host implementation of checkTimespan() with the same semantics as rTypes: the timespan is HHMMHHMM, 
+// the end is not included and a span whose end is earlier than its beginning passes through midnight
+#include "rTypes.h"
+
+bool checkTimespan(struct tm* timeinfo, timespan_t timespan)
+{
+  if (timespan > 0) {
+    int t0 = timeinfo->tm_hour * 100 + timeinfo->tm_min;
+    int t1 = timespan / 10000;
+    int t2 = timespan % 10000;
+    if (t1 < t2) {
+      return (t0 >= t1) && (t0 < t2);
+    } else {
+      return (t0 >= t1) || (t0 < t2);
+    };
+  };
+  return false;
+}
@@ -0,0 +1,98 @@
+// Boundary events replayed after a stall: only the boundaries with subscribers are posted, once each with the value
+// of the latest missed one, and they are counted like the events of a tick
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700087370  // Wed Nov 15 2023 22:29:30 UTC
+#define TEST_MINUTE       60000000LL
+
+typedef struct {
+  int32_t id;
+  int value;
+} testEvent_t;
+
+static std::vector<testEvent_t> _testEvents;
+
+static void testHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if ((event_id == RE_TIME_EVERY_MINUTE) || ((event_id >= RE_TIME_START_OF_HOUR) && (event_id <= RE_TIME_START_OF_YEAR)) 
+   || ((event_id > RE_TIME_EVERY_MINUTES(1)) && (event_id <= RE_TIME_EVERY_MINUTES(30)))) {
+    _testEvents.push_back({ event_id, event_data ? *(int*)event_data : -1 });
+  };
+}
+
+static const testEvent_t* testFind(int32_t id)
+{
+  for (const testEvent_t& event : _testEvents) {
+    if (event.id == id) return &event;
+  };
+  return nullptr;
+}
+
+static uint32_t testCount(int32_t id)
+{
+  uint32_t count = 0;
+  for (const testEvent_t& event : _testEvents) {
+    if (event.id == id) count++;
+  };
+  return count;
+}
+
+// A tick at 22:30, then the clock is stepped by 3 hours and the next tick comes at 01:31 of the next day
+static void testStall(schedulerBoundaryStats_t* before, schedulerBoundaryStats_t* after)
+{
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerStart(false));
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testHandler, nullptr);
+  schedulerPortAdvance(30000000);
+  schedulerPortDispatch();
+  _testEvents.clear();
+  schedulerBoundaryStats(before);
+  schedulerPortSetTime(TEST_START_TIME + 30 + 3 * 3600);
+  schedulerPortAdvance(TEST_MINUTE);
+  schedulerPortDispatch();
+  schedulerBoundaryStats(after);
+  schedulerTimingStats_t timing;
+  schedulerTimingStats(&timing);
+  TEST_CHECK(timing.missed >= 179);
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testHandler);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  schedulerBoundaryStats_t before, after;
+
+  // No subscribers: nothing is posted, the hour and the day are counted as saved
+  testStall(&before, &after);
+  TEST_CHECK(_testEvents.empty());
+  TEST_CHECK(after.posted == before.posted);
+  TEST_CHECK(after.saved - before.saved >= 2);
+
+  // The hour and 15 minutes: one replayed event each, for 01:00 and 01:30
+  TEST_CHECK(schedulerBoundarySubscribe(SCHEDULER_BOUNDARY_HOUR));
+  TEST_CHECK(schedulerBoundarySubscribe(15));
+  testStall(&before, &after);
+  TEST_CHECK(testCount(RE_TIME_START_OF_HOUR) == 1);
+  TEST_CHECK(testCount(RE_TIME_START_OF_DAY) == 0);
+  TEST_CHECK(testCount(RE_TIME_EVERY_MINUTE) == 0);
+  TEST_CHECK(testCount(RE_TIME_EVERY_MINUTES(15)) == 1);
+  const testEvent_t* hour = testFind(RE_TIME_START_OF_HOUR);
+  TEST_CHECK(hour && (hour->value == 1));
+  const testEvent_t* quarter = testFind(RE_TIME_EVERY_MINUTES(15));
+  TEST_CHECK(quarter && (quarter->value == 30));
+  TEST_CHECK(_testEvents.size() == 2);
+  TEST_CHECK(after.posted - before.posted == _testEvents.size());
+  schedulerBoundaryUnsubscribe(SCHEDULER_BOUNDARY_HOUR);
+  schedulerBoundaryUnsubscribe(15);
+  return TEST_RESULT();
+}
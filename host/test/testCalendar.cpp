@@ -0,0 +1,71 @@
+// Cached calendar: schedulerCalendarLocal() gives the same local time as localtime_r() for every minute and for random
+// seconds of a leap year, and for random times of 1970...2038 (each of them rebuilds the table), in zones with and 
+// without DST (also south of the equator and with a half-hour offset)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.cpp"
+#include "testCheck.h"
+
+#define TEST_FROM         (1704067200 - 20 * 3600)  // Sun Dec 31 2023 04:00:00 UTC
+#define TEST_MINUTES      (367 * 1440)
+#define TEST_RANDOM       200000
+#define TEST_RANDOM_FAR   2000
+
+static const char* _testZones[] = {
+  "UTC0",
+  "CET-1CEST,M3.5.0,M10.5.0/3",
+  "EST5EDT,M3.2.0,M11.1.0",
+  "MSK-3",
+  "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+  "NZST-12NZDT,M9.5.0,M4.1.0/3",
+  "GMT0BST,M3.5.0/1,M10.5.0",
+  "<-03>3",
+};
+
+static bool testSame(const struct tm* a, const struct tm* b)
+{
+  return (a->tm_sec == b->tm_sec) && (a->tm_min == b->tm_min) && (a->tm_hour == b->tm_hour) 
+      && (a->tm_mday == b->tm_mday) && (a->tm_mon == b->tm_mon) && (a->tm_year == b->tm_year) 
+      && (a->tm_wday == b->tm_wday) && (a->tm_yday == b->tm_yday) && (a->tm_isdst == b->tm_isdst);
+}
+
+static uint32_t testCompare(time_t t)
+{
+  struct tm expected, local;
+  localtime_r(&t, &expected);
+  schedulerCalendarLocal(t, &local);
+  if (testSame(&expected, &local)) return 0;
+  fprintf(stderr, "TZ=%s, %lld: %04d-%02d-%02d %02d:%02d dst %d instead of %04d-%02d-%02d %02d:%02d dst %d\n", 
+    getenv("TZ"), (long long)t, 
+    local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_isdst, 
+    expected.tm_year + 1900, expected.tm_mon + 1, expected.tm_mday, expected.tm_hour, expected.tm_min, expected.tm_isdst);
+  return 1;
+}
+
+int main()
+{
+  for (const char* zone : _testZones) {
+    setenv("TZ", zone, 1);
+    tzset();
+    schedulerCalendarReset();
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; (i < TEST_MINUTES) && (mismatches < 3); i++) {
+      mismatches += testCompare(TEST_FROM + (time_t)i * 60);
+    };
+    uint32_t seed = 1;
+    for (uint32_t i = 0; (i < TEST_RANDOM) && (mismatches < 3); i++) {
+      seed = seed * 1103515245 + 12345;
+      mismatches += testCompare(TEST_FROM + (time_t)((seed >> 1) % (TEST_MINUTES * 60)));
+    };
+    for (uint32_t i = 0; (i < TEST_RANDOM_FAR) && (mismatches < 3); i++) {
+      seed = seed * 1103515245 + 12345;
+      mismatches += testCompare((time_t)(seed & 0x7FFFFFFF));
+    };
+    TEST_CHECK(mismatches == 0);
+    uint32_t anchors, tables;
+    schedulerCalendarStats(&anchors, &tables);
+    TEST_CHECK(tables > 0);
+  };
+  return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+// Direct dispatch: over one simulated day the callbacks get the same transitions at the same ticks as the broadcast
+// events, and no RE_TIME_TIMESPAN_* event is posted for the items registered with a callback
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700006430  // Wed Nov 15 2023 00:00:30 UTC
+#define TEST_ITEMS        50
+
+typedef struct {
+  time_t time;
+  uint32_t index;
+  bool state;
+} testTransition_t;
+
+static timespan_t _testTimespans[TEST_ITEMS];
+static schedulerHandle_t _testHandles[TEST_ITEMS];
+static std::vector<testTransition_t> _testTransitions;
+static uint32_t _testEvents = 0;
+
+static bool testLess(const testTransition_t& a, const testTransition_t& b)
+{
+  return a.time != b.time ? a.time < b.time : a.index < b.index;
+}
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+  _testEvents++;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    _testTransitions.push_back({ (time_t)(batch->time - batch->time % 60), batch->items[i].value, batch->items[i].state != 0 });
+  };
+}
+
+static void testCallback(schedulerHandle_t handle, bool state, void* arg)
+{
+  uint32_t index = (uint32_t)(uintptr_t)arg;
+  TEST_CHECK(handle == _testHandles[index]);
+  struct timeval now;
+  schedPortWallTime(&now);
+  _testTransitions.push_back({ now.tv_sec - now.tv_sec % 60, index, state });
+}
+
+static std::vector<testTransition_t> testDay(bool callbacks)
+{
+  _testTransitions.clear();
+  _testEvents = 0;
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    _testHandles[i] = callbacks
+      ? schedulerRegisterCallback(&_testTimespans[i], testCallback, (void*)(uintptr_t)i)
+      : schedulerRegister(&_testTimespans[i], i);
+    TEST_CHECK(_testHandles[i] != SCHEDULER_HANDLE_INVALID);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, testBatchHandler, nullptr);
+  TEST_CHECK(schedulerStart(false));
+  schedulerPortAdvance(24 * 3600 * 1000000LL);
+  schedulerPortDispatch();
+  eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, testBatchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+  std::vector<testTransition_t> ret = _testTransitions;
+  std::sort(ret.begin(), ret.end(), testLess);
+  return ret;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _testTimespans[i] = begin * 10000 + end;
+  };
+
+  std::vector<testTransition_t> broadcast = testDay(false);
+  uint32_t broadcastEvents = _testEvents;
+  std::vector<testTransition_t> direct = testDay(true);
+  TEST_CHECK(broadcastEvents > 0);
+  TEST_CHECK(_testEvents == 0);
+  // The state of every item at the start, then its edges during the day
+  TEST_CHECK(broadcast.size() >= TEST_ITEMS);
+  TEST_CHECK(broadcast.size() == direct.size());
+  for (size_t i = 0; (i < broadcast.size()) && (i < direct.size()); i++) {
+    TEST_CHECK(broadcast[i].time == direct[i].time);
+    TEST_CHECK(broadcast[i].index == direct[i].index);
+    TEST_CHECK(broadcast[i].state == direct[i].state);
+  };
+  return TEST_RESULT();
+}
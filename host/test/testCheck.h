@@ -0,0 +1,18 @@
+// Minimal checks for the host tests: failures are printed, the result is the exit code of the test
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+
+#include <stdio.h>
+
+static int _testFailures = 0;
+
+#define TEST_CHECK(condition) do { \
+  if (!(condition)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    _testFailures++; \
+  }; \
+} while (0)
+
+#define TEST_RESULT() (_testFailures > 0 ? 1 : 0)
+
+#endif // __TEST_CHECK_H__
@@ -0,0 +1,133 @@
+// Next fire times of cron schedules: the same minutes as a check of every minute, in the system time zone with
+// changes of DST and with a custom clock that has its own zone; a replay with that clock fires at its local minutes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_FROM         1710000000  // Sat Mar 09 2024 16:00:00 UTC
+#define TEST_STEP         (21 * 3600 + 13 * 60 + 17)
+#define TEST_STEPS        420         // About a year
+#define TEST_HORIZON      (8 * 86400)
+#define TEST_CLOCK_OFFSET (5 * 3600 + 30 * 60)
+
+static const char* _testExpressions[] = {
+  "30 9 * * *",
+  "*/15 * * * *",
+  "0 2 * * *",          // Skipped on the day DST begins (in Europe)
+  "30 2 * * 0",         // Repeated or skipped on Sundays of the changes
+  "0,30 1-3 * * *",
+  "5 0 1 * *",
+  "0 12 * * 1-5",
+  "59 23 * * 6",
+  "0 0 29 2 *",
+};
+
+static const char* _testZones[] = {
+  "UTC0",
+  "CET-1CEST,M3.5.0,M10.5.0/3",
+  "EST5EDT,M3.2.0,M11.1.0",
+  "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+};
+
+// A clock with a fixed offset that is not the zone of the system
+static struct tm* testClockLocal(const time_t* time, struct tm* local)
+{
+  time_t shifted = *time + TEST_CLOCK_OFFSET;
+  return gmtime_r(&shifted, local);
+}
+
+static const schedulerClock_t _testClock = { nullptr, testClockLocal };
+
+static void testLocal(const schedulerClock_t* clock, time_t time, struct tm* local)
+{
+  if (clock) {
+    clock->local_time(&time, local);
+  } else {
+    localtime_r(&time, local);
+  };
+}
+
+// Reference: every minute is checked
+static time_t testCronNext(const schedulerCron_t* cron, time_t after, const schedulerClock_t* clock)
+{
+  for (time_t t = after - after % 60 + 60; t <= after + TEST_HORIZON; t += 60) {
+    struct tm local;
+    testLocal(clock, t, &local);
+    if (schedulerCronMatch(cron, &local)) return t;
+  };
+  return 0;
+}
+
+static void testEquivalence(const schedulerClock_t* clock)
+{
+  for (const char* expression : _testExpressions) {
+    schedulerCron_t cron;
+    TEST_CHECK(schedulerCronParse(expression, &cron));
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < TEST_STEPS; i++) {
+      time_t after = TEST_FROM + (time_t)i * TEST_STEP;
+      time_t expected = testCronNext(&cron, after, clock);
+      time_t next = schedulerCronNextClock(&cron, after, clock);
+      // Beyond the horizon of the reference only the order is checked
+      if ((expected != 0) ? (next != expected) : ((next != 0) && (next <= after + TEST_HORIZON))) {
+        if (mismatches++ == 0) {
+          fprintf(stderr, "\"%s\" TZ=%s after %lld: %lld instead of %lld\n", expression, getenv("TZ"),
+            (long long)after, (long long)next, (long long)expected);
+        };
+      };
+    };
+    TEST_CHECK(mismatches == 0);
+  };
+}
+
+static std::vector<int64_t> _testFires;
+
+static void testReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  if (record->event == RE_TIME_CRON) {
+    _testFires.push_back(record->time);
+  };
+}
+
+// Replay with the custom clock: "30 9 * * *" fires at 09:30 of the clock, that is at 04:00 UTC
+static void testReplayClock()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_FROM);
+  TEST_CHECK(schedulerInit());
+  schedulerSetClock(&_testClock);
+  schedulerCron_t cron;
+  TEST_CHECK(schedulerCronParse("30 9 * * *", &cron));
+  TEST_CHECK(schedulerRegisterCron(&cron, 1) != SCHEDULER_HANDLE_INVALID);
+  TEST_CHECK(schedulerCronNext(&cron, TEST_FROM) == schedulerCronNextClock(&cron, TEST_FROM, &_testClock));
+  _testFires.clear();
+  schedulerReplayStats_t stats;
+  TEST_CHECK(schedulerReplay(TEST_FROM, TEST_FROM + 7 * 86400, testReplayLog, nullptr, &stats));
+  TEST_CHECK(_testFires.size() == 7);
+  for (int64_t time : _testFires) {
+    TEST_CHECK(time % 86400 == 4 * 3600);
+  };
+  schedulerSetClock(nullptr);
+  schedulerFree();
+  schedulerPortStop();
+}
+
+int main()
+{
+  for (const char* zone : _testZones) {
+    setenv("TZ", zone, 1);
+    tzset();
+    testEquivalence(nullptr);
+  };
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  testEquivalence(&_testClock);
+  testReplayClock();
+  return TEST_RESULT();
+}
@@ -0,0 +1,119 @@
+// Default events: without CONFIG_SCHEDULER_BATCH_EVENTS every transition is posted as RE_TIME_TIMESPAN_ON / OFF, whose
+// data is the value of the item used as a pointer to uint32_t; over a day they follow checkTimespan() of every minute.
+// Also built with CONFIG_SCHEDULER_WORKER: the ticks are processed by the worker, nothing waits in the timer task
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700006430  // Wed Nov 15 2023 00:00:30 UTC
+#define TEST_ITEMS        50
+
+typedef struct {
+  time_t time;
+  uint32_t index;
+  bool state;
+} testTransition_t;
+
+static timespan_t _testTimespans[TEST_ITEMS];
+static uint32_t* _testSlots = nullptr;  // Values of the items: 32-bit addresses of the slots, slot[i] == i
+static std::vector<testTransition_t> _testTransitions;
+
+static bool testLess(const testTransition_t& a, const testTransition_t& b)
+{
+  return a.time != b.time ? a.time < b.time : a.index < b.index;
+}
+
+static void testEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if ((event_id != RE_TIME_TIMESPAN_ON) && (event_id != RE_TIME_TIMESPAN_OFF)) return;
+  struct timeval now;
+  schedPortWallTime(&now);
+  _testTransitions.push_back({ now.tv_sec - now.tv_sec % 60, *(uint32_t*)event_data, event_id == RE_TIME_TIMESPAN_ON });
+}
+
+// The slots must have addresses below 4 GB to pass through uint32_t values
+static bool testSlotsAlloc()
+{
+  void* slots = mmap(nullptr, TEST_ITEMS * sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+  if ((slots == MAP_FAILED) || ((uintptr_t)slots > UINT32_MAX)) return false;
+  _testSlots = (uint32_t*)slots;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    _testSlots[i] = i;
+  };
+  return true;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  if (!testSlotsAlloc()) {
+    printf("No memory below 4 GB, skipped\n");
+    return 0;
+  };
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _testTimespans[i] = begin * 10000 + end;
+  };
+
+  // Reference: the states at the start, then a transition at every minute where checkTimespan() changes
+  std::vector<testTransition_t> expected;
+  bool states[TEST_ITEMS];
+  time_t start = TEST_START_TIME - TEST_START_TIME % 60;
+  for (time_t t = start; t <= start + 24 * 3600; t += 60) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+      bool state = checkTimespan(&tm, _testTimespans[i]);
+      if ((t == start) || (state != states[i])) {
+        expected.push_back({ t, i, state });
+      };
+      states[i] = state;
+    };
+  };
+
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    TEST_CHECK(schedulerRegister(&_testTimespans[i], (uint32_t)(uintptr_t)&_testSlots[i]) != SCHEDULER_HANDLE_INVALID);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testEventHandler, nullptr);
+  TEST_CHECK(schedulerStart(false));
+  schedulerPortStatsReset();
+  schedulerPortAdvance(24 * 3600 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerPortStats_t port;
+  schedulerPortStats(&port);
+  TEST_CHECK(port.post_failures == 0);
+  #if CONFIG_SCHEDULER_WORKER
+    TEST_CHECK(port.timer_waits == 0);
+  #endif // CONFIG_SCHEDULER_WORKER
+  schedulerTimingStats_t timing;
+  schedulerTimingStats(&timing);
+  TEST_CHECK(timing.missed == 0);
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testEventHandler);
+  schedulerDelete();
+  schedulerPortStop();
+
+  std::sort(_testTransitions.begin(), _testTransitions.end(), testLess);
+  TEST_CHECK(_testTransitions.size() == expected.size());
+  for (size_t i = 0; (i < _testTransitions.size()) && (i < expected.size()); i++) {
+    TEST_CHECK(_testTransitions[i].time == expected[i].time);
+    TEST_CHECK(_testTransitions[i].index == expected[i].index);
+    TEST_CHECK(_testTransitions[i].state == expected[i].state);
+  };
+  munmap(_testSlots, TEST_ITEMS * sizeof(uint32_t));
+  return TEST_RESULT();
+}
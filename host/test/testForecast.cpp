@@ -0,0 +1,300 @@
+// Forecast: queries around the changes of the UTC offset in 2024 (all items and single ones) against the transitions of
+// schedulerReplay() over the same window, in several time zones; the cache serves a query per second with a few
+// computations; queries from another task while the timer registers, grows the pool and removes items stay consistent
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_YEAR_FROM    1704067200  // Mon Jan 01 2024 00:00:00 UTC
+#define TEST_YEAR_TO      1735689600  // Wed Jan 01 2025 00:00:00 UTC
+#define TEST_TIMESPANS    50
+#define TEST_CRONS        3
+#define TEST_WINDOW       (6 * 3600)
+#define TEST_QUERIES      1000
+#define TEST_CONCURRENT   200
+#define TEST_SECOND       1000000LL
+
+typedef struct {
+  time_t time;
+  uint32_t value;
+  uint8_t state;
+} testTransition_t;
+
+static timespan_t _testTimespans[TEST_CONCURRENT];
+static schedulerCron_t _testCrons[TEST_CRONS];
+static const char* _testExpressions[TEST_CRONS] = { "30 2 * * *", "*/20 9-17 * * 1-5", "0 3 * * 0" };
+static std::vector<testTransition_t> _testLog;
+
+static const char* _testZones[] = {
+  "CET-1CEST,M3.5.0,M10.5.0/3",
+  "EST5EDT,M3.2.0,M11.1.0",
+  "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",  // Lord Howe: the offset changes by half an hour
+  "UTC0",
+};
+
+static bool testLess(const testTransition_t& a, const testTransition_t& b)
+{
+  if (a.time != b.time) return a.time < b.time;
+  if (a.value != b.value) return a.value < b.value;
+  return a.state < b.state;
+}
+
+static void testReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  switch (record->event) {
+    case RE_TIME_TIMESPAN_ON:  _testLog.push_back({ (time_t)record->time, record->value, 1 }); break;
+    case RE_TIME_TIMESPAN_OFF: _testLog.push_back({ (time_t)record->time, record->value, 0 }); break;
+    case RE_TIME_CRON:         _testLog.push_back({ (time_t)record->time, record->value, 1 }); break;
+  };
+}
+
+// Transitions of the replay within (now, now + window] of the items with the value (0 - all)
+static std::vector<testTransition_t> testExpected(time_t now, uint32_t window, uint32_t value)
+{
+  _testLog.clear();
+  schedulerReplayStats_t stats;
+  TEST_CHECK(schedulerReplay(now - 120, now + window + 60, testReplayLog, nullptr, &stats));
+  std::vector<testTransition_t> ret;
+  for (const testTransition_t& record : _testLog) {
+    if ((record.time > now) && (record.time <= now + window) && ((value == 0) || (record.value == value))) {
+      ret.push_back(record);
+    };
+  };
+  std::sort(ret.begin(), ret.end(), testLess);
+  return ret;
+}
+
+// The forecast is ordered by time, then compared with the replay regardless of the order within a tick
+static uint32_t testCompare(schedulerHandle_t handle, uint32_t window, const std::vector<testTransition_t>& expected)
+{
+  static schedulerForecastItem_t items[CONFIG_SCHEDULER_FORECAST_SIZE];
+  uint32_t count = schedulerForecast(handle, window, items, CONFIG_SCHEDULER_FORECAST_SIZE);
+  TEST_CHECK(count < CONFIG_SCHEDULER_FORECAST_SIZE);
+  std::vector<testTransition_t> forecast;
+  for (uint32_t i = 0; i < count; i++) {
+    TEST_CHECK((i == 0) || (items[i - 1].time <= items[i].time));
+    TEST_CHECK((handle == SCHEDULER_HANDLE_INVALID) || (items[i].handle == handle));
+    forecast.push_back({ items[i].time, items[i].value, items[i].state });
+  };
+  std::sort(forecast.begin(), forecast.end(), testLess);
+  if (forecast.size() != expected.size()) {
+    fprintf(stderr, "TZ=%s: %zu transitions instead of %zu\n", getenv("TZ"), forecast.size(), expected.size());
+    return 1;
+  };
+  for (size_t i = 0; i < forecast.size(); i++) {
+    if ((forecast[i].time != expected[i].time) || (forecast[i].value != expected[i].value) 
+     || (forecast[i].state != expected[i].state)) {
+      fprintf(stderr, "TZ=%s: transition %zu is %lld/%u/%u instead of %lld/%u/%u\n", getenv("TZ"), i, 
+        (long long)forecast[i].time, forecast[i].value, forecast[i].state, 
+        (long long)expected[i].time, expected[i].value, expected[i].state);
+      return 1;
+    };
+  };
+  return 0;
+}
+
+// Instants of 2024 at which the UTC offset of the zone changes
+static std::vector<time_t> testOffsetChanges()
+{
+  std::vector<time_t> ret;
+  struct tm local;
+  time_t t = TEST_YEAR_FROM;
+  localtime_r(&t, &local);
+  long offset = local.tm_gmtoff;
+  for (; t < TEST_YEAR_TO; t += 60) {
+    localtime_r(&t, &local);
+    if (local.tm_gmtoff != offset) {
+      ret.push_back(t);
+      offset = local.tm_gmtoff;
+    };
+  };
+  return ret;
+}
+
+// Hourly queries from 6 hours before to 6 hours after every change, in the middle of the minute
+static void testZone(const char* zone, uint32_t* queries, uint32_t* mismatches)
+{
+  setenv("TZ", zone, 1);
+  tzset();
+  std::vector<time_t> changes = testOffsetChanges();
+  if (changes.empty()) {
+    // Without changes: the instants of the first zone
+    changes.push_back(1711846800);  // Sun Mar 31 2024 01:00:00 UTC
+    changes.push_back(1729990800);  // Sun Oct 27 2024 01:00:00 UTC
+  };
+  TEST_CHECK(changes.size() == 2);
+
+  TEST_CHECK(schedulerPortStart(true));
+  TEST_CHECK(schedulerInit());
+  schedulerHandle_t inside = SCHEDULER_HANDLE_INVALID, cron = SCHEDULER_HANDLE_INVALID;
+  for (uint32_t i = 0; i < TEST_TIMESPANS; i++) {
+    schedulerHandle_t handle = schedulerRegister(&_testTimespans[i], 1000 + i);
+    TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+    if (i == 13) inside = handle;
+  };
+  for (uint32_t i = 0; i < TEST_CRONS; i++) {
+    schedulerHandle_t handle = schedulerRegisterCron(&_testCrons[i], 2000 + i);
+    TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+    if (i == 0) cron = handle;
+  };
+
+  for (time_t change : changes) {
+    for (int hour = -6; hour <= 6; hour++) {
+      time_t now = change - change % 60 + hour * 3600 + 30;
+      std::vector<testTransition_t> all = testExpected(now, TEST_WINDOW, 0);
+      std::vector<testTransition_t> one = testExpected(now, TEST_WINDOW, 1013);
+      std::vector<testTransition_t> crons = testExpected(now, TEST_WINDOW, 2000);
+      schedulerPortSetTime(now);
+      *mismatches += testCompare(SCHEDULER_HANDLE_INVALID, TEST_WINDOW, all);
+      *mismatches += testCompare(inside, TEST_WINDOW, one);
+      *mismatches += testCompare(cron, TEST_WINDOW, crons);
+      *queries += 3;
+    };
+  };
+
+  // A query per second over 1000 seconds across the change: the cache is computed again only a few times
+  uint32_t computed0 = 0, cached0 = 0, computed = 0, cached = 0;
+  schedulerForecastStats(&computed0, &cached0);
+  schedulerForecastItem_t items[CONFIG_SCHEDULER_FORECAST_SIZE];
+  for (uint32_t i = 0; i < TEST_QUERIES; i++) {
+    schedulerPortSetTime(changes[0] - TEST_QUERIES / 2 + i);
+    TEST_CHECK(schedulerForecast(SCHEDULER_HANDLE_INVALID, 3600, items, CONFIG_SCHEDULER_FORECAST_SIZE) > 0);
+  };
+  schedulerForecastStats(&computed, &cached);
+  TEST_CHECK((computed - computed0 >= 1) && (computed - computed0 <= 4));
+  TEST_CHECK(computed - computed0 + cached - cached0 == TEST_QUERIES);
+
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+
+static std::atomic<bool> _testReading(false);
+static std::atomic<uint32_t> _testReads(0);
+static std::atomic<uint32_t> _testBadReads(0);
+
+// Another task: every forecast must be ordered, in the future and made of known values
+static void testReader()
+{
+  static schedulerForecastItem_t items[CONFIG_SCHEDULER_FORECAST_SIZE];
+  while (_testReading.load()) {
+    struct timeval before, after;
+    schedPortWallTime(&before);
+    uint32_t count = schedulerForecast(SCHEDULER_HANDLE_INVALID, 3600, items, CONFIG_SCHEDULER_FORECAST_SIZE);
+    schedPortWallTime(&after);
+    for (uint32_t i = 0; i < count; i++) {
+      if (((i > 0) && (items[i - 1].time > items[i].time)) || (items[i].time <= before.tv_sec - before.tv_sec % 60)
+       || (items[i].time > after.tv_sec + 3600) || (items[i].value < 1000) || (items[i].value >= 1000 + TEST_CONCURRENT)
+       || (items[i].state > 1)) {
+        _testBadReads++;
+        break;
+      };
+    };
+    _testReads++;
+    sched_yield();
+  };
+}
+
+// The timer goes on only after the other task has read again, so that every change overlaps some queries
+static void testAdvance(int64_t delta_us)
+{
+  uint32_t reads = _testReads.load();
+  while (_testReads.load() < reads + 2) {
+    sched_yield();
+  };
+  schedulerPortAdvance(delta_us);
+}
+
+// Remaining items after the concurrent changes: minute by minute with checkTimespan()
+static void testConcurrent()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  const time_t start = 1718877630;  // Thu Jun 20 2024 10:00:30 UTC
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(start);
+  TEST_CHECK(schedulerStart(false));
+  _testReading = true;
+  std::thread reader(testReader);
+
+  // The pool grows from CONFIG_SCHEDULER_POOL_SIZE while the other task reads it, then most items are removed
+  std::vector<schedulerHandle_t> handles;
+  for (uint32_t i = 0; i < TEST_CONCURRENT; i++) {
+    handles.push_back(schedulerRegister(&_testTimespans[i], 1000 + i));
+    TEST_CHECK(handles.back() != SCHEDULER_HANDLE_INVALID);
+    if (i % 10 == 9) {
+      testAdvance(TEST_SECOND);
+    };
+  };
+  for (uint32_t i = 0; i < TEST_CONCURRENT; i++) {
+    if (i % 4 != 0) {
+      TEST_CHECK(schedulerUnregister(handles[i]));
+    };
+    if (i % 10 == 9) {
+      testAdvance(TEST_SECOND);
+    };
+  };
+  testAdvance(60 * TEST_SECOND);
+  _testReading = false;
+  reader.join();
+  TEST_CHECK(_testReads.load() > 0);
+  TEST_CHECK(_testBadReads.load() == 0);
+
+  struct timeval now;
+  schedPortWallTime(&now);
+  std::vector<testTransition_t> expected;
+  for (uint32_t i = 0; i < TEST_CONCURRENT; i += 4) {
+    time_t t = now.tv_sec - now.tv_sec % 60;
+    struct tm local;
+    localtime_r(&t, &local);
+    bool state = checkTimespan(&local, _testTimespans[i]);
+    for (t += 60; t <= now.tv_sec + TEST_WINDOW; t += 60) {
+      localtime_r(&t, &local);
+      bool next = checkTimespan(&local, _testTimespans[i]);
+      if (next != state) {
+        expected.push_back({ t, 1000 + i, next ? (uint8_t)1 : (uint8_t)0 });
+      };
+      state = next;
+    };
+  };
+  std::sort(expected.begin(), expected.end(), testLess);
+  TEST_CHECK(testCompare(SCHEDULER_HANDLE_INVALID, TEST_WINDOW, expected) == 0);
+
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main()
+{
+  for (uint32_t i = 0; i < TEST_CONCURRENT; i++) {
+    uint32_t on = (i * 37 + 60) % 1440;
+    uint32_t off = (on + 13 + i * 11) % 1440;
+    if (i % 10 == 3) {
+      // Inside the hour skipped or repeated at a change of DST
+      on = 120 + i % 60;
+      off = 150 + i % 60;
+    };
+    _testTimespans[i] = (on / 60) * 1000000 + (on % 60) * 10000 + (off / 60) * 100 + off % 60;
+  };
+  for (uint32_t i = 0; i < TEST_CRONS; i++) {
+    TEST_CHECK(schedulerCronParse(_testExpressions[i], &_testCrons[i]));
+  };
+
+  uint32_t queries = 0, mismatches = 0;
+  for (const char* zone : _testZones) {
+    testZone(zone, &queries, &mismatches);
+  };
+  TEST_CHECK(queries > 0);
+  TEST_CHECK(mismatches == 0);
+  testConcurrent();
+  return TEST_RESULT();
+}
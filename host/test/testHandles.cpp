@@ -0,0 +1,57 @@
+// Handles of unregistered schedules must not refer to the schedules registered later in the same slot
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME  1700006400  // Wed Nov 15 2023 00:00:00 UTC
+
+static schedulerHandle_t _testLastHandle = SCHEDULER_HANDLE_INVALID;
+static uint32_t _testCalls = 0;
+
+static void testCallback(schedulerHandle_t handle, bool state, void* arg)
+{
+  _testLastHandle = handle;
+  _testCalls++;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerInit());
+  TEST_CHECK(schedulerStart(false));
+
+  timespan_t first = 101110;      // 00:10 - 01:10
+  timespan_t second = 2000210;    // 02:00 - 02:10
+  timespan_t other = 3000310;
+  schedulerHandle_t old = schedulerRegisterCallback(&first, testCallback, nullptr);
+  TEST_CHECK(old != SCHEDULER_HANDLE_INVALID);
+  schedulerPortAdvance(60000000);
+  TEST_CHECK(schedulerUnregister(old));
+  TEST_CHECK(!schedulerUnregister(old));
+  schedulerPortAdvance(60000000);
+
+  // The slot is reused with another generation
+  schedulerHandle_t handle = schedulerRegisterCallback(&second, testCallback, nullptr);
+  TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+  TEST_CHECK(handle != old);
+  TEST_CHECK(!schedulerUpdate(old, &other));
+  TEST_CHECK(!schedulerSetFlags(old, SCHEDULER_FLAG_IMMEDIATE));
+  TEST_CHECK(!schedulerUnregister(old));
+
+  // The new schedule is not affected by the stale handle and its callback gets the new handle:
+  // OFF for both schedules when they are checked for the first time, then ON and OFF for the new one
+  schedulerPortAdvance((int64_t)3 * 3600 * 1000000);
+  TEST_CHECK(_testCalls == 4);
+  TEST_CHECK(_testLastHandle == handle);
+  TEST_CHECK(schedulerUnregister(handle));
+
+  schedulerDelete();
+  schedulerPortStop();
+  return TEST_RESULT();
+}
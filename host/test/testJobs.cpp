@@ -0,0 +1,172 @@
+// Periodic jobs: merging of jobs within their slack, suspend and resume, and resynchronizations of the clock (SNTP) 
+// that keep the monotonic deadlines of unaligned jobs and move the aligned ones to the new wall time
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700042400  // Wed Nov 15 2023 10:00:00 UTC
+#define TEST_MINUTE       60000000LL
+
+static std::vector<int64_t> _testRuns[2];
+static schedulerJobHandle_t _testJobs[2] = { SCHEDULER_JOB_INVALID, SCHEDULER_JOB_INVALID };
+
+static void testJob(void* arg)
+{
+  _testRuns[(uintptr_t)arg].push_back(schedPortMonotonicUs());
+}
+
+static void testStart(time_t time)
+{
+  _testRuns[0].clear();
+  _testRuns[1].clear();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(time);
+  TEST_CHECK(schedulerStart(false));
+}
+
+static void testRegister(uint32_t index, const char* name, uint32_t interval_ms, uint32_t slack_ms, int32_t phase_ms)
+{
+  _testJobs[index] = schedulerJobRegister(name, interval_ms, slack_ms, phase_ms, testJob, (void*)(uintptr_t)index);
+  TEST_CHECK(_testJobs[index] != SCHEDULER_JOB_INVALID);
+}
+
+// Jobs of the application stay registered after schedulerDelete()
+static void testStop()
+{
+  for (schedulerJobHandle_t& job : _testJobs) {
+    if (job != SCHEDULER_JOB_INVALID) {
+      TEST_CHECK(schedulerJobUnregister(job));
+      job = SCHEDULER_JOB_INVALID;
+    };
+  };
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+static void testSntpSync()
+{
+  eventLoopPost(RE_TIME_EVENTS, RE_TIME_SNTP_SYNC_OK, nullptr, 0, 0);
+  schedulerPortDispatch();
+}
+
+static void testAdvance(uint32_t minutes, uint32_t syncEvery)
+{
+  for (uint32_t i = 1; i <= minutes; i++) {
+    schedulerPortAdvance(TEST_MINUTE);
+    if (syncEvery && (i % syncEvery == 0)) testSntpSync();
+  };
+}
+
+// A job longer than the period of SNTP synchronizations still runs on its own interval
+static void testResync()
+{
+  testStart(TEST_START_TIME);
+  int64_t start = schedPortMonotonicUs();
+  testRegister(0, "2h", 120 * 60000, 0, SCHEDULER_JOB_PHASE_NONE);
+  testAdvance(24 * 60 + 1, 60);
+  TEST_CHECK(_testRuns[0].size() == 12);
+  for (size_t i = 0; i < _testRuns[0].size(); i++) {
+    TEST_CHECK(_testRuns[0][i] - start == (int64_t)(i + 1) * 120 * TEST_MINUTE + 1);
+  };
+  testStop();
+}
+
+// Two jobs run in one wakeup when their slack allows it, never earlier than the deadline and never later than the slack
+static void testMerge()
+{
+  testStart(TEST_START_TIME);
+  schedulerJobsStats_t before, after;
+  schedulerJobsStats(&before);
+  int64_t start = schedPortMonotonicUs();
+  testRegister(0, "10m", 10 * 60000, 3 * 60000, SCHEDULER_JOB_PHASE_NONE);
+  testRegister(1, "12m", 12 * 60000, 3 * 60000, SCHEDULER_JOB_PHASE_NONE);
+  testAdvance(120 + 3 + 1, 0);
+  schedulerJobsStats(&after);
+  const int64_t intervals[2] = { 10 * TEST_MINUTE, 12 * TEST_MINUTE };
+  for (uint32_t j = 0; j < 2; j++) {
+    TEST_CHECK(_testRuns[j].size() == (size_t)(120 * TEST_MINUTE / intervals[j]));
+    for (size_t i = 0; i < _testRuns[j].size(); i++) {
+      int64_t late = _testRuns[j][i] - start - 1 - (int64_t)(i + 1) * intervals[j];
+      TEST_CHECK((late >= 0) && (late <= 3 * TEST_MINUTE));
+    };
+  };
+  uint32_t runs = after.runs - before.runs;
+  TEST_CHECK(runs == _testRuns[0].size() + _testRuns[1].size());
+  TEST_CHECK(after.merged - before.merged > 0);
+  TEST_CHECK(after.wakeups - before.wakeups == runs - (after.merged - before.merged));
+  testStop();
+}
+
+// No runs while suspended; after resume the interval is counted from the resume
+static void testSuspend()
+{
+  testStart(TEST_START_TIME);
+  testRegister(0, "5m", 5 * 60000, 0, SCHEDULER_JOB_PHASE_NONE);
+  testAdvance(12, 0);
+  TEST_CHECK(_testRuns[0].size() == 2);
+  TEST_CHECK(schedulerSuspend());
+  testAdvance(30, 0);
+  TEST_CHECK(_testRuns[0].size() == 2);
+  TEST_CHECK(schedulerResume());
+  int64_t resumed = schedPortMonotonicUs();
+  testAdvance(11, 0);
+  TEST_CHECK(_testRuns[0].size() == 4);
+  if (_testRuns[0].size() == 4) {
+    TEST_CHECK(_testRuns[0][2] - resumed == 5 * TEST_MINUTE + 1);
+  };
+  // A resume without a suspend changes nothing
+  TEST_CHECK(schedulerResume());
+  testAdvance(5, 0);
+  TEST_CHECK(_testRuns[0].size() == 5);
+  if (_testRuns[0].size() == 5) {
+    TEST_CHECK(_testRuns[0][4] - resumed == 15 * TEST_MINUTE + 1);
+  };
+  testStop();
+}
+
+// After a step of the wall clock, an aligned job runs at the next aligned instant of the new time, an unaligned one 
+// keeps its deadline
+static void testRealign()
+{
+  testStart(TEST_START_TIME + 20 * 60);
+  int64_t start = schedPortMonotonicUs();
+  testRegister(0, "hourly", 60 * 60000, 0, 0);
+  testRegister(1, "50m", 50 * 60000, 0, SCHEDULER_JOB_PHASE_NONE);
+  testAdvance(45, 0);
+  // 11:00 of the wall clock
+  TEST_CHECK(_testRuns[0].size() == 1);
+  if (_testRuns[0].size() == 1) {
+    TEST_CHECK(_testRuns[0][0] - start == 40 * TEST_MINUTE);
+  };
+  // 11:05 becomes 11:35
+  struct timeval now;
+  schedPortWallTime(&now);
+  schedulerPortSetTime(now.tv_sec + 30 * 60);
+  testSntpSync();
+  int64_t stepped = schedPortMonotonicUs();
+  testAdvance(30, 0);
+  TEST_CHECK(_testRuns[0].size() == 2);
+  if (_testRuns[0].size() == 2) {
+    TEST_CHECK(_testRuns[0][1] - stepped == 25 * TEST_MINUTE);
+  };
+  TEST_CHECK(_testRuns[1].size() == 1);
+  if (_testRuns[1].size() == 1) {
+    TEST_CHECK(_testRuns[1][0] - start == 50 * TEST_MINUTE + 1);
+  };
+  testStop();
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  testResync();
+  testMerge();
+  testSuspend();
+  testRealign();
+  return TEST_RESULT();
+}
@@ -0,0 +1,94 @@
+// Modes over two days with a change of the UTC offset: after every tick schedulerModes() and the event group of
+// schedulerModesWait() agree with checkTimespan(); a changed parameter of a mode is applied by the timer, not by the
+// handler of RE_PARAMS_CHANGED, so the bits and the event group are never updated by two tasks at once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1698440430  // Sat Oct 28 2023 00:00:30 EEST, the offset changes on Sunday at 04:00
+#define TEST_MINUTES      2880
+#define TEST_SECOND       1000000LL
+
+static timespan_t _testNight = 22000600;
+static timespan_t _testEco = 9001700;
+static timespan_t _testPeak = 17302030;
+static bool _testEcoEnabled = true;
+
+static uint32_t testExpected(time_t now)
+{
+  struct tm tm;
+  localtime_r(&now, &tm);
+  uint32_t bits = 0;
+  if (checkTimespan(&tm, _testNight)) bits |= SCHEDULER_MODE_BIT(0);
+  if (_testEcoEnabled && checkTimespan(&tm, _testEco)) bits |= SCHEDULER_MODE_BIT(1);
+  if (checkTimespan(&tm, _testPeak)) bits |= SCHEDULER_MODE_BIT(2);
+  return bits;
+}
+
+// The bits and both halves of the event group
+static uint32_t testMismatch(uint32_t expected)
+{
+  const uint32_t all = SCHEDULER_MODE_BIT(3) - 1;
+  uint32_t mismatch = 0;
+  if (schedulerModes() != expected) mismatch++;
+  if (schedulerModesWait(all, true, 0) != expected) mismatch++;
+  if (schedulerModesWait(all, false, 0) != (all & ~expected)) mismatch++;
+  return mismatch;
+}
+
+// Change of a parameter as done by the parameters module: the value, then the event with its address
+static void testParamChanged(void* address)
+{
+  uint32_t value = (uint32_t)(uintptr_t)address;
+  TEST_CHECK(eventLoopPost(RE_PARAMS_EVENTS, RE_PARAMS_CHANGED, &value, sizeof(value), 0));
+}
+
+int main()
+{
+  setenv("TZ", "EET-2EEST,M3.5.0/3,M10.5.0/4", 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerModeRegister("night", &_testNight, nullptr) == 0);
+  TEST_CHECK(schedulerModeRegister("eco", &_testEco, &_testEcoEnabled) == 1);
+  TEST_CHECK(schedulerModeRegister("peak", &_testPeak, nullptr) == 2);
+  TEST_CHECK(schedulerStart(false));
+  // The first tick comes a second after the start
+  schedulerPortAdvance(TEST_SECOND);
+
+  uint32_t mismatches = 0;
+  time_t minute = TEST_START_TIME - TEST_START_TIME % 60;
+  mismatches += testMismatch(testExpected(minute));
+  for (uint32_t m = 1; m <= TEST_MINUTES; m++) {
+    schedulerPortAdvance(60 * TEST_SECOND);
+    minute += 60;
+    if ((m == 600) || (m == 2000)) {
+      // Eco mode is switched off at 10:00 of the first day and moved to 08:00-09:00 on the second (08:20)
+      uint32_t before = testExpected(minute);
+      if (m == 600) {
+        _testEcoEnabled = false;
+        testParamChanged(&_testEcoEnabled);
+      } else {
+        _testEcoEnabled = true;
+        _testEco = 8000900;
+        testParamChanged(&_testEco);
+      };
+      TEST_CHECK(testExpected(minute) != before);
+      schedulerPortDispatch();
+      TEST_CHECK(testMismatch(before) == 0);
+      schedulerPortAdvance(1000);
+    };
+    mismatches += testMismatch(testExpected(minute));
+  };
+  TEST_CHECK(mismatches == 0);
+
+  schedulerTimingStats_t timing;
+  schedulerTimingStats(&timing);
+  TEST_CHECK(timing.missed == 0);
+  schedulerDelete();
+  schedulerPortStop();
+  return TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+// Replay of a leap year: transitions of timespans (some inside the hour of the change of DST), cron matches and the 
+// start of hour/day/week/month/year against a check of every minute with localtime_r(), in several time zones;
+// a second replay gives the same log
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_FROM         1704067200  // Mon Jan 01 2024 00:00:00 UTC
+#define TEST_TO           1735689600  // Wed Jan 01 2025 00:00:00 UTC
+#define TEST_TIMESPANS    50
+#define TEST_CRONS        3
+
+typedef struct {
+  int64_t time;
+  int32_t event;
+  uint32_t value;
+} testRecord_t;
+
+static timespan_t _testTimespans[TEST_TIMESPANS];
+static schedulerCron_t _testCrons[TEST_CRONS];
+static const char* _testExpressions[TEST_CRONS] = { "30 2 * * *", "0 0 29 2 *", "*/20 9-17 * * 1-5" };
+static std::vector<testRecord_t> _testLog;
+
+static const char* _testZones[] = {
+  "UTC0",
+  "CET-1CEST,M3.5.0,M10.5.0/3",
+  "EST5EDT,M3.2.0,M11.1.0",
+};
+
+static void testReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  _testLog.push_back({ record->time, record->event, record->value });
+}
+
+static bool testLess(const testRecord_t& a, const testRecord_t& b)
+{
+  if (a.time != b.time) return a.time < b.time;
+  if (a.value != b.value) return a.value < b.value;
+  return a.event < b.event;
+}
+
+static bool testEqual(const testRecord_t& a, const testRecord_t& b)
+{
+  return (a.time == b.time) && (a.event == b.event) && (a.value == b.value);
+}
+
+static bool testEqual(std::vector<testRecord_t> a, std::vector<testRecord_t> b, bool sort)
+{
+  if (sort) {
+    std::sort(a.begin(), a.end(), testLess);
+    std::sort(b.begin(), b.end(), testLess);
+  };
+  if (a.size() != b.size()) {
+    fprintf(stderr, "TZ=%s: %zu records instead of %zu\n", getenv("TZ"), a.size(), b.size());
+    return false;
+  };
+  for (size_t i = 0; i < a.size(); i++) {
+    if (!testEqual(a[i], b[i])) {
+      fprintf(stderr, "TZ=%s: record %zu is %lld/%d/%u instead of %lld/%d/%u\n", getenv("TZ"), i, 
+        (long long)a[i].time, a[i].event, a[i].value, (long long)b[i].time, b[i].event, b[i].value);
+      return false;
+    };
+  };
+  return true;
+}
+
+static void testReplayZone(const char* zone)
+{
+  setenv("TZ", zone, 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(false));
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_TIMESPANS; i++) {
+    TEST_CHECK(schedulerRegister(&_testTimespans[i], 1000 + i) != SCHEDULER_HANDLE_INVALID);
+  };
+  for (uint32_t i = 0; i < TEST_CRONS; i++) {
+    TEST_CHECK(schedulerRegisterCron(&_testCrons[i], 2000 + i) != SCHEDULER_HANDLE_INVALID);
+  };
+
+  _testLog.clear();
+  schedulerReplayStats_t stats;
+  TEST_CHECK(schedulerReplay(TEST_FROM, TEST_TO, testReplayLog, nullptr, &stats));
+  TEST_CHECK(stats.ticks == (TEST_TO - TEST_FROM) / 60);
+  TEST_CHECK(stats.events == _testLog.size());
+
+  // Reference: every minute with localtime_r()
+  std::vector<testRecord_t> expected;
+  uint32_t hours = 0, days = 0, weeks = 0, months = 0, years = 0;
+  int8_t states[TEST_TIMESPANS];
+  for (uint32_t i = 0; i < TEST_TIMESPANS; i++) {
+    states[i] = -1;
+  };
+  for (time_t t = TEST_FROM; t < TEST_TO; t += 60) {
+    struct tm local;
+    localtime_r(&t, &local);
+    if (local.tm_min == 0) {
+      hours++;
+      if (local.tm_hour == 0) {
+        days++;
+        if (local.tm_wday == CONFIG_FORMAT_FIRST_DAY_OF_WEEK) weeks++;
+        if (local.tm_mday == 1) {
+          months++;
+          if (local.tm_mon == 0) years++;
+        };
+      };
+    };
+    for (uint32_t i = 0; i < TEST_TIMESPANS; i++) {
+      int8_t state = checkTimespan(&local, _testTimespans[i]) ? 1 : 0;
+      if (state != states[i]) {
+        expected.push_back({ t, state ? RE_TIME_TIMESPAN_ON : RE_TIME_TIMESPAN_OFF, 1000 + i });
+        states[i] = state;
+      };
+    };
+    for (uint32_t i = 0; i < TEST_CRONS; i++) {
+      if (schedulerCronMatch(&_testCrons[i], &local)) {
+        expected.push_back({ t, RE_TIME_CRON, 2000 + i });
+      };
+    };
+  };
+
+  std::vector<testRecord_t> transitions;
+  for (const testRecord_t& record : _testLog) {
+    switch (record.event) {
+      case RE_TIME_TIMESPAN_ON:
+      case RE_TIME_TIMESPAN_OFF:
+      case RE_TIME_CRON:
+        transitions.push_back(record);
+        break;
+      case RE_TIME_START_OF_HOUR:  hours--;  break;
+      case RE_TIME_START_OF_DAY:   days--;   break;
+      case RE_TIME_START_OF_WEEK:  weeks--;  break;
+      case RE_TIME_START_OF_MONTH: months--; break;
+      case RE_TIME_START_OF_YEAR:  years--;  break;
+    };
+  };
+  TEST_CHECK(testEqual(transitions, expected, true));
+  TEST_CHECK((hours == 0) && (days == 0) && (weeks == 0) && (months == 0) && (years == 0));
+
+  // The states of the items are restored after a replay
+  std::vector<testRecord_t> first = _testLog;
+  _testLog.clear();
+  TEST_CHECK(schedulerReplay(TEST_FROM, TEST_TO, testReplayLog, nullptr, &stats));
+  TEST_CHECK(testEqual(_testLog, first, false));
+
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main()
+{
+  for (uint32_t i = 0; i < TEST_TIMESPANS; i++) {
+    uint32_t on = (i * 37 + 60) % 1440;
+    uint32_t off = (on + 13 + i * 11) % 1440;
+    if (i % 10 == 3) {
+      // Inside the hour skipped or repeated at a change of DST
+      on = 120 + i;
+      off = 150 + i;
+    };
+    _testTimespans[i] = (on / 60) * 1000000 + (on % 60) * 10000 + (off / 60) * 100 + off % 60;
+  };
+  for (uint32_t i = 0; i < TEST_CRONS; i++) {
+    TEST_CHECK(schedulerCronParse(_testExpressions[i], &_testCrons[i]));
+  };
+  for (const char* zone : _testZones) {
+    testReplayZone(zone);
+  };
+  return TEST_RESULT();
+}
@@ -0,0 +1,172 @@
+// Shards: with any CONFIG_SCHEDULER_SHARDS the transitions of a replay and the callbacks of live ticks are the same as
+// a check of every minute with checkTimespan() and schedulerCronMatch(), for a full check and for ticks where thousands
+// of items are due at once; live ticks do not allocate memory. Built with 1, 2 and 4 shards
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_FROM         1718438340  // Sat Jun 15 2024 07:59:00 UTC
+#define TEST_MINUTES      40
+#define TEST_ITEMS        6000
+#define TEST_CRONS        2
+
+typedef struct {
+  int64_t time;
+  int32_t event;
+  uint32_t value;
+} testRecord_t;
+
+static timespan_t _testTimespans[TEST_ITEMS];
+static schedulerCron_t _testCrons[TEST_CRONS];
+static const char* _testExpressions[TEST_CRONS] = { "0 8 * * *", "*/5 8 * * *" };
+static std::vector<testRecord_t> _testLog;
+static int64_t _testTime = 0;
+
+static bool testIsCron(uint32_t index)
+{
+  return index % 4 == 3;
+}
+
+static void testReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  if ((record->event == RE_TIME_TIMESPAN_ON) || (record->event == RE_TIME_TIMESPAN_OFF) || (record->event == RE_TIME_CRON)) {
+    _testLog.push_back({ record->time, record->event, record->value });
+  };
+}
+
+static void testCallback(schedulerHandle_t handle, bool state, void* arg)
+{
+  uint32_t index = (uint32_t)(uintptr_t)arg;
+  int32_t event = testIsCron(index) ? RE_TIME_CRON : (state ? RE_TIME_TIMESPAN_ON : RE_TIME_TIMESPAN_OFF);
+  _testLog.push_back({ _testTime, event, index });
+}
+
+static bool testLess(const testRecord_t& a, const testRecord_t& b)
+{
+  if (a.time != b.time) return a.time < b.time;
+  if (a.value != b.value) return a.value < b.value;
+  return a.event < b.event;
+}
+
+static bool testEqual(std::vector<testRecord_t> a, std::vector<testRecord_t> b)
+{
+  std::sort(a.begin(), a.end(), testLess);
+  std::sort(b.begin(), b.end(), testLess);
+  if (a.size() != b.size()) {
+    fprintf(stderr, "%d shards: %zu records instead of %zu\n", CONFIG_SCHEDULER_SHARDS, a.size(), b.size());
+    return false;
+  };
+  for (size_t i = 0; i < a.size(); i++) {
+    if ((a[i].time != b[i].time) || (a[i].event != b[i].event) || (a[i].value != b[i].value)) {
+      fprintf(stderr, "%d shards: record %zu is %lld/%d/%u instead of %lld/%d/%u\n", CONFIG_SCHEDULER_SHARDS, i, 
+        (long long)a[i].time, a[i].event, a[i].value, (long long)b[i].time, b[i].event, b[i].value);
+      return false;
+    };
+  };
+  return true;
+}
+
+// Reference: every minute of the range
+static std::vector<testRecord_t> testExpected()
+{
+  std::vector<testRecord_t> expected;
+  std::vector<int8_t> states(TEST_ITEMS, -1);
+  for (uint32_t m = 0; m < TEST_MINUTES; m++) {
+    time_t t = TEST_FROM + (time_t)m * 60;
+    struct tm local;
+    localtime_r(&t, &local);
+    for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+      if (testIsCron(i)) {
+        if (schedulerCronMatch(&_testCrons[i % TEST_CRONS], &local)) {
+          expected.push_back({ t, RE_TIME_CRON, i });
+        };
+      } else {
+        int8_t state = checkTimespan(&local, _testTimespans[i]) ? 1 : 0;
+        if (state != states[i]) {
+          expected.push_back({ t, state ? RE_TIME_TIMESPAN_ON : RE_TIME_TIMESPAN_OFF, i });
+          states[i] = state;
+        };
+      };
+    };
+  };
+  return expected;
+}
+
+static void testReplay(const std::vector<testRecord_t>& expected)
+{
+  TEST_CHECK(schedulerPortStart(false));
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    schedulerHandle_t handle = testIsCron(i) 
+      ? schedulerRegisterCron(&_testCrons[i % TEST_CRONS], i) 
+      : schedulerRegister(&_testTimespans[i], i);
+    TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+  };
+  _testLog.clear();
+  schedulerReplayStats_t stats;
+  TEST_CHECK(schedulerReplay(TEST_FROM, TEST_FROM + TEST_MINUTES * 60, testReplayLog, nullptr, &stats));
+  TEST_CHECK(testEqual(_testLog, expected));
+  #if CONFIG_SCHEDULER_SHARDS > 1
+    schedulerShardsStats_t shards;
+    schedulerShardsStats(&shards);
+    TEST_CHECK(shards.shards == CONFIG_SCHEDULER_SHARDS);
+    TEST_CHECK(shards.runs > 1);
+  #endif // CONFIG_SCHEDULER_SHARDS
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+static void testLive(const std::vector<testRecord_t>& expected)
+{
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_FROM - 30);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    void* arg = (void*)(uintptr_t)i;
+    schedulerHandle_t handle = testIsCron(i) 
+      ? schedulerRegisterCronCallback(&_testCrons[i % TEST_CRONS], testCallback, arg) 
+      : schedulerRegisterCallback(&_testTimespans[i], testCallback, arg);
+    TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+  };
+  TEST_CHECK(schedulerStart(false));
+  _testLog.clear();
+  uint32_t allocs = 0;
+  for (uint32_t m = 0; m < TEST_MINUTES; m++) {
+    _testTime = TEST_FROM + (time_t)m * 60;
+    schedulerPortStatsReset();
+    schedulerPortAdvance(60000000);
+    schedulerPortDispatch();
+    schedulerPortStats_t stats;
+    schedulerPortStats(&stats);
+    // The first tick applies the registrations
+    if (m > 0) allocs += stats.allocs;
+  };
+  TEST_CHECK(allocs == 0);
+  TEST_CHECK(testEqual(_testLog, expected));
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  // Many items begin and end at the same minutes, so thousands of them are due in one tick
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    uint32_t begin = 8 * 60 + (i % 3) * 5;
+    uint32_t end = 8 * 60 + 10 + (i % 7) * 3;
+    _testTimespans[i] = ((begin / 60) * 100 + begin % 60) * 10000 + (end / 60) * 100 + end % 60;
+  };
+  for (uint32_t i = 0; i < TEST_CRONS; i++) {
+    TEST_CHECK(schedulerCronParse(_testExpressions[i], &_testCrons[i]));
+  };
+  std::vector<testRecord_t> expected = testExpected();
+  testReplay(expected);
+  testLive(expected);
+  return TEST_RESULT();
+}
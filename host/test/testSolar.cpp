@@ -0,0 +1,78 @@
+// A solar slot is freed only after its item has been removed, so a schedule registered in between neither takes it
+// nor changes the timespan against which the old item is still checked. The tick that calculates the timespans
+// allocates nothing, also when it builds the year table (CONFIG_SCHEDULER_SOLAR_TABLE)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME  1718877600  // Thu Jun 20 2024 10:00:00 UTC
+
+typedef struct {
+  uint32_t value;
+  uint8_t state;
+} testTransition_t;
+
+static std::vector<testTransition_t> _testLog;
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id == RE_TIME_TIMESPAN_BATCH) {
+    schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+    for (uint32_t i = 0; i < batch->count; i++) {
+      _testLog.push_back({ batch->items[i].value, batch->items[i].state });
+    };
+  };
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler, nullptr);
+  TEST_CHECK(schedulerInit());
+  schedulerSolarSetLocation(51.5, 0.0);
+  TEST_CHECK(schedulerStart(false));
+
+  // From sunrise to sunset: ON at 10:00 in June
+  const schedulerSolar_t day = { SCHEDULER_SOLAR_SUNRISE, SCHEDULER_SOLAR_SUNSET, 0, 0 };
+  schedulerHandle_t old = schedulerRegisterSolar(&day, 1);
+  TEST_CHECK(old != SCHEDULER_HANDLE_INVALID);
+  schedulerPortStatsReset();
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  schedulerPortStats_t port;
+  schedulerPortStats(&port);
+  TEST_CHECK(port.allocs == 0);
+  uint32_t tables = 0;
+  schedulerSolarStats(nullptr, &tables);
+  TEST_CHECK(tables == (CONFIG_SCHEDULER_SOLAR_TABLE ? 1 : 0));
+  TEST_CHECK((_testLog.size() == 1) && (_testLog[0].value == 1) && (_testLog[0].state == 1));
+  TEST_CHECK(schedulerSolarTimespan(old) != 0);
+
+  // The only slot is still in use until the next tick removes the item
+  _testLog.clear();
+  TEST_CHECK(schedulerUnregister(old));
+  const schedulerSolar_t night = { SCHEDULER_SOLAR_SUNSET, SCHEDULER_SOLAR_SUNRISE, 0, 0 };
+  TEST_CHECK(schedulerRegisterSolar(&night, 2) == SCHEDULER_HANDLE_INVALID);
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  schedulerHandle_t handle = schedulerRegisterSolar(&night, 2);
+  TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+  TEST_CHECK(schedulerSolarTimespan(old) == 0);
+
+  // Nothing is posted for the removed schedule, the new one is OFF in the daytime
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  TEST_CHECK((_testLog.size() == 1) && (_testLog[0].value == 2) && (_testLog[0].state == 0));
+
+  schedulerDelete();
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler);
+  schedulerPortStop();
+  return TEST_RESULT();
+}
@@ -0,0 +1,77 @@
+// Packed timespans: schedulerSpanEvaluate() gives the same state as checkTimespan() for every item at every minute of
+// a day, including empty timespans, begin = end, midnight and malformed values; counts that are not a multiple of 32
+// leave the rest of the last word clear
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "reScheduler.cpp"
+#include "testCheck.h"
+
+static uint32_t testRandom(uint32_t* seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7FFF;
+}
+
+static timespan_t testTimespan(uint32_t* seed)
+{
+  uint32_t begin = (testRandom(seed) % 24) * 100 + testRandom(seed) % 60;
+  uint32_t end = (testRandom(seed) % 24) * 100 + testRandom(seed) % 60;
+  switch (testRandom(seed) % 10) {
+    case 0: return 0;
+    case 1: return begin * 10000 + begin;
+    case 2: return (testRandom(seed) << 17) ^ (testRandom(seed) << 2) ^ testRandom(seed);
+    case 3: return begin * 10000;
+    case 4: return end;
+    case 5: return 0xFFFFFFFF - testRandom(seed);
+    default: return begin * 10000 + end;
+  };
+}
+
+static void testCount(uint32_t count)
+{
+  uint32_t seed = count;
+  std::vector<timespan_t> timespans(count);
+  std::vector<uint16_t> begin(count), end(count);
+  std::vector<uint32_t> bits(SCHEDULER_BITSET_WORDS(count));
+  _schedulerSpanBegin = begin.data();
+  _schedulerSpanEnd = end.data();
+  for (uint32_t i = 0; i < count; i++) {
+    timespans[i] = testTimespan(&seed);
+    schedulerSpanPack(i, timespans[i]);
+  };
+  _schedulerSpanBegin = nullptr;
+  _schedulerSpanEnd = nullptr;
+
+  uint32_t mismatches = 0;
+  for (uint32_t minute = 0; minute < 1440; minute++) {
+    struct tm local = { 0 };
+    local.tm_hour = minute / 60;
+    local.tm_min = minute % 60;
+    for (uint32_t& word : bits) {
+      word = 0xFFFFFFFF;
+    };
+    schedulerSpanEvaluate(begin.data(), end.data(), count, local.tm_hour * 100 + local.tm_min, bits.data());
+    for (uint32_t i = 0; i < count; i++) {
+      bool state = (bits[i / 32] >> (i % 32)) & 1;
+      if (state != checkTimespan(&local, timespans[i])) {
+        if (mismatches++ == 0) {
+          fprintf(stderr, "%u items, %02d:%02d, timespan %u: %d\n", count, local.tm_hour, local.tm_min, timespans[i], state);
+        };
+      };
+    };
+    if (count % 32) {
+      TEST_CHECK((bits.back() >> (count % 32)) == 0);
+    };
+  };
+  TEST_CHECK(mismatches == 0);
+}
+
+int main()
+{
+  for (uint32_t count : { 1u, 31u, 32u, 33u, 1000u, 10007u }) {
+    testCount(count);
+  };
+  return TEST_RESULT();
+}
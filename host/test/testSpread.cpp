@@ -0,0 +1,138 @@
+// Load smoothing: deferred transitions are posted after the delay of the device, no more than CONFIG_SCHEDULER_SPREAD_RATE
+// per round and never with a timeout; when the event queue is full, the rest waits for the next round and nothing is lost
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_BOOT_TIME    1700035170  // Wed Nov 15 2023 07:59:30 UTC
+#define TEST_EDGE_TIME    1700035200  // 08:00:00
+#define TEST_ITEMS        50
+#define TEST_IMMEDIATE    2
+#define TEST_SECONDS      60
+
+static timespan_t _testTimespan = 8000900;
+static uint32_t _testOn[TEST_ITEMS + TEST_IMMEDIATE];
+static int64_t _testOnTime[TEST_ITEMS + TEST_IMMEDIATE];  // Milliseconds after 08:00
+static uint32_t _testPerSecond[TEST_SECONDS];
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id != RE_TIME_TIMESPAN_BATCH) return;
+  struct timeval now;
+  schedPortWallTime(&now);
+  int64_t ms = ((int64_t)now.tv_sec - TEST_EDGE_TIME) * 1000 + now.tv_usec / 1000;
+  schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    uint32_t value = batch->items[i].value;
+    if (batch->items[i].state && (value < TEST_ITEMS + TEST_IMMEDIATE)) {
+      _testOn[value]++;
+      _testOnTime[value] = ms;
+      if ((ms >= 0) && (ms < TEST_SECONDS * 1000)) {
+        _testPerSecond[ms / 1000]++;
+      };
+    };
+  };
+}
+
+// Start of a device whose delay leaves at least two seconds after the boundary; returns the delay
+static uint32_t testStart(uint32_t* device)
+{
+  memset(_testOn, 0, sizeof(_testOn));
+  memset(_testPerSecond, 0, sizeof(_testPerSecond));
+  schedulerSpreadStats_t stats;
+  do {
+    schedulerPortSetDeviceId((*device)++);
+    TEST_CHECK(schedulerPortStart(true));
+    schedulerPortSetTime(TEST_BOOT_TIME);
+    TEST_CHECK(schedulerStart(false));
+    schedulerSpreadStats(&stats);
+    if (stats.delay_ms < 2000) {
+      schedulerDelete();
+      schedulerPortStop();
+    };
+  } while (stats.delay_ms < 2000);
+  for (uint32_t i = 0; i < TEST_ITEMS + TEST_IMMEDIATE; i++) {
+    schedulerHandle_t handle = schedulerRegister(&_testTimespan, i);
+    TEST_CHECK(handle != SCHEDULER_HANDLE_INVALID);
+    if (i >= TEST_ITEMS) {
+      TEST_CHECK(schedulerSetFlags(handle, SCHEDULER_FLAG_IMMEDIATE));
+    };
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler, nullptr);
+  // The states posted by the first tick are dispatched before the boundary
+  schedulerPortAdvance(30 * 1000000LL - 500000);
+  memset(_testOn, 0, sizeof(_testOn));
+  return stats.delay_ms;
+}
+
+static void testStop()
+{
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+// Every transition at 08:00 was posted once: the immediate ones in the first second, the others after the delay
+static void testDelivered(uint32_t delay_ms)
+{
+  for (uint32_t i = 0; i < TEST_ITEMS + TEST_IMMEDIATE; i++) {
+    TEST_CHECK(_testOn[i] == 1);
+    if (i < TEST_ITEMS) {
+      TEST_CHECK(_testOnTime[i] >= delay_ms);
+    } else {
+      TEST_CHECK(_testOnTime[i] < 1000);
+    };
+  };
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  uint32_t device = 1;
+
+  // Rounds of the dispatch timer: the rate is kept and no post waits for a free place in the queue
+  uint32_t delay_ms = testStart(&device);
+  schedulerPortAdvance(1000000);
+  schedulerPortStatsReset();
+  schedulerPortAdvance((TEST_SECONDS - 2) * 1000000LL);
+  schedulerPortStats_t port;
+  schedulerPortStats(&port);
+  TEST_CHECK(port.posts > 0);
+  TEST_CHECK(port.timer_waits == 0);
+  testDelivered(delay_ms);
+  uint32_t seconds = 0;
+  for (uint32_t s = 1; s < TEST_SECONDS; s++) {
+    TEST_CHECK(_testPerSecond[s] <= CONFIG_SCHEDULER_SPREAD_RATE);
+    seconds += _testPerSecond[s] > 0 ? 1 : 0;
+  };
+  TEST_CHECK(seconds == (TEST_ITEMS + CONFIG_SCHEDULER_SPREAD_RATE - 1) / CONFIG_SCHEDULER_SPREAD_RATE);
+  schedulerSpreadStats_t stats;
+  schedulerSpreadStats(&stats);
+  TEST_CHECK(stats.overflows == 0);
+  TEST_CHECK(stats.stalls == 0);
+  testStop();
+
+  // The event queue is full when the first round comes: it is repeated a second later
+  delay_ms = testStart(&device);
+  schedulerPortAdvance(1000000);
+  uint32_t filler = 0;
+  while (eventLoopPost(RE_TIME_EVENTS, RE_TIME_EVERY_MINUTE, &filler, sizeof(filler), 0)) {
+    filler++;
+  };
+  schedulerPortAdvance((TEST_SECONDS - 2) * 1000000LL);
+  testDelivered(delay_ms);
+  uint32_t first = TEST_SECONDS * 1000;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    if (_testOnTime[i] < first) first = _testOnTime[i];
+  };
+  TEST_CHECK(first >= delay_ms + 1000);
+  schedulerSpreadStats(&stats);
+  TEST_CHECK(stats.stalls == 1);
+  testStop();
+  return TEST_RESULT();
+}
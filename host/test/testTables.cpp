@@ -0,0 +1,177 @@
+// Static tables: the same transitions as the timespans registered at runtime, over a week with a change of DST and
+// after steps of the clock; registration of a table does not allocate memory
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_WEEK_START   1711580400  // Thu Mar 28 2024 00:00:00 CET, the week over the change to CEST
+#define TEST_DAY_START    1700006400  // Wed Nov 15 2023 00:00:00 UTC
+
+SCHEDULER_TABLE(testTable,
+  { 1000600, 1 },     // 01:00 - 06:00
+  { 2000300, 2 },     // 02:00 - 03:00, the hour skipped at the change of DST
+  { 2300130, 3 },     // 23:00 - 01:30, through midnight
+  { 7150745, 4 },
+  { 8000800, 5 },     // Begin = end: always on
+  { 9301000, 6 },
+  { 10001100, 7 },
+  { 12001230, 8 },
+  { 13451415, 9 },
+  { 17002200, 10 },
+  { 18301830, 11 },
+  { 22000100, 12 }
+);
+
+typedef struct {
+  int64_t time;
+  uint32_t value;
+  uint8_t state;
+} testTransition_t;
+
+static std::vector<testTransition_t> _testLog;
+
+static void testReplayLog(const schedulerReplayRecord_t* record, void* arg)
+{
+  if ((record->event == RE_TIME_TIMESPAN_ON) || (record->event == RE_TIME_TIMESPAN_OFF)) {
+    _testLog.push_back({ record->time, record->value, (uint8_t)(record->event == RE_TIME_TIMESPAN_ON) });
+  };
+}
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id == RE_TIME_TIMESPAN_BATCH) {
+    schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+    for (uint32_t i = 0; i < batch->count; i++) {
+      _testLog.push_back({ batch->time, batch->items[i].value, batch->items[i].state });
+    };
+  };
+}
+
+static bool testLess(const testTransition_t& a, const testTransition_t& b)
+{
+  return (a.time < b.time) || ((a.time == b.time) && (a.value < b.value));
+}
+
+static bool testEqual(std::vector<testTransition_t> a, std::vector<testTransition_t> b)
+{
+  std::sort(a.begin(), a.end(), testLess);
+  std::sort(b.begin(), b.end(), testLess);
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if ((a[i].time != b[i].time) || (a[i].value != b[i].value) || (a[i].state != b[i].state)) return false;
+  };
+  return true;
+}
+
+static const testTransition_t* testFind(uint32_t value, uint8_t state)
+{
+  for (const testTransition_t& transition : _testLog) {
+    if ((transition.value == value) && (transition.state == state)) return &transition;
+  };
+  return nullptr;
+}
+
+// A week of replay: a table and the same timespans registered at runtime
+static void testReplayEquivalence()
+{
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  static timespan_t runtime[sizeof(testTableItems) / sizeof(testTableItems[0])];
+  schedulerReplayStats_t stats;
+
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_WEEK_START);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < testTable.count; i++) {
+    runtime[i] = testTableItems[i].timespan;
+    TEST_CHECK(schedulerRegister(&runtime[i], testTableItems[i].value) != SCHEDULER_HANDLE_INVALID);
+  };
+  _testLog.clear();
+  TEST_CHECK(schedulerReplay(TEST_WEEK_START, TEST_WEEK_START + 7 * 86400, testReplayLog, nullptr, &stats));
+  std::vector<testTransition_t> expected = _testLog;
+  schedulerFree();
+  schedulerPortStop();
+
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_WEEK_START);
+  TEST_CHECK(schedulerInit());
+  TEST_CHECK(schedulerTableRegister(&testTable));
+  _testLog.clear();
+  TEST_CHECK(schedulerReplay(TEST_WEEK_START, TEST_WEEK_START + 7 * 86400, testReplayLog, nullptr, &stats));
+  TEST_CHECK(expected.size() > 7 * 2 * 10);
+  TEST_CHECK(testEqual(expected, _testLog));
+  uint32_t items, checks;
+  schedulerTablesStats(&items, &checks);
+  TEST_CHECK(items == testTable.count);
+  TEST_CHECK(checks < stats.ticks / 10);
+
+  // The states are restored after a replay, so the same replay gives the same log
+  std::vector<testTransition_t> first = _testLog;
+  _testLog.clear();
+  TEST_CHECK(schedulerReplay(TEST_WEEK_START, TEST_WEEK_START + 7 * 86400, testReplayLog, nullptr, &stats));
+  TEST_CHECK(testEqual(first, _testLog));
+  schedulerFree();
+  schedulerPortStop();
+}
+
+// Steps of the clock forward over the minutes of the table: the states are caught up on the next tick
+static void testClockStep()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_DAY_START + 9 * 3600 + 50 * 60);  // 09:50
+  TEST_CHECK(schedulerInit());
+  schedulerPortStatsReset();
+  TEST_CHECK(schedulerTableRegister(&testTable));
+  schedulerPortStats_t portStats;
+  schedulerPortStats(&portStats);
+  TEST_CHECK(portStats.allocs == 0);
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler, nullptr);
+  TEST_CHECK(schedulerStart(false));
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+
+  // 09:51 -> 10:20: item 6 (09:30 - 10:00) ends, item 7 (10:00 - 11:00) begins, both minutes are skipped.
+  // The timer keeps its deadline on the monotonic clock, so the next tick comes a minute later
+  _testLog.clear();
+  schedulerPortSetTime(TEST_DAY_START + 10 * 3600 + 19 * 60);
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  const testTransition_t* off = testFind(6, 0);
+  const testTransition_t* on = testFind(7, 1);
+  TEST_CHECK(off && (off->time == TEST_DAY_START + 10 * 3600 + 20 * 60));
+  TEST_CHECK(on && (on->time == TEST_DAY_START + 10 * 3600 + 20 * 60));
+  TEST_CHECK(_testLog.size() == 2);
+
+  // Almost a whole day forward: 10:20 -> 10:00 of the next day, the states are the same
+  _testLog.clear();
+  schedulerPortSetTime(TEST_DAY_START + 86400 + 9 * 3600 + 59 * 60);
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  TEST_CHECK(_testLog.empty());
+
+  // 10:00 -> 13:50 of the same day: items 7 and 8 (12:00 - 12:30) end, 9 (13:45 - 14:15) begins
+  schedulerPortSetTime(TEST_DAY_START + 86400 + 13 * 3600 + 49 * 60);
+  schedulerPortAdvance(60000000);
+  schedulerPortDispatch();
+  TEST_CHECK(testFind(7, 0) && testFind(9, 1));
+  TEST_CHECK(!testFind(8, 1) && !testFind(8, 0));
+  TEST_CHECK(_testLog.size() == 2);
+
+  schedulerDelete();
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler);
+  schedulerPortStop();
+}
+
+int main()
+{
+  testReplayEquivalence();
+  testClockStep();
+  return TEST_RESULT();
+}
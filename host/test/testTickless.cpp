@@ -0,0 +1,101 @@
+// Tickless timer: over a day, the wakeups and the skipped minutes add up to the minutes of the day, also when other
+// tasks wake the timer early many times; early wakeups neither process a minute twice nor lose a transition
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700006430  // Wed Nov 15 2023 00:00:30 UTC
+#define TEST_ITEMS        20
+#define TEST_SECOND       1000000LL
+
+typedef struct {
+  time_t time;
+  uint32_t value;
+  bool state;
+} testTransition_t;
+
+static timespan_t _testTimespans[TEST_ITEMS];
+static std::vector<testTransition_t> _testTransitions;
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  schedulerTransitions_t* batch = (schedulerTransitions_t*)event_data;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    _testTransitions.push_back({ (time_t)batch->time, batch->items[i].value, batch->items[i].state != 0 });
+  };
+}
+
+// A day from 00:00:30 to 00:00:30 of the next day, the last wakeup is at 00:00 (every hour has one); the timer is woken
+// up early every wake_s seconds (0 - never) by a subscription to the hour that changes nothing
+static std::vector<testTransition_t> testDay(uint32_t wake_s, uint32_t* wakeups, uint32_t* skipped)
+{
+  _testTransitions.clear();
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(TEST_START_TIME);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    TEST_CHECK(schedulerRegister(&_testTimespans[i], i) != SCHEDULER_HANDLE_INVALID);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, testBatchHandler, nullptr);
+  TEST_CHECK(schedulerStart(false));
+  uint32_t wakeups0 = 0, skipped0 = 0;
+  schedulerTicklessStats(&wakeups0, &skipped0);
+  if (wake_s > 0) {
+    for (uint32_t s = 0; s < 24 * 3600; s += wake_s) {
+      schedulerPortAdvance(wake_s * TEST_SECOND);
+      TEST_CHECK(schedulerBoundarySubscribe(60));
+      schedulerBoundaryUnsubscribe(60);
+    };
+  } else {
+    schedulerPortAdvance(24 * 3600 * TEST_SECOND);
+  };
+  schedulerPortDispatch();
+  schedulerTicklessStats(wakeups, skipped);
+  *wakeups -= wakeups0;
+  *skipped -= skipped0;
+  schedulerTimingStats_t timing;
+  schedulerTimingStats(&timing);
+  TEST_CHECK(timing.missed == 0);
+  eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_TIMESPAN_BATCH, testBatchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+  return _testTransitions;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _testTimespans[i] = begin * 10000 + end;
+  };
+
+  uint32_t wakeups = 0, skipped = 0;
+  std::vector<testTransition_t> quiet = testDay(0, &wakeups, &skipped);
+  TEST_CHECK(wakeups + skipped == 24 * 60 + 1);
+  TEST_CHECK(wakeups < 24 * 60 / 4);
+
+  // Early wakeups every 5 minutes and every 17 seconds
+  const uint32_t wakes[] = { 300, 17 };
+  for (uint32_t wake_s : wakes) {
+    std::vector<testTransition_t> woken = testDay(wake_s, &wakeups, &skipped);
+    TEST_CHECK(wakeups + skipped == 24 * 60 + 1);
+    TEST_CHECK(woken.size() == quiet.size());
+    for (size_t i = 0; (i < woken.size()) && (i < quiet.size()); i++) {
+      TEST_CHECK(woken[i].time - woken[i].time % 60 == quiet[i].time - quiet[i].time % 60);
+      TEST_CHECK(woken[i].value == quiet[i].value);
+      TEST_CHECK(woken[i].state == quiet[i].state);
+    };
+  };
+  return TEST_RESULT();
+}
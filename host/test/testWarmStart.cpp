@@ -0,0 +1,122 @@
+// Warm start: a cold boot posts the state of every item; after a restart with the saved states only the items whose
+// state differs between the time of the snapshot and the time of the boot are posted; snapshots are written no more
+// often than once per CONFIG_SCHEDULER_WARMSTART_INTERVAL, never by the timer callback and without allocations
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+#include "testCheck.h"
+
+#define TEST_START_TIME   1700000010  // Tue Nov 14 2023 22:13:30 UTC
+#define TEST_ITEMS        1000
+
+static timespan_t _testTimespans[TEST_ITEMS];
+static uint32_t _testPosted = 0;
+
+static void testBatchHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  if (event_id == RE_TIME_TIMESPAN_BATCH) {
+    _testPosted += ((schedulerTransitions_t*)event_data)->count;
+  };
+}
+
+// Start of the scheduler at the given time: returns the number of states posted by the first tick
+static uint32_t testBoot(time_t time)
+{
+  TEST_CHECK(schedulerPortStart(true));
+  schedulerPortSetTime(time);
+  TEST_CHECK(schedulerInit());
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    TEST_CHECK(schedulerRegister(&_testTimespans[i], 1000 + i) != SCHEDULER_HANDLE_INVALID);
+  };
+  eventHandlerRegister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler, nullptr);
+  _testPosted = 0;
+  TEST_CHECK(schedulerStart(false));
+  schedulerPortAdvance(1000000);
+  schedulerPortDispatch();
+  return _testPosted;
+}
+
+static void testShutdown()
+{
+  eventHandlerUnregister(RE_TIME_EVENTS, ESP_EVENT_ANY_ID, testBatchHandler);
+  schedulerDelete();
+  schedulerPortStop();
+}
+
+// Items whose state differs between two times
+static uint32_t testChanged(time_t a, time_t b)
+{
+  struct tm localA, localB;
+  localtime_r(&a, &localA);
+  localtime_r(&b, &localB);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    if (checkTimespan(&localA, _testTimespans[i]) != checkTimespan(&localB, _testTimespans[i])) count++;
+  };
+  return count;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < TEST_ITEMS; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t begin = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    seed = seed * 1103515245 + 12345;
+    uint32_t end = ((seed >> 8) % 24) * 100 + (seed >> 16) % 60;
+    _testTimespans[i] = begin * 10000 + end;
+  };
+  schedulerPortStoreClear();
+
+  // Cold boot, 20 minutes of running, then a forced snapshot: it is written before the call returns
+  TEST_CHECK(testBoot(TEST_START_TIME) == TEST_ITEMS);
+  schedulerPortAdvance(20 * 60 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerPortStats_t port;
+  schedulerPortStatsReset();
+  schedulerWarmStartSave();
+  schedulerPortStats(&port);
+  TEST_CHECK(port.store_writes == 1);
+  struct timeval now;
+  schedPortWallTime(&now);
+  time_t saved = now.tv_sec - now.tv_sec % 60;
+  testShutdown();
+
+  // Warm boots after different gaps
+  const uint32_t gaps[] = { 0, 7, 95, 600 };
+  for (uint32_t gap : gaps) {
+    time_t boot = saved + gap * 60;
+    uint32_t posted = testBoot(boot + 10);
+    TEST_CHECK(posted == testChanged(saved, boot));
+    if (gap == 0) {
+      TEST_CHECK(posted == 0);
+    };
+    schedulerWarmStartStats_t stats;
+    schedulerWarmStartStats(&stats);
+    TEST_CHECK(stats.loaded == TEST_ITEMS);
+    TEST_CHECK(stats.restored == TEST_ITEMS);
+    testShutdown();
+  };
+
+  // An hour of running: no more than one snapshot per interval
+  testBoot(saved + 10);
+  schedulerPortStatsReset();
+  schedulerPortAdvance(3600 * 1000000LL);
+  schedulerPortDispatch();
+  schedulerPortStats(&port);
+  TEST_CHECK(port.store_writes > 0);
+  TEST_CHECK(port.store_writes <= 3600 / CONFIG_SCHEDULER_WARMSTART_INTERVAL + 1);
+  TEST_CHECK(port.store_writes_timer == 0);
+  TEST_CHECK(port.allocs == 0);
+  testShutdown();
+
+  // Without saved states the boot is cold again
+  schedulerPortStoreClear();
+  TEST_CHECK(testBoot(TEST_START_TIME) == TEST_ITEMS);
+  testShutdown();
+  return TEST_RESULT();
+}
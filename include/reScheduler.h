@@ -9,20 +9,503 @@
 #ifndef __RE_SCHEDULER_H__
 #define __RE_SCHEDULER_H__
 
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
 #include <stdbool.h>
 #include "rTypes.h"
 #include "project_config.h"
 #include "def_consts.h"
 
+// Tickless mode: the main timer does not wake up every minute, but only at the next instant that needs processing
+#ifndef CONFIG_SCHEDULER_TICKLESS
+#define CONFIG_SCHEDULER_TICKLESS 0
+#endif // CONFIG_SCHEDULER_TICKLESS
+
+// Boundary events: the start of the hour, day, week, month and year is also posted only while it has subscribers 
+// (schedulerBoundarySubscribe()), as the every-minute and the N-minute events always are
+#ifndef CONFIG_SCHEDULER_BOUNDARIES
+#define CONFIG_SCHEDULER_BOUNDARIES 0
+#endif // CONFIG_SCHEDULER_BOUNDARIES
+
+// Start of an interval of N minutes (N divides 60, from 2 to 30), data: int minute (as RE_TIME_EVERY_MINUTE)
+#define RE_TIME_EVERY_MINUTES(n) (0x0110 + (n))
+
+// Initial capacity of the pool of scheduler items (the pool grows twice when it is full)
+#ifndef CONFIG_SCHEDULER_POOL_SIZE
+#define CONFIG_SCHEDULER_POOL_SIZE 16
+#endif // CONFIG_SCHEDULER_POOL_SIZE
+// Maximum number of scheduler items; above 65535 the queue of the pool uses 32-bit indexes (4 more bytes per item)
+#ifndef CONFIG_SCHEDULER_POOL_MAX
+#define CONFIG_SCHEDULER_POOL_MAX 65535
+#endif // CONFIG_SCHEDULER_POOL_MAX
+
+// Batched transitions: all ON/OFF transitions of one tick are posted as RE_TIME_TIMESPAN_BATCH events 
+// (no more than CONFIG_SCHEDULER_BATCH_SIZE transitions per event) instead of RE_TIME_TIMESPAN_ON / RE_TIME_TIMESPAN_OFF
+#ifndef CONFIG_SCHEDULER_BATCH_EVENTS
+#define CONFIG_SCHEDULER_BATCH_EVENTS 0
+#endif // CONFIG_SCHEDULER_BATCH_EVENTS
+#ifndef CONFIG_SCHEDULER_BATCH_SIZE
+#define CONFIG_SCHEDULER_BATCH_SIZE 32
+#endif // CONFIG_SCHEDULER_BATCH_SIZE
+
+#define RE_TIME_TIMESPAN_BATCH 0x0100
+
+// Counters and histograms of the scheduler; with CONFIG_SCHEDULER_STATS_PUBLISH a copy of schedulerStats_t
+// is posted as RE_TIME_SCHEDULER_STATS each time the system information is published
+#ifndef CONFIG_SCHEDULER_STATS
+#define CONFIG_SCHEDULER_STATS 0
+#endif // CONFIG_SCHEDULER_STATS
+#ifndef CONFIG_SCHEDULER_STATS_PUBLISH
+#define CONFIG_SCHEDULER_STATS_PUBLISH 0
+#endif // CONFIG_SCHEDULER_STATS_PUBLISH
+
+#define RE_TIME_SCHEDULER_STATS 0x0101
+// Cron schedule has fired, data: uint32_t value passed to schedulerRegisterCron()
+#define RE_TIME_CRON 0x0102
+
+// Worker task: the esp_timer callback only queues the tick time, schedules are processed and events are posted by the worker
+#ifndef CONFIG_SCHEDULER_WORKER
+#define CONFIG_SCHEDULER_WORKER 0
+#endif // CONFIG_SCHEDULER_WORKER
+#ifndef CONFIG_SCHEDULER_WORKER_PRIORITY
+#define CONFIG_SCHEDULER_WORKER_PRIORITY 5
+#endif // CONFIG_SCHEDULER_WORKER_PRIORITY
+#ifndef CONFIG_SCHEDULER_WORKER_STACK_SIZE
+#define CONFIG_SCHEDULER_WORKER_STACK_SIZE 4096
+#endif // CONFIG_SCHEDULER_WORKER_STACK_SIZE
+#ifndef CONFIG_SCHEDULER_WORKER_CORE
+#define CONFIG_SCHEDULER_WORKER_CORE -1    // -1: no affinity
+#endif // CONFIG_SCHEDULER_WORKER_CORE
+
+// Shards: the full check of all items (at the start, after clock jumps and changes of parameters) and the check of the items 
+// due at the same minute are split between the task of the timer and CONFIG_SCHEDULER_SHARDS - 1 helper tasks on other cores 
+// (threads on a host). The calling task then posts the results in the same order as without shards. Batches smaller 
+// than CONFIG_SCHEDULER_SHARDS_MIN items are checked by the calling task alone. A custom clock must be thread-safe
+#ifndef CONFIG_SCHEDULER_SHARDS
+#define CONFIG_SCHEDULER_SHARDS 1          // No more than 8
+#endif // CONFIG_SCHEDULER_SHARDS
+#ifndef CONFIG_SCHEDULER_SHARDS_MIN
+#define CONFIG_SCHEDULER_SHARDS_MIN 256
+#endif // CONFIG_SCHEDULER_SHARDS_MIN
+#ifndef CONFIG_SCHEDULER_SHARDS_PRIORITY
+#define CONFIG_SCHEDULER_SHARDS_PRIORITY CONFIG_SCHEDULER_WORKER_PRIORITY
+#endif // CONFIG_SCHEDULER_SHARDS_PRIORITY
+#ifndef CONFIG_SCHEDULER_SHARDS_STACK_SIZE
+#define CONFIG_SCHEDULER_SHARDS_STACK_SIZE 3072
+#endif // CONFIG_SCHEDULER_SHARDS_STACK_SIZE
+
+// Local time of ticks is calculated from a cached table of UTC offsets instead of localtime_r()
+#ifndef CONFIG_SCHEDULER_CALENDAR
+#define CONFIG_SCHEDULER_CALENDAR 0
+#endif // CONFIG_SCHEDULER_CALENDAR
+
+// Warm start: states of timespans are saved to NVS and restored by schedulerStart(), so that after a restart events
+// are posted only for the states that have really changed. Items are identified by their values. Saved states are 
+// applied to the items registered within CONFIG_SCHEDULER_WARMSTART_INTERVAL seconds after the start; after that 
+// the states are saved no more often than once per CONFIG_SCHEDULER_WARMSTART_INTERVAL seconds and only if they differ
+#ifndef CONFIG_SCHEDULER_WARMSTART
+#define CONFIG_SCHEDULER_WARMSTART 0
+#endif // CONFIG_SCHEDULER_WARMSTART
+#ifndef CONFIG_SCHEDULER_WARMSTART_INTERVAL
+#define CONFIG_SCHEDULER_WARMSTART_INTERVAL 300
+#endif // CONFIG_SCHEDULER_WARMSTART_INTERVAL
+
+// Posted by the timer so that the states are written to NVS in the event loop task (without the worker), no data
+#define RE_TIME_WARMSTART_SAVE 0x0103
+
+// Periodic jobs: callbacks called by one shared timer (in the esp_timer task). A job may be delayed by its slack, so that 
+// jobs with close deadlines are served by one wakeup. The system information and the task list are published by such jobs
+#ifndef CONFIG_SCHEDULER_JOBS_MAX
+#define CONFIG_SCHEDULER_JOBS_MAX 8
+#endif // CONFIG_SCHEDULER_JOBS_MAX
+#ifndef SCHEDULER_JOBS_SLACK_DIVIDER
+#define SCHEDULER_JOBS_SLACK_DIVIDER 10    // Slack of the built-in jobs: 1/10 of the interval
+#endif // SCHEDULER_JOBS_SLACK_DIVIDER
+
+// Load smoothing: events of schedules (except for items with SCHEDULER_FLAG_IMMEDIATE) and the publication of the date and time 
+// are delayed after the boundary by 0...CONFIG_SCHEDULER_SPREAD_MAX_MS, individually for every device (derived from the MAC address), 
+// and posted no more than CONFIG_SCHEDULER_SPREAD_RATE per second (0 - no limit). Built-in periodic jobs get the same delay as their phase
+#ifndef CONFIG_SCHEDULER_SPREAD
+#define CONFIG_SCHEDULER_SPREAD 0
+#endif // CONFIG_SCHEDULER_SPREAD
+#ifndef CONFIG_SCHEDULER_SPREAD_MAX_MS
+#define CONFIG_SCHEDULER_SPREAD_MAX_MS 30000
+#endif // CONFIG_SCHEDULER_SPREAD_MAX_MS
+#ifndef CONFIG_SCHEDULER_SPREAD_RATE
+#define CONFIG_SCHEDULER_SPREAD_RATE 20
+#endif // CONFIG_SCHEDULER_SPREAD_RATE
+#ifndef CONFIG_SCHEDULER_SPREAD_QUEUE
+#define CONFIG_SCHEDULER_SPREAD_QUEUE 128  // Events that do not fit are posted without delay
+#endif // CONFIG_SCHEDULER_SPREAD_QUEUE
+
+// Modes (silent, eco, peak tariff...): each one is bound to a timespan; their states are bits of one word that can be read from 
+// any task or ISR, changes are signaled by an event group (schedulerModesWait()). Silent mode is one of them
+#ifndef CONFIG_SCHEDULER_MODES_MAX
+#define CONFIG_SCHEDULER_MODES_MAX 4       // No more than 12: an event group has bits for both states of every mode
+#endif // CONFIG_SCHEDULER_MODES_MAX
+
+// Forecast: schedulerForecast() calculates the upcoming transitions of items from their timespans and cron schedules 
+// (edge to edge, not minute by minute). The transitions of all items for the requested window are kept until the registry, 
+// the clock or the parameters change; CONFIG_SCHEDULER_FORECAST_SIZE is the capacity of this cache
+#ifndef CONFIG_SCHEDULER_FORECAST
+#define CONFIG_SCHEDULER_FORECAST 0
+#endif // CONFIG_SCHEDULER_FORECAST
+#ifndef CONFIG_SCHEDULER_FORECAST_SIZE
+#define CONFIG_SCHEDULER_FORECAST_SIZE 128
+#endif // CONFIG_SCHEDULER_FORECAST_SIZE
+
+// Solar schedules: timespans bound to sunrise, sunset, twilight or noon (with offsets in minutes) at the location set by 
+// CONFIG_SCHEDULER_SOLAR_LATITUDE and CONFIG_SCHEDULER_SOLAR_LONGITUDE (degrees, north and east are positive; both can be 
+// changed through reParams). The times are calculated once a day, by the tick of the start of the day, so a tick costs the 
+// same as for a fixed timespan; with CONFIG_SCHEDULER_SOLAR_TABLE they are calculated for the whole year at once and kept 
+// in a table (8 bytes per day, allocated by the first schedulerRegisterSolar())
+#ifndef CONFIG_SCHEDULER_SOLAR
+#define CONFIG_SCHEDULER_SOLAR 0
+#endif // CONFIG_SCHEDULER_SOLAR
+#ifndef CONFIG_SCHEDULER_SOLAR_MAX
+#define CONFIG_SCHEDULER_SOLAR_MAX 8
+#endif // CONFIG_SCHEDULER_SOLAR_MAX
+#ifndef CONFIG_SCHEDULER_SOLAR_TABLE
+#define CONFIG_SCHEDULER_SOLAR_TABLE 0
+#endif // CONFIG_SCHEDULER_SOLAR_TABLE
+#ifndef CONFIG_SCHEDULER_SOLAR_LATITUDE
+#define CONFIG_SCHEDULER_SOLAR_LATITUDE 0.0
+#endif // CONFIG_SCHEDULER_SOLAR_LATITUDE
+#ifndef CONFIG_SCHEDULER_SOLAR_LONGITUDE
+#define CONFIG_SCHEDULER_SOLAR_LONGITUDE 0.0
+#endif // CONFIG_SCHEDULER_SOLAR_LONGITUDE
+#ifndef CONFIG_SCHEDULER_SOLAR_PGROUP_KEY
+#define CONFIG_SCHEDULER_SOLAR_PGROUP_KEY "location"
+#endif // CONFIG_SCHEDULER_SOLAR_PGROUP_KEY
+#ifndef CONFIG_SCHEDULER_SOLAR_PGROUP_TOPIC
+#define CONFIG_SCHEDULER_SOLAR_PGROUP_TOPIC "location"
+#endif // CONFIG_SCHEDULER_SOLAR_PGROUP_TOPIC
+#ifndef CONFIG_SCHEDULER_SOLAR_PGROUP_FRIENDLY
+#define CONFIG_SCHEDULER_SOLAR_PGROUP_FRIENDLY "Location"
+#endif // CONFIG_SCHEDULER_SOLAR_PGROUP_FRIENDLY
+#ifndef CONFIG_SCHEDULER_SOLAR_LATITUDE_TOPIC
+#define CONFIG_SCHEDULER_SOLAR_LATITUDE_TOPIC "latitude"
+#endif // CONFIG_SCHEDULER_SOLAR_LATITUDE_TOPIC
+#ifndef CONFIG_SCHEDULER_SOLAR_LATITUDE_FRIENDLY
+#define CONFIG_SCHEDULER_SOLAR_LATITUDE_FRIENDLY "Latitude"
+#endif // CONFIG_SCHEDULER_SOLAR_LATITUDE_FRIENDLY
+#ifndef CONFIG_SCHEDULER_SOLAR_LONGITUDE_TOPIC
+#define CONFIG_SCHEDULER_SOLAR_LONGITUDE_TOPIC "longitude"
+#endif // CONFIG_SCHEDULER_SOLAR_LONGITUDE_TOPIC
+#ifndef CONFIG_SCHEDULER_SOLAR_LONGITUDE_FRIENDLY
+#define CONFIG_SCHEDULER_SOLAR_LONGITUDE_FRIENDLY "Longitude"
+#endif // CONFIG_SCHEDULER_SOLAR_LONGITUDE_FRIENDLY
+
+// Static tables: fixed timespans declared by SCHEDULER_TABLE() (C++14 or later) are checked by the compiler and placed in 
+// flash together with the minutes of the day at which their states change; only the states take RAM (a bit per item). 
+// A table is added by one call of schedulerTableRegister() without any allocation and is checked only at those minutes
+#ifndef CONFIG_SCHEDULER_TABLES
+#define CONFIG_SCHEDULER_TABLES 0
+#endif // CONFIG_SCHEDULER_TABLES
+#ifndef CONFIG_SCHEDULER_TABLES_MAX
+#define CONFIG_SCHEDULER_TABLES_MAX 4
+#endif // CONFIG_SCHEDULER_TABLES_MAX
+
+// Replay: schedulerReplay() runs the minute ticks of a time range one after another without waiting, and writes every event 
+// and transition to a log instead of posting it (to check a configuration or to measure the throughput on a host)
+#ifndef CONFIG_SCHEDULER_REPLAY
+#define CONFIG_SCHEDULER_REPLAY 0
+#endif // CONFIG_SCHEDULER_REPLAY
+
+typedef struct {
+  uint32_t value;             // Value passed to schedulerRegister()
+  uint8_t state;              // New state: 1 - ON, 0 - OFF
+  uint8_t reserved[3];
+} schedulerTransition_t;
+
+typedef struct {
+  int64_t time;               // Time of the tick (unix time)
+  uint16_t count;             // Number of transitions in this event
+  uint16_t offset;            // Index of the first transition of this event among all transitions of the tick
+  uint16_t flags;             // SCHEDULER_TRANSITIONS_LAST for the last event of the tick
+  uint16_t item_size;         // sizeof(schedulerTransition_t)
+  schedulerTransition_t items[];
+} schedulerTransitions_t;
+
+#define SCHEDULER_TRANSITIONS_LAST 0x0001
+#define SCHEDULER_TRANSITIONS_SIZE(count) (sizeof(schedulerTransitions_t) + (count) * sizeof(schedulerTransition_t))
+
+// Boundaries of schedulerBoundarySubscribe() are given by their length in minutes: any divisor of 60 (RE_TIME_EVERY_MINUTE 
+// for 1, RE_TIME_EVERY_MINUTES(n) for the others) and the constants below (the month and the year by their longest length)
+#define SCHEDULER_BOUNDARY_MINUTE   1
+#define SCHEDULER_BOUNDARY_QUARTER  15
+#define SCHEDULER_BOUNDARY_HOUR     60           // RE_TIME_START_OF_HOUR
+#define SCHEDULER_BOUNDARY_DAY      1440         // RE_TIME_START_OF_DAY
+#define SCHEDULER_BOUNDARY_WEEK     10080        // RE_TIME_START_OF_WEEK
+#define SCHEDULER_BOUNDARY_MONTH    44640        // RE_TIME_START_OF_MONTH
+#define SCHEDULER_BOUNDARY_YEAR     527040       // RE_TIME_START_OF_YEAR
+
+typedef struct {
+  uint32_t posted;            // Boundary events posted
+  uint32_t saved;             // Events of the minute, hour, day, week, month and year that had no subscribers
+  uint32_t posted_day;        // The same for the previous day
+  uint32_t saved_day;
+} schedulerBoundaryStats_t;
+
+typedef struct {
+  uint32_t ticks;             // Ticks of the main timer
+  uint32_t late_last_us;      // Lateness of the last tick against the ideal minute boundary
+  uint32_t late_max_us;
+  uint32_t late_avg_us;
+  uint32_t missed;            // Minutes that were not processed in time (after stalls or clock jumps)
+  uint32_t replayed;          // Boundary events (START_OF_HOUR etc.) posted late for missed minutes
+  uint32_t resyncs;           // Corrections of the deadline after the wall clock was moved
+} schedulerTimingStats_t;
+
+#if CONFIG_SCHEDULER_STATS
+
+#define SCHEDULER_STATS_BUCKETS 8
+#define SCHEDULER_STATS_BUCKET_LIMIT(bucket) (64UL << (2 * (bucket)))   // Upper limit of the bucket, us
+
+typedef struct {
+  uint32_t ticks;
+  uint32_t items_evaluated;   // Items checked by checkTimespan()
+  uint32_t items_max;         // ...the most in one tick
+  uint32_t transitions;       // ON/OFF transitions
+  uint32_t transitions_max;   // ...the most in one tick
+  uint32_t posts;             // Events posted
+  uint32_t post_failures;     // Events that could not be posted (timeout or error)
+  uint32_t exec_max_us;
+  uint32_t exec_hist[SCHEDULER_STATS_BUCKETS];  // Time spent in processing of the tick
+  uint32_t late_hist[SCHEDULER_STATS_BUCKETS];  // Lateness of the main timer
+} schedulerStats_t;
+
+#endif // CONFIG_SCHEDULER_STATS
+
+#if CONFIG_SCHEDULER_SHARDS > 1
+
+typedef struct {
+  uint32_t shards;
+  uint32_t runs;              // Checks split between the shards
+  uint32_t items;             // Items checked by them
+  uint32_t eval_us;           // Time from the start of the shards to the end of the slowest one
+  uint32_t busy_us;           // Time spent by all shards together
+  uint32_t critical_us;       // Time of the slowest shards (eval_us without the overhead of waking up the helpers)
+  uint32_t merge_us;          // Time of posting the results by the calling task
+} schedulerShardsStats_t;
+
+#endif // CONFIG_SCHEDULER_SHARDS
+
+#if CONFIG_SCHEDULER_WARMSTART
+
+typedef struct {
+  uint32_t loaded;            // States read from NVS at the start
+  uint32_t restored;          // Items that got a saved state (events are posted only if it has changed)
+  uint32_t writes;            // Snapshots written to NVS
+  uint32_t skipped;           // Snapshots not written because nothing has changed since the previous one
+} schedulerWarmStartStats_t;
+
+#endif // CONFIG_SCHEDULER_WARMSTART
+
+#if CONFIG_SCHEDULER_SPREAD
+
+typedef struct {
+  uint32_t delay_ms;          // Delay of this device
+  uint32_t deferred;          // Events posted with the delay
+  uint32_t rounds;            // Calls of the dispatch timer
+  uint32_t queue_max;         // The longest queue of deferred events
+  uint32_t overflows;         // Events posted without delay because the queue was full
+  uint32_t stalls;            // Rounds ended early by a full event queue (the rest was left for the next round)
+} schedulerSpreadStats_t;
+
+#endif // CONFIG_SCHEDULER_SPREAD
+
+// Source of time for the scheduler: functions that are not set are replaced by gettimeofday() and localtime_r()
+typedef struct {
+  void (*wall_time)(struct timeval* now);
+  struct tm* (*local_time)(const time_t* time, struct tm* local);
+} schedulerClock_t;
+
+#if CONFIG_SCHEDULER_REPLAY
+
+typedef struct {
+  int64_t time;               // Time of the tick (unix time)
+  int32_t event;              // RE_TIME_* event
+  uint32_t value;             // Value of the schedule (handle for items with a callback) or int data of the event
+} schedulerReplayRecord_t;
+
+typedef void (*schedulerReplayLog_t)(const schedulerReplayRecord_t* record, void* arg);
+
+typedef struct {
+  uint32_t ticks;             // Simulated minutes
+  uint32_t events;            // Records written to the log
+  uint32_t transitions;       // ON/OFF transitions and cron matches among them
+  uint32_t elapsed_us;
+  uint32_t ticks_per_sec;
+} schedulerReplayStats_t;
+
+#endif // CONFIG_SCHEDULER_REPLAY
+
+// Cron-style schedule: "minute hour day-of-month month day-of-week", each field is a list of "*", "N", "N-M" 
+// with optional "/step"; day of week 0 or 7 is Sunday. Example: "*/15 8-18 * * 1-5"
+#define SCHEDULER_CRON_ANY_DAY      0x01
+#define SCHEDULER_CRON_ANY_WEEKDAY  0x02
+
+typedef struct {
+  uint64_t minutes;           // Bits 0...59
+  uint32_t hours;             // Bits 0...23
+  uint32_t days;              // Bits 1...31
+  uint16_t months;            // Bits 0...11 (as tm_mon)
+  uint8_t weekdays;           // Bits 0...6 (as tm_wday)
+  uint8_t flags;              // SCHEDULER_CRON_ANY_DAY, SCHEDULER_CRON_ANY_WEEKDAY
+} schedulerCron_t;
+
+typedef void (*schedulerJobCallback_t)(void* arg);
+
+// Handle of a periodic job (0 - invalid)
+typedef uint16_t schedulerJobHandle_t;
+#define SCHEDULER_JOB_INVALID 0
+#define SCHEDULER_JOB_PHASE_NONE -1
+
+typedef struct {
+  uint32_t jobs;              // Registered jobs
+  uint32_t wakeups;           // Wakeups of the timer that ran jobs
+  uint32_t runs;              // Calls of the callbacks
+  uint32_t merged;            // Wakeups saved by running several jobs at once (runs - wakeups)
+} schedulerJobsStats_t;
+
+// Handle of a registered schedule (0 - invalid); it becomes invalid when the schedule is unregistered, even if the slot is reused
+typedef uint32_t schedulerHandle_t;
+#define SCHEDULER_HANDLE_INVALID 0
+
+// Flags of registered schedules
+#define SCHEDULER_FLAG_IMMEDIATE 0x0001    // Latency-critical: events are never delayed by the load smoothing
+
+// Index of a mode, its bit in schedulerModes() is SCHEDULER_MODE_BIT(mode)
+typedef int8_t schedulerMode_t;
+#define SCHEDULER_MODE_INVALID -1
+#define SCHEDULER_MODE_BIT(mode) (1UL << (mode))
+#define SCHEDULER_MODE_SILENT_NAME "silent"
+#define SCHEDULER_MODES_WAIT_FOREVER UINT32_MAX
+
+// Called for the owning schedule only, instead of posting an event to the global loop (cron schedules: state is always true).
+// It is called from the task that runs the scheduler (the worker or the esp_timer task) and must be short
+typedef void (*schedulerCallback_t)(schedulerHandle_t handle, bool state, void* arg);
+
+#if CONFIG_SCHEDULER_FORECAST
+
+typedef struct {
+  time_t time;                // Tick at which the transition happens
+  uint32_t value;             // Value of the schedule (0 for items with a callback)
+  schedulerHandle_t handle;
+  uint8_t state;              // New state: 1 - ON, 0 - OFF (cron schedules: always 1)
+  uint8_t reserved;
+} schedulerForecastItem_t;
+
+// Binary form of a forecast: header, then SCHEDULER_FORECAST_RECORD_SIZE bytes per transition: handle (uint32_t) and 
+// minutes since the base time with the new state in the high bit (uint32_t); all numbers are little-endian
+#define SCHEDULER_FORECAST_VERSION      2
+#define SCHEDULER_FORECAST_HEADER_SIZE  8     // Version (uint8_t), record size (uint8_t), count (uint16_t), base time (uint32_t)
+#define SCHEDULER_FORECAST_RECORD_SIZE  8
+
+#endif // CONFIG_SCHEDULER_FORECAST
+
+#if CONFIG_SCHEDULER_SOLAR
+
+// Moments of schedulerSolar_t
+typedef enum {
+  SCHEDULER_SOLAR_TIME = 0,         // Fixed local time: the offset is the minute of the day
+  SCHEDULER_SOLAR_SUNRISE,
+  SCHEDULER_SOLAR_SUNSET,
+  SCHEDULER_SOLAR_CIVIL_DAWN,       // The sun is 6° below the horizon
+  SCHEDULER_SOLAR_CIVIL_DUSK,
+  SCHEDULER_SOLAR_NAUTICAL_DAWN,    // The sun is 12° below the horizon
+  SCHEDULER_SOLAR_NAUTICAL_DUSK,
+  SCHEDULER_SOLAR_NOON
+} schedulerSolarEvent_t;
+
+// For example, from 15 minutes after sunset to 23:00: { SCHEDULER_SOLAR_SUNSET, SCHEDULER_SOLAR_TIME, 15, 23 * 60 }. 
+// On days when one of the moments does not occur (polar day or night) the schedule is OFF
+typedef struct {
+  uint8_t on_event;           // schedulerSolarEvent_t
+  uint8_t off_event;
+  int16_t on_offset;          // Minutes after the moment (before it, if negative)
+  int16_t off_offset;
+} schedulerSolar_t;
+
+// Solar day in minutes from 00:00 UTC: true noon and half-lengths of the arcs of the sun above the horizon, above -6° 
+// and above -12°. The arc is 0 if the sun does not rise to this height during the day and 720 if it does not set below it
+#define SCHEDULER_SOLAR_ARCS 3
+
+typedef struct {
+  int16_t noon;
+  uint16_t arc[SCHEDULER_SOLAR_ARCS];
+} schedulerSolarDay_t;
+
+#endif // CONFIG_SCHEDULER_SOLAR
+
+#if CONFIG_SCHEDULER_TABLES
+
+typedef struct {
+  timespan_t timespan;
+  uint32_t value;             // Value of RE_TIME_TIMESPAN_ON and RE_TIME_TIMESPAN_OFF
+} schedulerTableItem_t;
+
+#define SCHEDULER_TABLE_WORDS(count)  (((count) + 31) / 32)
+#define SCHEDULER_TABLE_MINUTE_WORDS  SCHEDULER_TABLE_WORDS(1440)
+
+// Table prepared by the compiler: HHMM of the beginnings and of the ends of the timespans, their values and the bits 
+// of the minutes of the day at which any of them begins or ends; the states are the only part in RAM
+typedef struct {
+  uint32_t count;
+  const uint16_t* begin;
+  const uint16_t* end;
+  const uint32_t* values;
+  const uint32_t* minutes;
+  uint32_t* states;
+} schedulerTable_t;
+
+#endif // CONFIG_SCHEDULER_TABLES
+
+typedef struct {
+  uint32_t count;             // Registered items
+  uint32_t capacity;          // Items the pool can hold without reallocation
+  uint32_t item_bytes;        // Bytes per item: record, queue index and position, packed timespan (plus 4 bits)
+  uint32_t pool_bytes;        // Memory allocated for the pool (estimated heap headers included)
+  uint32_t list_bytes;        // Estimated memory the same items took as separately allocated list nodes
+} schedulerMemoryStats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 bool schedulerInit();
 void schedulerFree();
-bool schedulerRegister(timespan_t* timespan, uint32_t value);
+// Registry changes are safe from any task and take effect on the next tick of the timer
+schedulerHandle_t schedulerRegister(timespan_t* timespan, uint32_t value);
+bool schedulerUpdate(schedulerHandle_t handle, timespan_t* timespan);
+bool schedulerUnregister(schedulerHandle_t handle);
+bool schedulerSetFlags(schedulerHandle_t handle, uint32_t flags);
+// The cron schedule must remain valid while it is registered, like the timespan
+schedulerHandle_t schedulerRegisterCron(const schedulerCron_t* cron, uint32_t value);
+bool schedulerUpdateCron(schedulerHandle_t handle, const schedulerCron_t* cron);
+// Direct dispatch: no events are posted and the load smoothing and warm start do not apply to these items
+schedulerHandle_t schedulerRegisterCallback(timespan_t* timespan, schedulerCallback_t callback, void* arg);
+schedulerHandle_t schedulerRegisterCronCallback(const schedulerCron_t* cron, schedulerCallback_t callback, void* arg);
+
+bool schedulerCronParse(const char* expression, schedulerCron_t* cron);
+bool schedulerCronMatch(const schedulerCron_t* cron, struct tm* timeinfo);
+// Next time after the given one when the schedule fires (0 if never), in the local time of the clock set by schedulerSetClock()
+time_t schedulerCronNext(const schedulerCron_t* cron, time_t after);
+// The same for the given clock (nullptr: gettimeofday() and localtime_r())
+time_t schedulerCronNextClock(const schedulerCron_t* cron, time_t after, const schedulerClock_t* clock);
+void schedulerMemoryStats(schedulerMemoryStats_t* stats);
+
+// Run the callback every interval_ms, no later than slack_ms after the deadline. With phase_ms >= 0 the deadlines are aligned 
+// to the wall clock: (time - phase_ms) is a multiple of interval_ms; with SCHEDULER_JOB_PHASE_NONE they are counted from now
+schedulerJobHandle_t schedulerJobRegister(const char* name, uint32_t interval_ms, uint32_t slack_ms, int32_t phase_ms, 
+  schedulerJobCallback_t callback, void* arg);
+bool schedulerJobUnregister(schedulerJobHandle_t handle);
+void schedulerJobsStats(schedulerJobsStats_t* stats);
 
 bool schedulerStart(bool createSuspended);
+// Suspend and resume periodic jobs (during OTA updates)
 bool schedulerSuspend();
 bool schedulerResume();
 void schedulerDelete();
@@ -30,6 +513,85 @@ void schedulerDelete();
 bool schedulerEventHandlerRegister();
 void schedulerEventHandlerUnregister();
 
+// Boundary events are posted only while there is at least one subscriber (without CONFIG_SCHEDULER_BOUNDARIES the hour 
+// and longer ones always, and RE_TIME_EVERY_MINUTE too unless the mode is tickless); false for an unknown boundary.
+// After a stall, every boundary except the minute that fell into the missed minutes is posted once, with the latest value
+bool schedulerBoundarySubscribe(uint32_t minutes);
+void schedulerBoundaryUnsubscribe(uint32_t minutes);
+void schedulerBoundaryStats(schedulerBoundaryStats_t* stats);
+// The same as SCHEDULER_BOUNDARY_MINUTE
+void schedulerEveryMinuteSubscribe();
+void schedulerEveryMinuteUnsubscribe();
+// How long (us) the last and the slowest call of the main timer callback held the esp_timer task
+void schedulerTimerCallbackTime(uint32_t* last_us, uint32_t* max_us);
+void schedulerTimingStats(schedulerTimingStats_t* stats);
+#if CONFIG_SCHEDULER_STATS
+void schedulerStats(schedulerStats_t* stats);
+void schedulerStatsReset();
+#endif // CONFIG_SCHEDULER_STATS
+#if CONFIG_SCHEDULER_WARMSTART
+// Write the states right away regardless of the interval (before a planned restart); blocks while NVS is written
+void schedulerWarmStartSave();
+void schedulerWarmStartStats(schedulerWarmStartStats_t* stats);
+#endif // CONFIG_SCHEDULER_WARMSTART
+#if CONFIG_SCHEDULER_SPREAD
+void schedulerSpreadStats(schedulerSpreadStats_t* stats);
+#endif // CONFIG_SCHEDULER_SPREAD
+#if CONFIG_SCHEDULER_SHARDS > 1
+void schedulerShardsStats(schedulerShardsStats_t* stats);
+#endif // CONFIG_SCHEDULER_SHARDS
+#if CONFIG_SCHEDULER_TICKLESS
+void schedulerTicklessStats(uint32_t* wakeups, uint32_t* skipped);
+#endif // CONFIG_SCHEDULER_TICKLESS
+#if CONFIG_SCHEDULER_FORECAST
+// Transitions of the item (or of all items for SCHEDULER_HANDLE_INVALID) within window_s seconds from now, ordered by time.
+// Returns the number written to items: up to max_count, but no more than CONFIG_SCHEDULER_FORECAST_SIZE (the earliest ones).
+// Items registered less than a tick ago are not included yet
+uint32_t schedulerForecast(schedulerHandle_t handle, uint32_t window_s, schedulerForecastItem_t* items, uint32_t max_count);
+// Returns the size of the binary form (written only if it fits in the buffer)
+size_t schedulerForecastExport(const schedulerForecastItem_t* items, uint32_t count, uint8_t* buffer, size_t size);
+void schedulerForecastStats(uint32_t* computed, uint32_t* cached);
+#endif // CONFIG_SCHEDULER_FORECAST
+// Modes are registered at startup; the same name binds the existing mode to another timespan. If enabled is set, the mode 
+// is active only while it is true. The name, the timespan and the flag must remain valid; changes of the latter two made 
+// through reParams are applied immediately, others on the next tick
+schedulerMode_t schedulerModeRegister(const char* name, timespan_t* timespan, bool* enabled);
+schedulerMode_t schedulerModeFind(const char* name);
+// Bits of the active modes (any task or ISR)
+uint32_t schedulerModes();
+bool schedulerModeActive(schedulerMode_t mode);
+// Wait until at least one of the modes is active (or inactive), returns those of them that are; 0 after the timeout
+uint32_t schedulerModesWait(uint32_t modes, bool active, uint32_t timeout_ms);
+#if CONFIG_SCHEDULER_SOLAR
+// The schedule must remain valid while it is registered; the item is removed by schedulerUnregister(). Forecasts use 
+// the times of the current day for the following days too
+schedulerHandle_t schedulerRegisterSolar(const schedulerSolar_t* solar, uint32_t value);
+// Timespan of the item for the current day (0 before the first tick or if it is OFF all day)
+timespan_t schedulerSolarTimespan(schedulerHandle_t handle);
+void schedulerSolarSetLocation(float latitude, float longitude);
+// Year (as 2024) and day of the year (as tm_yday); false if the arguments are invalid
+bool schedulerSolarCalc(int year, int yday, float latitude, float longitude, schedulerSolarDay_t* day);
+void schedulerSolarStats(uint32_t* days, uint32_t* tables);
+#endif // CONFIG_SCHEDULER_SOLAR
+#if CONFIG_SCHEDULER_TABLES
+// The table is checked from the next tick on and cannot be removed; its items have no handles, are not included in 
+// forecasts and are not saved by the warm start
+bool schedulerTableRegister(const schedulerTable_t* table);
+void schedulerTablesStats(uint32_t* items, uint32_t* checks);
+#endif // CONFIG_SCHEDULER_TABLES
+// The clock must remain valid while it is set; nullptr returns to the system clock
+void schedulerSetClock(const schedulerClock_t* clock);
+#if CONFIG_SCHEDULER_REPLAY
+// Minutes from "from" (inclusive) to "to" (exclusive), local time by the current clock; only while the scheduler is not started.
+// Callbacks of items are not called, nothing is posted or saved; the states of items are restored afterwards
+bool schedulerReplay(time_t from, time_t to, schedulerReplayLog_t log, void* arg, schedulerReplayStats_t* stats);
+#endif // CONFIG_SCHEDULER_REPLAY
+#if CONFIG_SCHEDULER_CALENDAR
+// Must be called after a change of the time zone (TZ); clock synchronization is tracked automatically
+void schedulerCalendarReset();
+void schedulerCalendarStats(uint32_t* anchors, uint32_t* tables);
+#endif // CONFIG_SCHEDULER_CALENDAR
+
 // Silent mode
 #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
 bool isSilentMode();
@@ -39,4 +601,61 @@ bool isSilentMode();
 }
 #endif
 
+#if CONFIG_SCHEDULER_TABLES && defined(__cplusplus)
+
+// Static table, for example: 
+//   SCHEDULER_TABLE(lights, { 7002300, 1 }, { 22000600, 2 });
+//   schedulerTableRegister(&lights);
+// A timespan that checkTimespan() does not understand (hours above 23, minutes above 59, the end after 24:00) stops the build
+#define SCHEDULER_TABLE(name, ...) \
+  static constexpr schedulerTableItem_t name##Items[] = { __VA_ARGS__ }; \
+  static constexpr schedulerTableData_t<sizeof(name##Items) / sizeof(name##Items[0])> name##Data = schedulerTableBuild(name##Items); \
+  static uint32_t name##States[SCHEDULER_TABLE_WORDS(sizeof(name##Items) / sizeof(name##Items[0]))]; \
+  static constexpr schedulerTable_t name = { sizeof(name##Items) / sizeof(name##Items[0]), name##Data.begin, name##Data.end, \
+    name##Data.values, name##Data.minutes, name##States }
+
+static_assert(__cplusplus >= 201402L, "SCHEDULER_TABLE() requires C++14");
+
+template <size_t N>
+struct schedulerTableData_t {
+  uint16_t begin[N];
+  uint16_t end[N];
+  uint32_t values[N];
+  uint32_t minutes[SCHEDULER_TABLE_MINUTE_WORDS];
+};
+
+// Not defined: the call makes the table a non-constant expression
+void schedulerTableInvalidTimespan();
+
+constexpr bool schedulerTableTimespanValid(timespan_t timespan)
+{
+  return (timespan / 1000000 < 24) && (timespan / 10000 % 100 < 60) && (timespan % 10000 <= 2400) && (timespan % 100 < 60);
+}
+
+constexpr void schedulerTableMinute(uint32_t* minutes, uint32_t hhmm)
+{
+  uint32_t minute = (hhmm / 100 * 60 + hhmm % 100) % 1440;
+  minutes[minute / 32] |= 1UL << (minute % 32);
+}
+
+template <size_t N>
+constexpr schedulerTableData_t<N> schedulerTableBuild(const schedulerTableItem_t (&items)[N])
+{
+  static_assert(N <= UINT16_MAX, "Too many items in the table");
+  schedulerTableData_t<N> data = {};
+  for (size_t i = 0; i < N; i++) {
+    if (!schedulerTableTimespanValid(items[i].timespan)) {
+      schedulerTableInvalidTimespan();
+    };
+    data.begin[i] = items[i].timespan / 10000;
+    data.end[i] = items[i].timespan % 10000;
+    data.values[i] = items[i].value;
+    schedulerTableMinute(data.minutes, data.begin[i]);
+    schedulerTableMinute(data.minutes, data.end[i]);
+  };
+  return data;
+}
+
+#endif // CONFIG_SCHEDULER_TABLES
+
 #endif // __RE_SCHEDULER_H__
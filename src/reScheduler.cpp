@@ -1,251 +1,3529 @@
 #include <time.h>
 #include "reScheduler.h"
-#include "reEvents.h"
-#include "rLog.h"
-#include "rTypes.h"
-#include "reNvs.h"
-#include "reEsp32.h"
-#include "esp_timer.h"
-#include "reParams.h"
-#include "sys/queue.h"
-#include "project_config.h"
-#include "def_consts.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-#include "reSysInfo.h"
-#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+#include "reSchedulerPort.h"
 
 #define TIME_EVENTS_POST_TIMEOUT  pdMS_TO_TICKS(1000)
 
-static const char* logTAG = "SCHD";
+static const char* logTAG = "SCHD";
+
+// Compact record of a registered schedule
+typedef struct {
+  union {
+    timespan_t* timespan;
+    const schedulerCron_t* cron;  // Items marked in _schedulerCrons
+  };
+  union {
+    uint32_t value;
+    void* arg;                    // Items with a callback
+  };
+  schedulerCallback_t callback;   // If not set, events are posted
+  uint16_t generation;            // High bits of the handle
+  time_t edge;          // Time of the next ON/OFF transition
+} schedulerItem_t;
+
+#define SCHEDULER_BITSET_WORDS(count) (((count) + 31) / 32)
+// Handle: index of the item + 1 in the low bits and the generation of the slot in the high bits. The generation is 
+// incremented when the item is unregistered, so a stale handle does not refer to the next item registered in the slot
+#define SCHEDULER_HANDLE_INDEX_BITS   20
+#define SCHEDULER_HANDLE_INDEX_MASK   ((1UL << SCHEDULER_HANDLE_INDEX_BITS) - 1)
+#define SCHEDULER_GENERATION_MASK     (UINT32_MAX >> SCHEDULER_HANDLE_INDEX_BITS)
+#define SCHEDULER_HANDLE_MAKE(index, generation) ((((schedulerHandle_t)(generation)) << SCHEDULER_HANDLE_INDEX_BITS) | ((index) + 1))
+#define SCHEDULER_HANDLE_INDEX(handle) (((handle) & SCHEDULER_HANDLE_INDEX_MASK) - 1)
+#define SCHEDULER_HANDLE_GENERATION(handle) ((handle) >> SCHEDULER_HANDLE_INDEX_BITS)
+
+static_assert(CONFIG_SCHEDULER_POOL_MAX <= SCHEDULER_HANDLE_INDEX_MASK, "CONFIG_SCHEDULER_POOL_MAX must not exceed 1048575");
+
+// Index of an item in the queue of the pool
+#if CONFIG_SCHEDULER_POOL_MAX > UINT16_MAX
+typedef uint32_t schedulerIndex_t;
+#else
+typedef uint16_t schedulerIndex_t;
+#endif // CONFIG_SCHEDULER_POOL_MAX
+// Size of a separately allocated list node (timespan, state, value, next) and of the heap block header, for comparison
+#define SCHEDULER_LIST_NODE_SIZE      (3 * sizeof(void*) + sizeof(uint32_t))
+#define SCHEDULER_HEAP_BLOCK_OVERHEAD 8
+
+// Pool of items: handle with index N refers to _schedulerPool[N - 1]. The pool and the queue belong to the timer,
+// other tasks change them only through the list of pending changes
+static void* _schedulerPoolBlock = nullptr;
+static schedulerItem_t* _schedulerPool = nullptr;
+static uint32_t* _schedulerStates = nullptr;   // Current states of items
+static uint32_t* _schedulerKnown = nullptr;    // Items whose state has already been evaluated
+static uint32_t* _schedulerLive = nullptr;     // Registered items
+static uint32_t* _schedulerEval = nullptr;     // States calculated by schedulerSpanEvaluate()
+static uint32_t* _schedulerCrons = nullptr;    // Cron schedules (the rest are timespans)
+static uint32_t* _schedulerImmediate = nullptr; // Items with SCHEDULER_FLAG_IMMEDIATE
+static uint16_t* _schedulerSpanBegin = nullptr;
+static uint16_t* _schedulerSpanEnd = nullptr;
+static uint32_t _schedulerPoolCount = 0;       // Used slots (including unregistered ones)
+static uint32_t _schedulerPoolLive = 0;        // Registered items
+static uint32_t _schedulerPoolSize = 0;
+
+// Priority queue (min-heap) of item indexes ordered by the time of the next transition
+static schedulerIndex_t* _schedulerQueue = nullptr;
+static schedulerIndex_t* _schedulerQueuePos = nullptr; // Position of each item in the queue
+#if CONFIG_SCHEDULER_SHARDS > 1
+// Items due at this minute with the result of the check in bit 31 (the state, or the match for cron schedules)
+#define SCHEDULER_SHARD_RESULT 0x80000000
+static uint32_t* _schedulerShardDue = nullptr;
+static uint32_t _schedulerShardDueCount = 0;
+#endif // CONFIG_SCHEDULER_SHARDS
+static uint32_t _schedulerQueueCount = 0;
+static volatile bool _schedulerQueueValid = false;
+static time_t _schedulerQueueTime = 0;
+static int _schedulerQueueIsDst = -1;
+
+// Changes of the registry made by other tasks, applied by the timer at the beginning of the next tick
+typedef enum {
+  SCHEDULER_CHANGE_NONE = 0,
+  SCHEDULER_CHANGE_REGISTER,
+  SCHEDULER_CHANGE_UPDATE,
+  SCHEDULER_CHANGE_UNREGISTER,
+  SCHEDULER_CHANGE_FLAGS,
+  SCHEDULER_CHANGE_RESIZE
+} schedulerChangeType_t;
+
+typedef struct schedulerChange_t {
+  struct schedulerChange_t* next;
+  schedulerChangeType_t type;
+  schedulerHandle_t handle;
+  timespan_t* timespan;
+  const schedulerCron_t* cron;
+  uint32_t value;
+  schedulerCallback_t callback;
+  void* arg;
+  void* block;                  // RESIZE: the new pool, and the old one after the change is applied
+  uint32_t size;
+} schedulerChange_t;
+
+static schedulerChange_t* _schedulerChanges = nullptr;       // Pending changes (newest first)
+#if CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+// Incremented before and after the timer applies changes (odd while it does), and when the parameters or the clock change
+static uint32_t _schedulerRegistryVersion = 0;
+#endif // CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+static schedulerChange_t* _schedulerRetired = nullptr;       // Changes already applied by the timer
+// Registering tasks are serialized by the mutex, the timer never takes it
+static schedPortMutex_t _schedulerRegistryLock = nullptr;
+static schedulerChange_t* _schedulerFreeHandles = nullptr;   // Unregistered handles available for reuse
+static uint16_t* _schedulerHandleGenerations = nullptr;       // Current generation of every slot ever used
+static uint32_t _schedulerHandleNext = 0;
+static uint32_t _schedulerPoolReserved = 0;
+
+static bool _handlersRegistered = false;
+static schedPortTimer_t _schedulerTimerMain = nullptr;
+#if CONFIG_SCHEDULER_BATCH_EVENTS
+static schedulerTransitions_t* _schedulerBatch = nullptr;
+#endif // CONFIG_SCHEDULER_BATCH_EVENTS
+#if CONFIG_SCHEDULER_TICKLESS
+static uint32_t _schedulerTicklessWakeups = 0;
+static uint32_t _schedulerTicklessSkipped = 0;
+static time_t _schedulerTicklessLast = 0;            // Minute of the previous wakeup
+static int64_t _schedulerWorkTimeLast = 0;
+static int64_t _schedulerWorkTimeUs = 0;
+#endif // CONFIG_SCHEDULER_TICKLESS
+#if CONFIG_SCHEDULER_WORKER
+#define SCHEDULER_WORKER_QUEUE_SIZE 8
+static schedPortTask_t volatile _schedulerWorker = nullptr;
+static volatile bool _schedulerWorkerRun = false;
+static struct timeval _schedulerWorkerQueue[SCHEDULER_WORKER_QUEUE_SIZE];
+static uint32_t _schedulerWorkerHead = 0;
+static uint32_t _schedulerWorkerTail = 0;
+#endif // CONFIG_SCHEDULER_WORKER
+#if CONFIG_SCHEDULER_WARMSTART
+static uint64_t* _schedulerWarmSaved = nullptr;      // Saved states sorted by values: value << 2 | claimed << 1 | state
+static uint32_t _schedulerWarmCount = 0;
+static uint32_t _schedulerWarmHash = 0;              // Hash of the snapshot stored in NVS
+static int64_t _schedulerWarmLast = 0;               // Monotonic time of the start or of the last snapshot
+static volatile bool _schedulerWarmDirty = false;
+static uint8_t* _schedulerWarmBlob = nullptr;        // Snapshot for _schedulerWarmBlobCount items (under _schedulerRegistryLock)
+static uint32_t _schedulerWarmBlobCount = 0;
+static schedulerWarmStartStats_t _schedulerWarmStats = { 0, 0, 0, 0 };
+#endif // CONFIG_SCHEDULER_WARMSTART
+static uint32_t _schedulerCallbackLast = 0;
+static uint32_t _schedulerCallbackMax = 0;
+static const schedulerClock_t* volatile _schedulerClock = nullptr;
+#if CONFIG_SCHEDULER_REPLAY
+static schedulerReplayLog_t _schedulerReplayLog = nullptr;  // Set while schedulerReplay() is running
+static void* _schedulerReplayArg = nullptr;
+static schedulerReplayRecord_t _schedulerReplayRecord;
+static uint32_t _schedulerReplayEvents = 0;
+static uint32_t _schedulerReplayTransitions = 0;
+#define SCHEDULER_REPLAYING (_schedulerReplayLog != nullptr)
+#else
+#define SCHEDULER_REPLAYING false
+#endif // CONFIG_SCHEDULER_REPLAY
+
+// Deadline of the main timer on the monotonic clock
+#define SCHEDULER_TIMER_TOLERANCE_US 1000            // Allowed divergence of the wall and monotonic clocks
+#define SCHEDULER_REPLAY_MINUTES_MAX 1440            // Longer gaps are considered clock jumps
+static int64_t _schedulerTimerOffset = INT64_MIN;    // Wall time minus monotonic time
+static int64_t _schedulerTimerTarget = 0;
+static time_t _schedulerTimerExpected = 0;
+static uint32_t _schedulerTimingTicks = 0;
+static uint32_t _schedulerTimingLateLast = 0;
+static uint32_t _schedulerTimingLateMax = 0;
+static uint64_t _schedulerTimingLateSum = 0;
+static uint32_t _schedulerTimingMissed = 0;
+static uint32_t _schedulerTimingReplayed = 0;
+static uint32_t _schedulerTimingResyncs = 0;
+
+static void schedulerTimerMainWakeup();
+static void schedulerTimerMainFire();
+#if CONFIG_SCHEDULER_WARMSTART
+static void schedulerWarmDiscard();
+static bool schedulerWarmReserve(uint32_t count);
+#endif // CONFIG_SCHEDULER_WARMSTART
+#if CONFIG_SCHEDULER_FORECAST
+static void schedulerForecastDiscard();
+#endif // CONFIG_SCHEDULER_FORECAST
+#if CONFIG_SCHEDULER_SOLAR
+static void schedulerSolarRelease(schedulerHandle_t handle);
+static void schedulerSolarDiscard();
+static void schedulerSolarInvalidate();
+#endif // CONFIG_SCHEDULER_SOLAR
+#if CONFIG_SCHEDULER_TABLES
+static void schedulerTablesCheck(struct tm* nowS, time_t nowT, bool full);
+static void schedulerTablesDiscard();
+#endif // CONFIG_SCHEDULER_TABLES
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Instrumentation --------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_STATS
+
+static schedulerStats_t _schedulerStats;
+static uint32_t _schedulerTickItems = 0;
+static uint32_t _schedulerTickTransitions = 0;
+
+#define SCHEDULER_STAT_ADD(counter, value) __atomic_fetch_add(&_schedulerStats.counter, (value), __ATOMIC_RELAXED)
+#define SCHEDULER_STAT_TICK(counter, value) _schedulerTick##counter += (value)
+
+static void schedulerStatMax(uint32_t* counter, uint32_t value)
+{
+  uint32_t prev = __atomic_load_n(counter, __ATOMIC_RELAXED);
+  while ((value > prev) && !__atomic_compare_exchange_n(counter, &prev, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// Buckets are spaced by a factor of 4: < 64 us, < 256 us, ... , < 262 ms, the rest
+static void schedulerStatHistogram(uint32_t* histogram, uint32_t us)
+{
+  uint32_t bucket = us < SCHEDULER_STATS_BUCKET_LIMIT(0) ? 0 : (31 - __builtin_clz(us) - 4) / 2;
+  if (bucket >= SCHEDULER_STATS_BUCKETS) bucket = SCHEDULER_STATS_BUCKETS - 1;
+  __atomic_fetch_add(&histogram[bucket], 1, __ATOMIC_RELAXED);
+}
+
+// Totals of the tick are added once, at its end
+static void schedulerStatTickDone(uint32_t exec_us)
+{
+  SCHEDULER_STAT_ADD(ticks, 1);
+  SCHEDULER_STAT_ADD(items_evaluated, _schedulerTickItems);
+  SCHEDULER_STAT_ADD(transitions, _schedulerTickTransitions);
+  schedulerStatMax(&_schedulerStats.items_max, _schedulerTickItems);
+  schedulerStatMax(&_schedulerStats.transitions_max, _schedulerTickTransitions);
+  schedulerStatMax(&_schedulerStats.exec_max_us, exec_us);
+  schedulerStatHistogram(_schedulerStats.exec_hist, exec_us);
+  _schedulerTickItems = 0;
+  _schedulerTickTransitions = 0;
+}
+
+void schedulerStats(schedulerStats_t* stats)
+{
+  if (stats) {
+    uint32_t* src = (uint32_t*)&_schedulerStats;
+    uint32_t* dst = (uint32_t*)stats;
+    for (size_t i = 0; i < sizeof(schedulerStats_t) / sizeof(uint32_t); i++) {
+      dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    };
+  };
+}
+
+void schedulerStatsReset()
+{
+  uint32_t* dst = (uint32_t*)&_schedulerStats;
+  for (size_t i = 0; i < sizeof(schedulerStats_t) / sizeof(uint32_t); i++) {
+    __atomic_store_n(&dst[i], 0, __ATOMIC_RELAXED);
+  };
+}
+
+#else
+
+#define SCHEDULER_STAT_ADD(counter, value)
+#define SCHEDULER_STAT_TICK(counter, value)
+
+#endif // CONFIG_SCHEDULER_STATS
+
+#if CONFIG_SCHEDULER_REPLAY
+
+static void schedulerReplayWrite(int32_t event_id, uint32_t value)
+{
+  _schedulerReplayRecord.event = event_id;
+  _schedulerReplayRecord.value = value;
+  _schedulerReplayLog(&_schedulerReplayRecord, _schedulerReplayArg);
+  _schedulerReplayEvents++;
+}
+
+#endif // CONFIG_SCHEDULER_REPLAY
+
+static bool schedulerEventPost(int32_t event_id, void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+  #if CONFIG_SCHEDULER_REPLAY
+    if (_schedulerReplayLog) {
+      uint32_t value = 0;
+      if (event_data && (event_data_size >= sizeof(value))) {
+        memcpy(&value, event_data, sizeof(value));
+      };
+      schedulerReplayWrite(event_id, value);
+      return true;
+    };
+  #endif // CONFIG_SCHEDULER_REPLAY
+  if (eventLoopPost(RE_TIME_EVENTS, event_id, event_data, event_data_size, ticks_to_wait)) {
+    SCHEDULER_STAT_ADD(posts, 1);
+    return true;
+  };
+  SCHEDULER_STAT_ADD(post_failures, 1);
+  return false;
+}
+
+#if CONFIG_SCHEDULER_BATCH_EVENTS
+
+// Post the collected transitions as one event; if it could not be posted, the transitions stay in the batch
+static bool schedulerBatchPost(schedulerTransitions_t* batch, bool last, TickType_t ticks_to_wait)
+{
+  if (batch && ((batch->count > 0) || (last && (batch->offset > 0)))) {
+    batch->flags = last ? SCHEDULER_TRANSITIONS_LAST : 0;
+    if (!schedulerEventPost(RE_TIME_TIMESPAN_BATCH, batch, SCHEDULER_TRANSITIONS_SIZE(batch->count), ticks_to_wait)) {
+      return false;
+    };
+    batch->offset += batch->count;
+    batch->count = 0;
+  };
+  return true;
+}
+
+static void schedulerBatchFlush(schedulerTransitions_t* batch, bool last)
+{
+  if (!schedulerBatchPost(batch, last, TIME_EVENTS_POST_TIMEOUT) && batch) {
+    batch->offset += batch->count;
+    batch->count = 0;
+  };
+}
+
+static void schedulerBatchStart(schedulerTransitions_t* batch, time_t nowT)
+{
+  if (batch) {
+    batch->time = nowT;
+    batch->count = 0;
+    batch->offset = 0;
+  };
+}
+
+static void schedulerBatchAdd(schedulerTransitions_t* batch, uint32_t value, bool state)
+{
+  if (batch) {
+    if (batch->count >= CONFIG_SCHEDULER_BATCH_SIZE) {
+      schedulerBatchFlush(batch, false);
+    };
+    schedulerTransition_t* transition = &batch->items[batch->count++];
+    transition->value = value;
+    transition->state = state ? 1 : 0;
+  };
+}
+
+#endif // CONFIG_SCHEDULER_BATCH_EVENTS
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------- Common functions ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static void schedulerClockWall(struct timeval* now)
+{
+  const schedulerClock_t* clock = _schedulerClock;
+  if (clock && clock->wall_time) {
+    clock->wall_time(now);
+  } else {
+    schedPortWallTime(now);
+  };
+}
+
+static void schedulerClockLocal(time_t time, struct tm* local)
+{
+  const schedulerClock_t* clock = _schedulerClock;
+  if (clock && clock->local_time) {
+    clock->local_time(&time, local);
+  } else {
+    localtime_r(&time, local);
+  };
+}
+
+time_t schedulerCronNext(const schedulerCron_t* cron, time_t after)
+{
+  return schedulerCronNextClock(cron, after, _schedulerClock);
+}
+
+static inline bool schedulerBitGet(const uint32_t* bits, uint32_t index)
+{
+  return (bits[index >> 5] >> (index & 31)) & 1;
+}
+
+static inline void schedulerBitSet(uint32_t* bits, uint32_t index, bool value)
+{
+  if (value) {
+    bits[index >> 5] |= (1UL << (index & 31));
+  } else {
+    bits[index >> 5] &= ~(1UL << (index & 31));
+  };
+}
+
+// The pool is one block: items, bitsets (states, known, live, eval, crons, immediate), queue, positions, packed timespans
+// and, with shards, the list of due items (so that a tick never allocates it)
+#define SCHEDULER_POOL_BITSETS 6
+#define SCHEDULER_POOL_QUEUES  2
+#define SCHEDULER_POOL_SPANS   2
+#if CONFIG_SCHEDULER_SHARDS > 1
+#define SCHEDULER_POOL_DUE_BYTES sizeof(uint32_t)
+#else
+#define SCHEDULER_POOL_DUE_BYTES 0
+#endif // CONFIG_SCHEDULER_SHARDS
+#define SCHEDULER_POOL_ITEM_BYTES (sizeof(schedulerItem_t) + SCHEDULER_POOL_QUEUES * sizeof(schedulerIndex_t) \
+  + SCHEDULER_POOL_SPANS * sizeof(uint16_t) + SCHEDULER_POOL_DUE_BYTES)
+
+static size_t schedulerPoolBytes(uint32_t size)
+{
+  return size * SCHEDULER_POOL_ITEM_BYTES + SCHEDULER_POOL_BITSETS * SCHEDULER_BITSET_WORDS(size) * sizeof(uint32_t);
+}
+
+// Switch to another block of the pool, returns the previous one
+static void* schedulerPoolMove(void* block, uint32_t size)
+{
+  void* oldBlock = _schedulerPoolBlock;
+  schedulerItem_t* oldPool = _schedulerPool;
+  uint32_t* oldBitsets[SCHEDULER_POOL_BITSETS] = { _schedulerStates, _schedulerKnown, _schedulerLive, _schedulerEval, _schedulerCrons, 
+    _schedulerImmediate };
+  schedulerIndex_t* oldQueues[SCHEDULER_POOL_QUEUES] = { _schedulerQueue, _schedulerQueuePos };
+  uint16_t* oldSpans[SCHEDULER_POOL_SPANS] = { _schedulerSpanBegin, _schedulerSpanEnd };
+
+  uint8_t* ptr = (uint8_t*)block;
+  _schedulerPool = (schedulerItem_t*)ptr;
+  ptr += size * sizeof(schedulerItem_t);
+  uint32_t* bitsets[SCHEDULER_POOL_BITSETS];
+  for (uint32_t i = 0; i < SCHEDULER_POOL_BITSETS; i++) {
+    bitsets[i] = (uint32_t*)ptr;
+    ptr += SCHEDULER_BITSET_WORDS(size) * sizeof(uint32_t);
+  };
+  schedulerIndex_t* queues[SCHEDULER_POOL_QUEUES];
+  for (uint32_t i = 0; i < SCHEDULER_POOL_QUEUES; i++) {
+    queues[i] = (schedulerIndex_t*)ptr;
+    ptr += size * sizeof(schedulerIndex_t);
+  };
+  uint16_t* spans[SCHEDULER_POOL_SPANS];
+  for (uint32_t i = 0; i < SCHEDULER_POOL_SPANS; i++) {
+    spans[i] = (uint16_t*)ptr;
+    ptr += size * sizeof(uint16_t);
+  };
+  #if CONFIG_SCHEDULER_SHARDS > 1
+    // Filled anew on every tick, nothing to copy
+    _schedulerShardDue = (uint32_t*)ptr;
+    ptr += size * sizeof(uint32_t);
+  #endif // CONFIG_SCHEDULER_SHARDS
+  _schedulerStates = bitsets[0];
+  _schedulerKnown = bitsets[1];
+  _schedulerLive = bitsets[2];
+  _schedulerEval = bitsets[3];
+  _schedulerCrons = bitsets[4];
+  _schedulerImmediate = bitsets[5];
+  _schedulerQueue = queues[0];
+  _schedulerQueuePos = queues[1];
+  _schedulerSpanBegin = spans[0];
+  _schedulerSpanEnd = spans[1];
+
+  if (oldBlock) {
+    memcpy(_schedulerPool, oldPool, _schedulerPoolCount * sizeof(schedulerItem_t));
+    for (uint32_t i = 0; i < SCHEDULER_POOL_BITSETS; i++) {
+      memcpy(bitsets[i], oldBitsets[i], SCHEDULER_BITSET_WORDS(_schedulerPoolCount) * sizeof(uint32_t));
+    };
+    for (uint32_t i = 0; i < SCHEDULER_POOL_QUEUES; i++) {
+      memcpy(queues[i], oldQueues[i], _schedulerPoolCount * sizeof(schedulerIndex_t));
+    };
+    for (uint32_t i = 0; i < SCHEDULER_POOL_SPANS; i++) {
+      memcpy(spans[i], oldSpans[i], _schedulerPoolCount * sizeof(uint16_t));
+    };
+  };
+  _schedulerPoolBlock = block;
+  _schedulerPoolSize = size;
+  return oldBlock;
+}
+
+static void schedulerChangesPush(schedulerChange_t** list, schedulerChange_t* first, schedulerChange_t* last)
+{
+  schedulerChange_t* head = __atomic_load_n(list, __ATOMIC_RELAXED);
+  do {
+    last->next = head;
+  } while (!__atomic_compare_exchange_n(list, &head, first, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void schedulerChangesFree(schedulerChange_t* change)
+{
+  while (change) {
+    schedulerChange_t* next = change->next;
+    if ((change->type == SCHEDULER_CHANGE_RESIZE) && change->block) {
+      free(change->block);
+    };
+    free(change);
+    change = next;
+  };
+}
+
+// Take back the changes applied by the timer (under _schedulerRegistryLock)
+static void schedulerChangesReclaim()
+{
+  schedulerChange_t* change = __atomic_exchange_n(&_schedulerRetired, nullptr, __ATOMIC_ACQUIRE);
+  while (change) {
+    schedulerChange_t* next = change->next;
+    if (change->type == SCHEDULER_CHANGE_UNREGISTER) {
+      change->next = _schedulerFreeHandles;
+      _schedulerFreeHandles = change;
+    } else {
+      change->next = nullptr;
+      schedulerChangesFree(change);
+    };
+    change = next;
+  };
+}
+
+static schedulerChange_t* schedulerChangeCreate(schedulerChangeType_t type, schedulerHandle_t handle)
+{
+  schedulerChange_t* change = (schedulerChange_t*)esp_calloc(1, sizeof(schedulerChange_t));
+  RE_MEM_CHECK(change, return nullptr);
+  change->type = type;
+  change->handle = handle;
+  return change;
+}
+
+static void schedulerChangeSubmit(schedulerChange_t* change)
+{
+  schedulerChangesPush(&_schedulerChanges, change, change);
+  schedulerTimerMainWakeup();
+}
+
+// Allocate a larger pool; the timer will move the items there on the next tick (under _schedulerRegistryLock)
+static bool schedulerPoolReserve()
+{
+  uint32_t size = 2 * _schedulerPoolReserved;
+  if (size > CONFIG_SCHEDULER_POOL_MAX) size = CONFIG_SCHEDULER_POOL_MAX;
+  void* block = esp_calloc(1, schedulerPoolBytes(size));
+  uint16_t* generations = (uint16_t*)esp_calloc(size, sizeof(uint16_t));
+  #if CONFIG_SCHEDULER_WARMSTART
+    // The snapshot of the states grows with the pool, so that it is never allocated when the states are saved
+    if (block && generations && !schedulerWarmReserve(size)) {
+      free(generations);
+      generations = nullptr;
+    };
+  #endif // CONFIG_SCHEDULER_WARMSTART
+  if (!block || !generations) {
+    rlog_e(logTAG, "Failed to allocate memory for %d scheduler items", size);
+    if (block) free(block);
+    if (generations) free(generations);
+    return false;
+  };
+  schedulerChange_t* change = schedulerChangeCreate(SCHEDULER_CHANGE_RESIZE, SCHEDULER_HANDLE_INVALID);
+  if (!change) {
+    free(block);
+    free(generations);
+    return false;
+  };
+  memcpy(generations, _schedulerHandleGenerations, _schedulerHandleNext * sizeof(uint16_t));
+  free(_schedulerHandleGenerations);
+  _schedulerHandleGenerations = generations;
+  change->block = block;
+  change->size = size;
+  schedulerChangeSubmit(change);
+  _schedulerPoolReserved = size;
+  return true;
+}
+
+bool schedulerInit()
+{
+  if (!_schedulerRegistryLock) {
+    _schedulerRegistryLock = schedPortMutexCreate();
+    RE_MEM_CHECK(_schedulerRegistryLock, return false);
+  };
+  if (!_schedulerPoolBlock) {
+    void* block = esp_calloc(1, schedulerPoolBytes(CONFIG_SCHEDULER_POOL_SIZE));
+    RE_MEM_CHECK(block, return false);
+    _schedulerHandleGenerations = (uint16_t*)esp_calloc(CONFIG_SCHEDULER_POOL_SIZE, sizeof(uint16_t));
+    RE_MEM_CHECK(_schedulerHandleGenerations, { free(block); return false; });
+    _schedulerPoolCount = 0;
+    _schedulerPoolLive = 0;
+    _schedulerQueueCount = 0;
+    schedulerPoolMove(block, CONFIG_SCHEDULER_POOL_SIZE);
+    _schedulerHandleNext = 0;
+    _schedulerPoolReserved = CONFIG_SCHEDULER_POOL_SIZE;
+  };
+  #if CONFIG_SCHEDULER_WARMSTART
+    if (!schedulerWarmReserve(_schedulerPoolReserved)) return false;
+  #endif // CONFIG_SCHEDULER_WARMSTART
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    if (!_schedulerBatch) {
+      _schedulerBatch = (schedulerTransitions_t*)esp_calloc(1, SCHEDULER_TRANSITIONS_SIZE(CONFIG_SCHEDULER_BATCH_SIZE));
+      RE_MEM_CHECK(_schedulerBatch, return false);
+      _schedulerBatch->item_size = sizeof(schedulerTransition_t);
+    };
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+  return true;
+}
+
+// Must not be called while the timer is running
+void schedulerFree()
+{
+  schedulerChangesFree(__atomic_exchange_n(&_schedulerChanges, nullptr, __ATOMIC_ACQUIRE));
+  schedulerChangesFree(__atomic_exchange_n(&_schedulerRetired, nullptr, __ATOMIC_ACQUIRE));
+  schedulerChangesFree(_schedulerFreeHandles);
+  _schedulerFreeHandles = nullptr;
+  if (_schedulerHandleGenerations) {
+    free(_schedulerHandleGenerations);
+    _schedulerHandleGenerations = nullptr;
+  };
+  if (_schedulerPoolBlock) {
+    free(_schedulerPoolBlock);
+    _schedulerPoolBlock = nullptr;
+    _schedulerPool = nullptr;
+    _schedulerStates = nullptr;
+    _schedulerKnown = nullptr;
+    _schedulerLive = nullptr;
+    _schedulerEval = nullptr;
+    _schedulerCrons = nullptr;
+    _schedulerImmediate = nullptr;
+    _schedulerQueue = nullptr;
+    _schedulerQueuePos = nullptr;
+    _schedulerSpanBegin = nullptr;
+    _schedulerSpanEnd = nullptr;
+    #if CONFIG_SCHEDULER_SHARDS > 1
+      _schedulerShardDue = nullptr;
+      _schedulerShardDueCount = 0;
+    #endif // CONFIG_SCHEDULER_SHARDS
+  };
+  if (_schedulerRegistryLock) {
+    schedPortMutexDelete(_schedulerRegistryLock);
+    _schedulerRegistryLock = nullptr;
+  };
+  _schedulerPoolCount = 0;
+  _schedulerPoolLive = 0;
+  _schedulerPoolSize = 0;
+  _schedulerPoolReserved = 0;
+  _schedulerHandleNext = 0;
+  _schedulerQueueCount = 0;
+  _schedulerQueueValid = false;
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    if (_schedulerBatch) {
+      free(_schedulerBatch);
+      _schedulerBatch = nullptr;
+    };
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+  #if CONFIG_SCHEDULER_WARMSTART
+    schedulerWarmDiscard();
+    if (_schedulerWarmBlob) {
+      free(_schedulerWarmBlob);
+      _schedulerWarmBlob = nullptr;
+    };
+    _schedulerWarmBlobCount = 0;
+  #endif // CONFIG_SCHEDULER_WARMSTART
+  #if CONFIG_SCHEDULER_FORECAST
+    schedulerForecastDiscard();
+  #endif // CONFIG_SCHEDULER_FORECAST
+  #if CONFIG_SCHEDULER_SOLAR
+    schedulerSolarDiscard();
+  #endif // CONFIG_SCHEDULER_SOLAR
+  #if CONFIG_SCHEDULER_TABLES
+    schedulerTablesDiscard();
+  #endif // CONFIG_SCHEDULER_TABLES
+}
+
+// The item is added on the next tick, but the handle can be used right away
+static schedulerHandle_t schedulerRegisterItem(timespan_t* timespan, const schedulerCron_t* cron, uint32_t value, 
+  schedulerCallback_t callback, void* arg)
+{
+  schedulerHandle_t handle = SCHEDULER_HANDLE_INVALID;
+  if (_schedulerRegistryLock) {
+    schedPortMutexLock(_schedulerRegistryLock);
+    schedulerChangesReclaim();
+    schedulerChange_t* change = _schedulerFreeHandles;
+    if (change) {
+      _schedulerFreeHandles = change->next;
+      uint32_t index = SCHEDULER_HANDLE_INDEX(change->handle);
+      handle = SCHEDULER_HANDLE_MAKE(index, _schedulerHandleGenerations[index]);
+    } else if (_schedulerHandleNext >= CONFIG_SCHEDULER_POOL_MAX) {
+      rlog_e(logTAG, "Too many scheduler items");
+    } else if ((_schedulerHandleNext < _schedulerPoolReserved) || schedulerPoolReserve()) {
+      change = schedulerChangeCreate(SCHEDULER_CHANGE_REGISTER, SCHEDULER_HANDLE_INVALID);
+      if (change) {
+        handle = SCHEDULER_HANDLE_MAKE(_schedulerHandleNext, _schedulerHandleGenerations[_schedulerHandleNext]);
+        _schedulerHandleNext++;
+      };
+    };
+    if (change) {
+      change->type = SCHEDULER_CHANGE_REGISTER;
+      change->handle = handle;
+      change->timespan = timespan;
+      change->cron = cron;
+      change->value = value;
+      change->callback = callback;
+      change->arg = arg;
+      schedulerChangeSubmit(change);
+    };
+    schedPortMutexUnlock(_schedulerRegistryLock);
+  };
+  return handle;
+}
+
+schedulerHandle_t schedulerRegister(timespan_t* timespan, uint32_t value)
+{
+  return timespan ? schedulerRegisterItem(timespan, nullptr, value, nullptr, nullptr) : SCHEDULER_HANDLE_INVALID;
+}
+
+schedulerHandle_t schedulerRegisterCron(const schedulerCron_t* cron, uint32_t value)
+{
+  return cron ? schedulerRegisterItem(nullptr, cron, value, nullptr, nullptr) : SCHEDULER_HANDLE_INVALID;
+}
+
+schedulerHandle_t schedulerRegisterCallback(timespan_t* timespan, schedulerCallback_t callback, void* arg)
+{
+  return timespan && callback ? schedulerRegisterItem(timespan, nullptr, 0, callback, arg) : SCHEDULER_HANDLE_INVALID;
+}
+
+schedulerHandle_t schedulerRegisterCronCallback(const schedulerCron_t* cron, schedulerCallback_t callback, void* arg)
+{
+  return cron && callback ? schedulerRegisterItem(nullptr, cron, 0, callback, arg) : SCHEDULER_HANDLE_INVALID;
+}
+
+static bool schedulerChangeHandle(schedulerChangeType_t type, schedulerHandle_t handle, timespan_t* timespan, const schedulerCron_t* cron, 
+  uint32_t value)
+{
+  bool ret = false;
+  if (_schedulerRegistryLock && (handle != SCHEDULER_HANDLE_INVALID)) {
+    schedPortMutexLock(_schedulerRegistryLock);
+    schedulerChangesReclaim();
+    uint32_t index = SCHEDULER_HANDLE_INDEX(handle);
+    if ((index < _schedulerHandleNext) && (SCHEDULER_HANDLE_GENERATION(handle) == _schedulerHandleGenerations[index])) {
+      schedulerChange_t* change = schedulerChangeCreate(type, handle);
+      if (change) {
+        change->timespan = timespan;
+        change->cron = cron;
+        change->value = value;
+        schedulerChangeSubmit(change);
+        if (type == SCHEDULER_CHANGE_UNREGISTER) {
+          // The handle becomes stale at once, the slot is reused after the timer has removed the item
+          _schedulerHandleGenerations[index] = (_schedulerHandleGenerations[index] + 1) & SCHEDULER_GENERATION_MASK;
+        };
+        ret = true;
+      };
+    };
+    schedPortMutexUnlock(_schedulerRegistryLock);
+  };
+  return ret;
+}
+
+// The item is rechecked on the next tick; an event is posted if its state changes. The kind of the item
+// (timespan or cron) cannot be changed
+bool schedulerUpdate(schedulerHandle_t handle, timespan_t* timespan)
+{
+  return timespan && schedulerChangeHandle(SCHEDULER_CHANGE_UPDATE, handle, timespan, nullptr, 0);
+}
+
+bool schedulerUpdateCron(schedulerHandle_t handle, const schedulerCron_t* cron)
+{
+  return cron && schedulerChangeHandle(SCHEDULER_CHANGE_UPDATE, handle, nullptr, cron, 0);
+}
+
+// Flags are applied on the next tick
+bool schedulerSetFlags(schedulerHandle_t handle, uint32_t flags)
+{
+  return schedulerChangeHandle(SCHEDULER_CHANGE_FLAGS, handle, nullptr, nullptr, flags);
+}
+
+// The item is removed on the next tick without posting any events, after that the handle may be reused
+bool schedulerUnregister(schedulerHandle_t handle)
+{
+  return schedulerChangeHandle(SCHEDULER_CHANGE_UNREGISTER, handle, nullptr, nullptr, 0);
+}
+
+void schedulerMemoryStats(schedulerMemoryStats_t* stats)
+{
+  if (stats) {
+    stats->count = _schedulerPoolLive;
+    stats->capacity = _schedulerPoolSize;
+    stats->item_bytes = SCHEDULER_POOL_ITEM_BYTES;
+    stats->pool_bytes = schedulerPoolBytes(_schedulerPoolSize) + SCHEDULER_HEAP_BLOCK_OVERHEAD;
+    stats->list_bytes = _schedulerPoolLive * (SCHEDULER_LIST_NODE_SIZE + SCHEDULER_HEAP_BLOCK_OVERHEAD + sizeof(void*))
+      + 2 * SCHEDULER_HEAP_BLOCK_OVERHEAD;
+  };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Warm start -----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_WARMSTART
+
+#define SCHEDULER_WARMSTART_KEY     "states"
+#define SCHEDULER_WARMSTART_VERSION 1
+
+// Snapshot in NVS: header, values of the items, bitset of their states
+typedef struct {
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t count;
+} schedulerWarmHeader_t;
+
+#define SCHEDULER_WARMSTART_SIZE(count) (sizeof(schedulerWarmHeader_t) + (count) * sizeof(uint32_t) \
+  + SCHEDULER_BITSET_WORDS(count) * sizeof(uint32_t))
+
+static uint32_t schedulerWarmHash(const uint8_t* data, size_t size)
+{
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 16777619UL;
+  };
+  return hash;
+}
+
+static int schedulerWarmCompare(const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void schedulerWarmDiscard()
+{
+  if (_schedulerWarmSaved) {
+    free(_schedulerWarmSaved);
+    _schedulerWarmSaved = nullptr;
+  };
+  _schedulerWarmCount = 0;
+}
+
+// Read the states saved before the restart (called before the timer is created)
+static void schedulerWarmLoad()
+{
+  schedulerWarmDiscard();
+  memset(&_schedulerWarmStats, 0, sizeof(_schedulerWarmStats));
+  _schedulerWarmLast = schedPortMonotonicUs();
+  size_t size = 0;
+  if (!schedPortStoreRead(SCHEDULER_WARMSTART_KEY, nullptr, &size) || (size < sizeof(schedulerWarmHeader_t))) {
+    return;
+  };
+  uint8_t* blob = (uint8_t*)esp_calloc(1, size);
+  RE_MEM_CHECK(blob, return);
+  if (schedPortStoreRead(SCHEDULER_WARMSTART_KEY, blob, &size) && (size >= sizeof(schedulerWarmHeader_t))) {
+    schedulerWarmHeader_t* header = (schedulerWarmHeader_t*)blob;
+    if ((header->version == SCHEDULER_WARMSTART_VERSION) && (size == SCHEDULER_WARMSTART_SIZE(header->count))) {
+      _schedulerWarmSaved = (uint64_t*)esp_calloc(header->count > 0 ? header->count : 1, sizeof(uint64_t));
+      if (_schedulerWarmSaved) {
+        const uint32_t* values = (const uint32_t*)(blob + sizeof(schedulerWarmHeader_t));
+        const uint32_t* states = values + header->count;
+        for (uint32_t i = 0; i < header->count; i++) {
+          _schedulerWarmSaved[i] = ((uint64_t)values[i] << 2) | schedulerBitGet(states, i);
+        };
+        qsort(_schedulerWarmSaved, header->count, sizeof(uint64_t), schedulerWarmCompare);
+        _schedulerWarmCount = header->count;
+        _schedulerWarmHash = schedulerWarmHash(blob, size);
+        _schedulerWarmStats.loaded = header->count;
+        rlog_i(logTAG, "Restored states of %d schedules", header->count);
+      };
+    } else {
+      rlog_w(logTAG, "Saved states of schedules have an incompatible format and are ignored");
+    };
+  };
+  free(blob);
+}
+
+// The item gets the state saved for the same value, each saved state is claimed only once
+static void schedulerWarmRestore(uint32_t index)
+{
+  if (!_schedulerWarmSaved) return;
+  uint32_t value = _schedulerPool[index].value;
+  uint64_t key = (uint64_t)value << 2;
+  uint32_t lo = 0;
+  uint32_t hi = _schedulerWarmCount;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (_schedulerWarmSaved[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    };
+  };
+  for (; (lo < _schedulerWarmCount) && ((_schedulerWarmSaved[lo] >> 2) == value); lo++) {
+    if (!(_schedulerWarmSaved[lo] & 2)) {
+      _schedulerWarmSaved[lo] |= 2;
+      schedulerBitSet(_schedulerKnown, index, true);
+      schedulerBitSet(_schedulerStates, index, _schedulerWarmSaved[lo] & 1);
+      _schedulerWarmStats.restored++;
+      return;
+    };
+  };
+}
+
+// Enlarge the snapshot to the capacity of the pool (under _schedulerRegistryLock or before the timer is created)
+static bool schedulerWarmReserve(uint32_t count)
+{
+  if (_schedulerWarmBlob && (count <= _schedulerWarmBlobCount)) return true;
+  uint8_t* blob = (uint8_t*)esp_calloc(1, SCHEDULER_WARMSTART_SIZE(count));
+  RE_MEM_CHECK(blob, return false);
+  if (_schedulerWarmBlob) free(_schedulerWarmBlob);
+  _schedulerWarmBlob = blob;
+  _schedulerWarmBlobCount = count;
+  return true;
+}
+
+// Fill the snapshot with the states of all evaluated timespans, returns its size (0 if it does not fit)
+static size_t schedulerWarmBuild()
+{
+  uint32_t count = 0;
+  for (uint32_t w = 0; w < SCHEDULER_BITSET_WORDS(_schedulerPoolCount); w++) {
+    uint32_t bits = _schedulerKnown[w] & _schedulerLive[w] & ~_schedulerCrons[w];
+    while (bits) {
+      count += _schedulerPool[w * 32 + __builtin_ctz(bits)].callback ? 0 : 1;
+      bits &= bits - 1;
+    };
+  };
+  if (count > _schedulerWarmBlobCount) return 0;
+  size_t size = SCHEDULER_WARMSTART_SIZE(count);
+  memset(_schedulerWarmBlob, 0, size);
+  schedulerWarmHeader_t* header = (schedulerWarmHeader_t*)_schedulerWarmBlob;
+  header->version = SCHEDULER_WARMSTART_VERSION;
+  header->count = count;
+  uint32_t* values = (uint32_t*)(_schedulerWarmBlob + sizeof(schedulerWarmHeader_t));
+  uint32_t* states = values + count;
+  uint32_t n = 0;
+  for (uint32_t i = 0; (i < _schedulerPoolCount) && (n < count); i++) {
+    if (schedulerBitGet(_schedulerKnown, i) && schedulerBitGet(_schedulerLive, i) && !schedulerBitGet(_schedulerCrons, i)
+     && !_schedulerPool[i].callback) {
+      values[n] = _schedulerPool[i].value;
+      schedulerBitSet(states, n, schedulerBitGet(_schedulerStates, i));
+      n++;
+    };
+  };
+  return size;
+}
+
+// Take the snapshot and write it to NVS, in the event loop or the worker task but never in the esp_timer task.
+// The pool is read while the timer may change it (as by schedulerForecast()): the snapshot is accepted only if the
+// version has not changed meanwhile
+static void schedulerWarmWrite()
+{
+  if (!_schedulerRegistryLock) return;
+  schedPortMutexLock(_schedulerRegistryLock);
+  size_t size = 0;
+  if (_schedulerWarmBlob && _schedulerPool) {
+    for (uint8_t attempt = 0; (attempt < 3) && (size == 0); attempt++) {
+      uint32_t version = __atomic_load_n(&_schedulerRegistryVersion, __ATOMIC_ACQUIRE);
+      if (version & 1) {
+        schedPortDelayMs(1);
+        continue;
+      };
+      size = schedulerWarmBuild();
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&_schedulerRegistryVersion, __ATOMIC_RELAXED) != version) {
+        size = 0;
+      };
+    };
+  };
+  if (size == 0) {
+    // One more attempt after the interval
+    _schedulerWarmDirty = true;
+  } else if (schedulerWarmHash(_schedulerWarmBlob, size) == _schedulerWarmHash) {
+    // Transitions that cancelled each other out do not wear the flash
+    _schedulerWarmStats.skipped++;
+  } else if (schedPortStoreWrite(SCHEDULER_WARMSTART_KEY, _schedulerWarmBlob, size)) {
+    _schedulerWarmHash = schedulerWarmHash(_schedulerWarmBlob, size);
+    _schedulerWarmStats.writes++;
+    rlog_d(logTAG, "States of %d schedules saved", ((schedulerWarmHeader_t*)_schedulerWarmBlob)->count);
+  } else {
+    rlog_e(logTAG, "Failed to save states of schedules");
+  };
+  schedPortMutexUnlock(_schedulerRegistryLock);
+}
+
+// Called by the tick: the states are saved if they have changed and the interval has passed. The snapshot is taken by
+// the worker right away or by the event loop task on RE_TIME_WARMSTART_SAVE, so that the flash is not written by esp_timer
+static void schedulerWarmSave()
+{
+  int64_t now = schedPortMonotonicUs();
+  if (now - _schedulerWarmLast < (int64_t)CONFIG_SCHEDULER_WARMSTART_INTERVAL * 1000000) return;
+  // Saved states not claimed by this time belong to items that are no longer registered
+  schedulerWarmDiscard();
+  if (!_schedulerWarmDirty) return;
+  _schedulerWarmDirty = false;
+  _schedulerWarmLast = now;
+  #if CONFIG_SCHEDULER_WORKER
+    if (_schedulerWorker) {
+      schedulerWarmWrite();
+      return;
+    };
+  #endif // CONFIG_SCHEDULER_WORKER
+  if (!eventLoopPost(RE_TIME_EVENTS, RE_TIME_WARMSTART_SAVE, nullptr, 0, 0)) {
+    // The event queue is full: one more attempt on the next tick
+    _schedulerWarmDirty = true;
+    _schedulerWarmLast = now - (int64_t)CONFIG_SCHEDULER_WARMSTART_INTERVAL * 1000000;
+  };
+}
+
+void schedulerWarmStartSave()
+{
+  schedulerWarmWrite();
+}
+
+void schedulerWarmStartStats(schedulerWarmStartStats_t* stats)
+{
+  if (stats) {
+    *stats = _schedulerWarmStats;
+  };
+}
+
+#endif // CONFIG_SCHEDULER_WARMSTART
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Load smoothing ---------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_SPREAD
+
+// Devices with the same schedules would post their transitions in the same second. Deferred events wait in the queue 
+// (written by the tick, read by the dispatch timer) and are posted after the delay of this device, a limited number per second
+#define SCHEDULER_SPREAD_DATETIME -1        // Publication of the date and time, value: time of the tick
+
+typedef struct {
+  int32_t event;
+  uint32_t value;
+} schedulerSpreadRecord_t;
+
+static schedulerSpreadRecord_t _schedulerSpreadQueue[CONFIG_SCHEDULER_SPREAD_QUEUE];
+static uint32_t _schedulerSpreadHead = 0;
+static uint32_t _schedulerSpreadTail = 0;
+static schedPortTimer_t _schedulerTimerSpread = nullptr;
+static uint32_t _schedulerSpreadDelayMs = 0;
+static schedulerSpreadStats_t _schedulerSpreadStats = { 0, 0, 0, 0, 0, 0 };
+#if CONFIG_SCHEDULER_BATCH_EVENTS
+static schedulerTransitions_t* _schedulerSpreadBatch = nullptr;
+#endif // CONFIG_SCHEDULER_BATCH_EVENTS
+
+// The same device always gets the same delay, different devices are spread evenly
+static uint32_t schedulerSpreadDelay()
+{
+  uint32_t hash = schedPortDeviceId();
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BUL;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35UL;
+  hash ^= hash >> 16;
+  return CONFIG_SCHEDULER_SPREAD_MAX_MS > 0 ? hash % CONFIG_SCHEDULER_SPREAD_MAX_MS : 0;
+}
+
+static bool schedulerSpreadPush(int32_t event, uint32_t value)
+{
+  if (!_schedulerTimerSpread) return false;
+  uint32_t head = _schedulerSpreadHead;
+  uint32_t length = head - __atomic_load_n(&_schedulerSpreadTail, __ATOMIC_ACQUIRE);
+  if (length >= CONFIG_SCHEDULER_SPREAD_QUEUE) {
+    _schedulerSpreadStats.overflows++;
+    return false;
+  };
+  _schedulerSpreadQueue[head % CONFIG_SCHEDULER_SPREAD_QUEUE].event = event;
+  _schedulerSpreadQueue[head % CONFIG_SCHEDULER_SPREAD_QUEUE].value = value;
+  __atomic_store_n(&_schedulerSpreadHead, head + 1, __ATOMIC_RELEASE);
+  _schedulerSpreadStats.deferred++;
+  if (length + 1 > _schedulerSpreadStats.queue_max) {
+    _schedulerSpreadStats.queue_max = length + 1;
+  };
+  return true;
+}
+
+// Returns false if the event must be posted right away
+static bool schedulerSpreadDefer(uint32_t index, int32_t event, uint32_t value)
+{
+  return !schedulerBitGet(_schedulerImmediate, index) && schedulerSpreadPush(event, value);
+}
+
+#if CONFIG_MQTT_TIME_ENABLE
+static void schedulerSpreadDateTime(struct tm* nowS, time_t nowT)
+{
+  if (!schedulerSpreadPush(SCHEDULER_SPREAD_DATETIME, (uint32_t)nowT)) {
+    mqttPublishDateTime(nowS);
+  };
+}
+#endif // CONFIG_MQTT_TIME_ENABLE
+
+// Events are posted without waiting: the dispatch runs in the esp_timer task, which must not be blocked by a full event queue
+static bool schedulerSpreadPost(schedulerSpreadRecord_t* record)
+{
+  switch (record->event) {
+    #if CONFIG_MQTT_TIME_ENABLE
+    case SCHEDULER_SPREAD_DATETIME:
+      {
+        time_t time = record->value;
+        struct tm timeinfo;
+        schedulerClockLocal(time, &timeinfo);
+        mqttPublishDateTime(&timeinfo);
+      };
+      return true;
+    #endif // CONFIG_MQTT_TIME_ENABLE
+    case RE_TIME_CRON:
+      return schedulerEventPost(RE_TIME_CRON, &record->value, sizeof(record->value), 0);
+    default:
+      return schedulerEventPost(record->event, (void*)(uintptr_t)(record->value), sizeof(record->value), 0);
+  };
+}
+
+// One round: no more than CONFIG_SCHEDULER_SPREAD_RATE events, the rest a second later. If the event queue is full,
+// the round ends and the events that were not posted stay in the queue for the next one
+static void schedulerSpreadExec(void* arg)
+{
+  uint32_t tail = _schedulerSpreadTail;
+  uint32_t done = tail;    // Records already posted
+  uint32_t count = 0;
+  bool posted = true;
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    struct timeval now;
+    schedulerClockWall(&now);
+    schedulerBatchStart(_schedulerSpreadBatch, now.tv_sec);
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+  while (posted && (tail != __atomic_load_n(&_schedulerSpreadHead, __ATOMIC_ACQUIRE))
+      && ((CONFIG_SCHEDULER_SPREAD_RATE == 0) || (count < CONFIG_SCHEDULER_SPREAD_RATE))) {
+    schedulerSpreadRecord_t* record = &_schedulerSpreadQueue[tail % CONFIG_SCHEDULER_SPREAD_QUEUE];
+    #if CONFIG_SCHEDULER_BATCH_EVENTS
+      if ((record->event == RE_TIME_TIMESPAN_ON) || (record->event == RE_TIME_TIMESPAN_OFF)) {
+        // Transitions are posted with their batch: they are done only when it is
+        if (_schedulerSpreadBatch->count >= CONFIG_SCHEDULER_BATCH_SIZE) {
+          posted = schedulerBatchPost(_schedulerSpreadBatch, false, 0);
+          if (!posted) break;
+          done = tail;
+        };
+        schedulerBatchAdd(_schedulerSpreadBatch, record->value, record->event == RE_TIME_TIMESPAN_ON);
+        tail++;
+        count++;
+        continue;
+      };
+      // Other events keep their order relative to the transitions
+      posted = schedulerBatchPost(_schedulerSpreadBatch, false, 0);
+      if (!posted) break;
+      done = tail;
+    #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+    posted = schedulerSpreadPost(record);
+    if (posted) {
+      done = ++tail;
+      count++;
+    };
+  };
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    if (posted) {
+      posted = schedulerBatchPost(_schedulerSpreadBatch, true, 0);
+      if (posted) done = tail;
+    };
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+  __atomic_store_n(&_schedulerSpreadTail, done, __ATOMIC_RELEASE);
+  _schedulerSpreadStats.rounds++;
+  if (!posted) {
+    _schedulerSpreadStats.stalls++;
+  };
+  if (done != __atomic_load_n(&_schedulerSpreadHead, __ATOMIC_ACQUIRE)) {
+    RE_OK_CHECK(schedPortTimerStartOnce(_schedulerTimerSpread, 1000000), return);
+  };
+}
+
+// Called at the end of the tick: the delay is counted from the boundary (wall time)
+static void schedulerSpreadArm(time_t boundary)
+{
+  if (_schedulerTimerSpread && (_schedulerSpreadTail != __atomic_load_n(&_schedulerSpreadHead, __ATOMIC_ACQUIRE))
+   && !schedPortTimerIsActive(_schedulerTimerSpread)) {
+    struct timeval now;
+    schedulerClockWall(&now);
+    int64_t elapsed_us = ((int64_t)now.tv_sec - boundary) * 1000000 + now.tv_usec;
+    int64_t timeout_us = (int64_t)_schedulerSpreadDelayMs * 1000 - elapsed_us;
+    schedPortTimerStartOnce(_schedulerTimerSpread, timeout_us > 0 ? timeout_us : 1);
+  };
+}
+
+static bool schedulerSpreadCreate()
+{
+  if (!_schedulerTimerSpread) {
+    _schedulerSpreadDelayMs = schedulerSpreadDelay();
+    memset(&_schedulerSpreadStats, 0, sizeof(_schedulerSpreadStats));
+    _schedulerSpreadStats.delay_ms = _schedulerSpreadDelayMs;
+    #if CONFIG_SCHEDULER_BATCH_EVENTS
+      if (!_schedulerSpreadBatch) {
+        _schedulerSpreadBatch = (schedulerTransitions_t*)esp_calloc(1, SCHEDULER_TRANSITIONS_SIZE(CONFIG_SCHEDULER_BATCH_SIZE));
+        RE_MEM_CHECK(_schedulerSpreadBatch, return false);
+        _schedulerSpreadBatch->item_size = sizeof(schedulerTransition_t);
+      };
+    #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+    RE_OK_CHECK(schedPortTimerCreate("scheduler_spread", schedulerSpreadExec, &_schedulerTimerSpread), return false);
+    rlog_i(logTAG, "Events of schedules are delayed by %d ms", _schedulerSpreadDelayMs);
+  };
+  return true;
+}
+
+// Deferred events that were not posted yet are dropped
+static void schedulerSpreadDelete()
+{
+  if (_schedulerTimerSpread) {
+    if (schedPortTimerIsActive(_schedulerTimerSpread)) {
+      schedPortTimerStop(_schedulerTimerSpread);
+    };
+    RE_OK_CHECK(schedPortTimerDelete(_schedulerTimerSpread), return);
+    _schedulerTimerSpread = nullptr;
+  };
+  _schedulerSpreadHead = 0;
+  _schedulerSpreadTail = 0;
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    if (_schedulerSpreadBatch) {
+      free(_schedulerSpreadBatch);
+      _schedulerSpreadBatch = nullptr;
+    };
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+}
+
+void schedulerSpreadStats(schedulerSpreadStats_t* stats)
+{
+  if (stats) {
+    *stats = _schedulerSpreadStats;
+  };
+}
+
+#endif // CONFIG_SCHEDULER_SPREAD
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Shards --------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_SHARDS > 1
+
+static_assert(CONFIG_SCHEDULER_SHARDS <= 8, "CONFIG_SCHEDULER_SHARDS must not exceed 8");
+
+#define SCHEDULER_SHARDS_HELPERS (((1UL << CONFIG_SCHEDULER_SHARDS) - 1) & ~1UL)   // Bits of the shards run by the helpers
+
+// Part of a job, the data of the job are passed through static variables
+typedef void (*schedulerShardJob_t)(uint32_t shard, uint32_t count);
+
+static schedPortTask_t _schedulerShardTasks[CONFIG_SCHEDULER_SHARDS];   // Shard 0 is run by the calling task
+static schedPortEvents_t _schedulerShardsDone = nullptr;
+static volatile bool _schedulerShardsActive = false;
+static uint32_t _schedulerShardsCreated = 0;
+static uint32_t _schedulerShardsClaimed = 0;
+static schedulerShardJob_t _schedulerShardJob = nullptr;
+static uint32_t _schedulerShardTime[CONFIG_SCHEDULER_SHARDS];
+static schedulerShardsStats_t _schedulerShardsStats = { CONFIG_SCHEDULER_SHARDS, 0, 0, 0, 0, 0, 0 };
+
+// First and last + 1 element of the shard
+static inline void schedulerShardRange(uint32_t shard, uint32_t count, uint32_t total, uint32_t* first, uint32_t* last)
+{
+  *first = (uint32_t)((uint64_t)total * shard / count);
+  *last = (uint32_t)((uint64_t)total * (shard + 1) / count);
+}
+
+static void schedulerShardTimed(uint32_t shard)
+{
+  int64_t started = schedPortMonotonicUs();
+  _schedulerShardJob(shard, CONFIG_SCHEDULER_SHARDS);
+  _schedulerShardTime[shard] = (uint32_t)(schedPortMonotonicUs() - started);
+}
+
+static void schedulerShardExec(void* arg)
+{
+  // Helpers take the numbers of their shards in the order they start
+  uint32_t shard = __atomic_add_fetch(&_schedulerShardsClaimed, 1, __ATOMIC_ACQ_REL);
+  while (_schedulerShardsActive) {
+    schedPortTaskWait();
+    if (_schedulerShardsActive) {
+      schedulerShardTimed(shard);
+      schedPortEventsUpdate(_schedulerShardsDone, 1UL << shard, 0);
+    };
+  };
+  schedPortEventsUpdate(_schedulerShardsDone, 1UL << shard, 0);
+  schedPortTaskExit();
+}
+
+static void schedulerShardsWait(uint32_t bits)
+{
+  uint32_t pending = bits;
+  while (pending) {
+    pending &= ~schedPortEventsWait(_schedulerShardsDone, pending, UINT32_MAX);
+  };
+  schedPortEventsUpdate(_schedulerShardsDone, 0, bits);
+}
+
+static void schedulerShardsDelete()
+{
+  if (_schedulerShardsActive) {
+    _schedulerShardsActive = false;
+    for (uint32_t i = 1; i <= _schedulerShardsCreated; i++) {
+      schedPortTaskNotify(_schedulerShardTasks[i]);
+    };
+    schedulerShardsWait(((1UL << (_schedulerShardsCreated + 1)) - 1) & ~1UL);
+    for (uint32_t i = 1; i <= _schedulerShardsCreated; i++) {
+      _schedulerShardTasks[i] = nullptr;
+    };
+    _schedulerShardsCreated = 0;
+    rlog_i(logTAG, "Tasks [scheduler_shard] were deleted");
+  };
+}
+
+static bool schedulerShardsCreate()
+{
+  if (!_schedulerShardsDone) {
+    _schedulerShardsDone = schedPortEventsCreate();
+    RE_MEM_CHECK(_schedulerShardsDone, return false);
+  };
+  if (!_schedulerShardsActive) {
+    _schedulerShardsClaimed = 0;
+    _schedulerShardsCreated = 0;
+    _schedulerShardsActive = true;
+    for (uint32_t i = 1; i < CONFIG_SCHEDULER_SHARDS; i++) {
+      RE_OK_CHECK(schedPortTaskCreate("scheduler_shard", schedulerShardExec, CONFIG_SCHEDULER_SHARDS_STACK_SIZE, 
+        CONFIG_SCHEDULER_SHARDS_PRIORITY, i % SCHED_PORT_CORES, &_schedulerShardTasks[i]), schedulerShardsDelete(); return false);
+      _schedulerShardsCreated = i;
+    };
+    rlog_i(logTAG, "Tasks [scheduler_shard] were created: %d", CONFIG_SCHEDULER_SHARDS - 1);
+  };
+  return true;
+}
+
+// Runs all shards of the job and returns when they are done; without helpers (replay before the start) one after another
+static void schedulerShardsRun(schedulerShardJob_t job, uint32_t items)
+{
+  _schedulerShardJob = job;
+  int64_t started = schedPortMonotonicUs();
+  if (_schedulerShardsActive) {
+    for (uint32_t i = 1; i < CONFIG_SCHEDULER_SHARDS; i++) {
+      schedPortTaskNotify(_schedulerShardTasks[i]);
+    };
+    schedulerShardTimed(0);
+    schedulerShardsWait(SCHEDULER_SHARDS_HELPERS);
+  } else {
+    for (uint32_t i = 0; i < CONFIG_SCHEDULER_SHARDS; i++) {
+      schedulerShardTimed(i);
+    };
+  };
+  uint32_t critical = 0;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_SHARDS; i++) {
+    _schedulerShardsStats.busy_us += _schedulerShardTime[i];
+    if (_schedulerShardTime[i] > critical) critical = _schedulerShardTime[i];
+  };
+  _schedulerShardsStats.critical_us += critical;
+  _schedulerShardsStats.eval_us += (uint32_t)(schedPortMonotonicUs() - started);
+  _schedulerShardsStats.items += items;
+  _schedulerShardsStats.runs++;
+}
+
+void schedulerShardsStats(schedulerShardsStats_t* stats)
+{
+  if (stats) {
+    *stats = _schedulerShardsStats;
+  };
+}
+
+#endif // CONFIG_SCHEDULER_SHARDS
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------- Transition queue ---------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#define SCHEDULER_MINUTES_PER_DAY 1440
+
+static inline uint16_t schedulerHHMMToMinutes(uint16_t hhmm)
+{
+  return (hhmm / 100) * 60 + (hhmm % 100);
+}
+
+// Number of minutes from nowMin to the nearest boundary of the timespan (1...1440)
+static uint16_t schedulerTimespanEdgeDelta(uint16_t nowMin, timespan_t timespan)
+{
+  uint16_t dBegin = (schedulerHHMMToMinutes(timespan / 10000) + SCHEDULER_MINUTES_PER_DAY - nowMin) % SCHEDULER_MINUTES_PER_DAY;
+  uint16_t dEnd = (schedulerHHMMToMinutes(timespan % 10000) + SCHEDULER_MINUTES_PER_DAY - nowMin) % SCHEDULER_MINUTES_PER_DAY;
+  if (dBegin == 0) dBegin = SCHEDULER_MINUTES_PER_DAY;
+  if (dEnd == 0) dEnd = SCHEDULER_MINUTES_PER_DAY;
+  return dBegin < dEnd ? dBegin : dEnd;
+}
+
+// Time of the nearest boundary of the timespan after nowT (an empty timespan is simply rechecked once a day)
+static time_t schedulerTimespanNextEdge(struct tm* nowS, time_t nowT, timespan_t timespan)
+{
+  return nowT - nowS->tm_sec + 60 * (time_t)schedulerTimespanEdgeDelta(nowS->tm_hour * 60 + nowS->tm_min, timespan);
+}
+
+// Transition of an item without a callback (or of any item during the replay)
+static void schedulerTransitionPost(uint32_t value, bool state, bool immediate)
+{
+  #if CONFIG_SCHEDULER_REPLAY
+    if (_schedulerReplayLog) {
+      _schedulerReplayTransitions++;
+      schedulerReplayWrite(state ? RE_TIME_TIMESPAN_ON : RE_TIME_TIMESPAN_OFF, value);
+      return;
+    };
+  #endif // CONFIG_SCHEDULER_REPLAY
+  #if CONFIG_SCHEDULER_WARMSTART
+    _schedulerWarmDirty = true;
+  #endif // CONFIG_SCHEDULER_WARMSTART
+  #if CONFIG_SCHEDULER_SPREAD
+    if (!immediate && schedulerSpreadPush(state ? RE_TIME_TIMESPAN_ON : RE_TIME_TIMESPAN_OFF, value)) return;
+  #endif // CONFIG_SCHEDULER_SPREAD
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    schedulerBatchAdd(_schedulerBatch, value, state);
+  #else
+  if (state) {
+    schedulerEventPost(RE_TIME_TIMESPAN_ON, (void*)(uintptr_t)(value), sizeof(value), TIME_EVENTS_POST_TIMEOUT);
+  } else {
+    schedulerEventPost(RE_TIME_TIMESPAN_OFF, (void*)(uintptr_t)(value), sizeof(value), TIME_EVENTS_POST_TIMEOUT);
+  };
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+}
+
+static void schedulerItemPost(schedulerItem_t* item, bool state)
+{
+  SCHEDULER_STAT_TICK(Transitions, 1);
+  uint32_t index = item - _schedulerPool;
+  if (item->callback && !SCHEDULER_REPLAYING) {
+    item->callback(SCHEDULER_HANDLE_MAKE(index, item->generation), state, item->arg);
+    return;
+  };
+  schedulerTransitionPost(item->callback ? SCHEDULER_HANDLE_MAKE(index, item->generation) : item->value, state, 
+    schedulerBitGet(_schedulerImmediate, index));
+}
+
+static void schedulerCronPost(schedulerItem_t* item)
+{
+  SCHEDULER_STAT_TICK(Transitions, 1);
+  #if CONFIG_SCHEDULER_REPLAY
+    if (_schedulerReplayLog) {
+      _schedulerReplayTransitions++;
+      schedulerReplayWrite(RE_TIME_CRON, item->callback ? SCHEDULER_HANDLE_MAKE(item - _schedulerPool, item->generation) : item->value);
+      return;
+    };
+  #endif // CONFIG_SCHEDULER_REPLAY
+  if (item->callback) {
+    item->callback(SCHEDULER_HANDLE_MAKE(item - _schedulerPool, item->generation), true, item->arg);
+    return;
+  };
+  #if CONFIG_SCHEDULER_SPREAD
+    if (schedulerSpreadDefer(item - _schedulerPool, RE_TIME_CRON, item->value)) return;
+  #endif // CONFIG_SCHEDULER_SPREAD
+  schedulerEventPost(RE_TIME_CRON, &item->value, sizeof(item->value), TIME_EVENTS_POST_TIMEOUT);
+}
+
+// If a cron schedule never fires, it is rechecked once a day
+static void schedulerCronEdge(schedulerItem_t* item, struct tm* nowS, time_t nowT)
+{
+  time_t next = schedulerCronNext(item->cron, nowT);
+  item->edge = next > nowT ? next : nowT - nowS->tm_sec + 86400;
+}
+
+#if CONFIG_SCHEDULER_SHARDS <= 1
+
+// A cron schedule fires at the matching minute (with shards the due items are checked by schedulerQueueDueShard())
+static void schedulerCronCheck(schedulerItem_t* item, struct tm* nowS, time_t nowT)
+{
+  if (schedulerCronMatch(item->cron, nowS)) {
+    schedulerCronPost(item);
+  };
+  schedulerCronEdge(item, nowS, nowT);
+}
+
+static void schedulerItemCheck(uint32_t index, struct tm* nowS, time_t nowT)
+{
+  schedulerItem_t* item = &_schedulerPool[index];
+  if (schedulerBitGet(_schedulerCrons, index)) {
+    SCHEDULER_STAT_TICK(Items, 1);
+    schedulerCronCheck(item, nowS, nowT);
+    return;
+  };
+  bool newState = checkTimespan(nowS, *item->timespan);
+  SCHEDULER_STAT_TICK(Items, 1);
+  if (!schedulerBitGet(_schedulerKnown, index) || (newState != schedulerBitGet(_schedulerStates, index))) {
+    schedulerBitSet(_schedulerKnown, index, true);
+    schedulerBitSet(_schedulerStates, index, newState);
+    schedulerItemPost(item, newState);
+  };
+  item->edge = schedulerTimespanNextEdge(nowS, nowT, *item->timespan);
+}
+
+#endif // CONFIG_SCHEDULER_SHARDS
+
+// Packed copy of a timespan in the HHMM form of checkTimespan(): begin is limited to 10000, this keeps all comparisons 
+// with the current time (0...2359) and with the end (0...9999) unchanged
+static inline void schedulerSpanPack(uint32_t index, timespan_t timespan)
+{
+  uint32_t begin = timespan / 10000;
+  _schedulerSpanBegin[index] = begin > 10000 ? 10000 : begin;
+  _schedulerSpanEnd[index] = timespan % 10000;
+}
+
+static inline uint32_t schedulerSpanInside(uint16_t begin, uint16_t end, uint16_t now)
+{
+  uint32_t afterBegin = now >= begin;
+  uint32_t beforeEnd = now < end;
+  uint32_t wrap = begin >= end;
+  return ((afterBegin & beforeEnd) | (wrap & (afterBegin | beforeEnd))) & ((begin | end) != 0);
+}
+
+// Equivalent of checkTimespan() for all items at once: the flags of 32 items are calculated without branches
+// (this loop is vectorized by the compiler), then packed into a word eight at a time
+static void schedulerSpanEvaluate(const uint16_t* begin, const uint16_t* end, uint32_t count, uint16_t now, uint32_t* bits)
+{
+  uint8_t flags[32];
+  for (uint32_t w = 0; w < SCHEDULER_BITSET_WORDS(count); w++) {
+    uint32_t n = count - w * 32 < 32 ? count - w * 32 : 32;
+    if (n == 32) {
+      for (uint32_t i = 0; i < 32; i++) {
+        flags[i] = schedulerSpanInside(begin[w * 32 + i], end[w * 32 + i], now);
+      };
+    } else {
+      memset(flags, 0, sizeof(flags));
+      for (uint32_t i = 0; i < n; i++) {
+        flags[i] = schedulerSpanInside(begin[w * 32 + i], end[w * 32 + i], now);
+      };
+    };
+    uint32_t word = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+      uint64_t octet;
+      memcpy(&octet, &flags[i * 8], sizeof(octet));
+      // Moves the lowest bit of every byte (little-endian) to the top byte of the product
+      word |= (uint32_t)((octet * 0x0102040810204080ULL) >> 56) << (i * 8);
+    };
+    bits[w] = word;
+  };
+}
+
+static void schedulerQueueSiftDown(uint32_t index)
+{
+  schedulerIndex_t item = _schedulerQueue[index];
+  time_t edge = _schedulerPool[item].edge;
+  while (true) {
+    uint32_t child = 2 * index + 1;
+    if (child >= _schedulerQueueCount) break;
+    if ((child + 1 < _schedulerQueueCount) && (_schedulerPool[_schedulerQueue[child + 1]].edge < _schedulerPool[_schedulerQueue[child]].edge)) {
+      child++;
+    };
+    if (edge <= _schedulerPool[_schedulerQueue[child]].edge) break;
+    _schedulerQueue[index] = _schedulerQueue[child];
+    _schedulerQueuePos[_schedulerQueue[index]] = index;
+    index = child;
+  };
+  _schedulerQueue[index] = item;
+  _schedulerQueuePos[item] = index;
+}
+
+static void schedulerQueueSiftUp(uint32_t index)
+{
+  schedulerIndex_t item = _schedulerQueue[index];
+  time_t edge = _schedulerPool[item].edge;
+  while (index > 0) {
+    uint32_t parent = (index - 1) / 2;
+    if (_schedulerPool[_schedulerQueue[parent]].edge <= edge) break;
+    _schedulerQueue[index] = _schedulerQueue[parent];
+    _schedulerQueuePos[_schedulerQueue[index]] = index;
+    index = parent;
+  };
+  _schedulerQueue[index] = item;
+  _schedulerQueuePos[item] = index;
+}
+
+static void schedulerQueueInvalidate()
+{
+  #if CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+    __atomic_add_fetch(&_schedulerRegistryVersion, 2, __ATOMIC_RELEASE);
+  #endif // CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+  _schedulerQueueValid = false;
+  schedulerTimerMainWakeup();
+}
+
+// Part of the full check for whole words of the bitsets: packed timespans, states and next transitions of the items.
+// Cron schedules get the match of the current minute as their state
+static void schedulerQueueRebuildRange(uint32_t firstWord, uint32_t lastWord, struct tm* nowS, time_t nowT)
+{
+  uint32_t first = firstWord * 32;
+  uint32_t last = lastWord * 32 < _schedulerPoolCount ? lastWord * 32 : _schedulerPoolCount;
+  if (first >= last) return;
+  for (uint32_t i = first; i < last; i++) {
+    schedulerSpanPack(i, _schedulerPool[i].timespan && !schedulerBitGet(_schedulerCrons, i) ? *_schedulerPool[i].timespan : 0);
+  };
+  schedulerSpanEvaluate(_schedulerSpanBegin + first, _schedulerSpanEnd + first, last - first, nowS->tm_hour * 100 + nowS->tm_min, 
+    _schedulerEval + firstWord);
+  for (uint32_t i = first; i < last; i++) {
+    if (_schedulerPool[i].timespan) {
+      if (schedulerBitGet(_schedulerCrons, i)) {
+        schedulerBitSet(_schedulerEval, i, schedulerCronMatch(_schedulerPool[i].cron, nowS));
+        schedulerCronEdge(&_schedulerPool[i], nowS, nowT);
+      } else {
+        _schedulerPool[i].edge = schedulerTimespanNextEdge(nowS, nowT, *_schedulerPool[i].timespan);
+      };
+    };
+  };
+}
+
+#if CONFIG_SCHEDULER_SHARDS > 1
+
+static struct tm* _schedulerShardNowS = nullptr;
+static time_t _schedulerShardNowT = 0;
+
+static void schedulerQueueRebuildShard(uint32_t shard, uint32_t count)
+{
+  uint32_t first, last;
+  schedulerShardRange(shard, count, SCHEDULER_BITSET_WORDS(_schedulerPoolCount), &first, &last);
+  schedulerQueueRebuildRange(first, last, _schedulerShardNowS, _schedulerShardNowT);
+}
+
+#endif // CONFIG_SCHEDULER_SHARDS
+
+// Full check of all items and rebuilding of the queue (after clock jumps): all states are calculated in one pass 
+// (by shards, if there are many items), the transitions are the difference with the previous states
+static void schedulerQueueRebuild(struct tm* nowS, time_t nowT)
+{
+  #if CONFIG_SCHEDULER_SHARDS > 1
+    if (_schedulerPoolCount >= CONFIG_SCHEDULER_SHARDS_MIN) {
+      _schedulerShardNowS = nowS;
+      _schedulerShardNowT = nowT;
+      schedulerShardsRun(schedulerQueueRebuildShard, _schedulerPoolCount);
+    } else {
+      schedulerQueueRebuildRange(0, SCHEDULER_BITSET_WORDS(_schedulerPoolCount), nowS, nowT);
+    };
+    int64_t merged = schedPortMonotonicUs();
+  #else
+    schedulerQueueRebuildRange(0, SCHEDULER_BITSET_WORDS(_schedulerPoolCount), nowS, nowT);
+  #endif // CONFIG_SCHEDULER_SHARDS
+  SCHEDULER_STAT_TICK(Items, _schedulerPoolCount);
+
+  for (uint32_t w = 0; w < SCHEDULER_BITSET_WORDS(_schedulerPoolCount); w++) {
+    uint32_t eval = _schedulerEval[w] & ~_schedulerCrons[w];
+    uint32_t changed = (((eval ^ _schedulerStates[w]) & _schedulerKnown[w]) | (_schedulerLive[w] & ~_schedulerKnown[w])) & ~_schedulerCrons[w];
+    _schedulerStates[w] = eval;
+    _schedulerKnown[w] = _schedulerLive[w];
+    while (changed) {
+      uint32_t bit = __builtin_ctz(changed);
+      changed &= changed - 1;
+      schedulerItemPost(&_schedulerPool[w * 32 + bit], (eval >> bit) & 1);
+    };
+  };
+  for (uint32_t w = 0; w < SCHEDULER_BITSET_WORDS(_schedulerPoolCount); w++) {
+    uint32_t matched = _schedulerEval[w] & _schedulerCrons[w] & _schedulerLive[w];
+    while (matched) {
+      uint32_t bit = __builtin_ctz(matched);
+      matched &= matched - 1;
+      schedulerCronPost(&_schedulerPool[w * 32 + bit]);
+    };
+  };
+
+  _schedulerQueueCount = 0;
+  for (uint32_t i = 0; i < _schedulerPoolCount; i++) {
+    if (_schedulerPool[i].timespan) {
+      _schedulerQueue[_schedulerQueueCount++] = i;
+    };
+  };
+  for (uint32_t i = _schedulerQueueCount / 2; i > 0; i--) {
+    schedulerQueueSiftDown(i - 1);
+  };
+  for (uint32_t i = 0; i < _schedulerQueueCount; i++) {
+    _schedulerQueuePos[_schedulerQueue[i]] = i;
+  };
+  _schedulerQueueIsDst = nowS->tm_isdst;
+  _schedulerQueueValid = true;
+  #if CONFIG_SCHEDULER_SHARDS > 1
+    if (_schedulerPoolCount >= CONFIG_SCHEDULER_SHARDS_MIN) {
+      _schedulerShardsStats.merge_us += (uint32_t)(schedPortMonotonicUs() - merged);
+    };
+  #endif // CONFIG_SCHEDULER_SHARDS
+  rlog_d(logTAG, "Transition queue rebuilt: %d items", _schedulerQueueCount);
+}
+
+// New and updated items get a zero transition time, so they are checked right after all changes are applied
+static void schedulerChangeApply(schedulerChange_t* change)
+{
+  if (change->type == SCHEDULER_CHANGE_RESIZE) {
+    change->block = schedulerPoolMove(change->block, change->size);
+    return;
+  };
+
+  uint32_t index = SCHEDULER_HANDLE_INDEX(change->handle);
+  schedulerItem_t* item = &_schedulerPool[index];
+  // Handles are checked when the change is made, this only guards against stale ones
+  bool stale = (index >= _schedulerPoolCount) || !item->timespan || (item->generation != SCHEDULER_HANDLE_GENERATION(change->handle));
+  switch (change->type) {
+    case SCHEDULER_CHANGE_REGISTER:
+      if (index >= _schedulerPoolCount) {
+        _schedulerPoolCount = index + 1;
+      };
+      item->generation = SCHEDULER_HANDLE_GENERATION(change->handle);
+      if (change->cron) {
+        item->cron = change->cron;
+      } else {
+        item->timespan = change->timespan;
+      };
+      item->callback = change->callback;
+      if (change->callback) {
+        item->arg = change->arg;
+      } else {
+        item->value = change->value;
+      };
+      item->edge = 0;
+      schedulerBitSet(_schedulerCrons, index, change->cron != nullptr);
+      schedulerBitSet(_schedulerImmediate, index, false);
+      schedulerBitSet(_schedulerKnown, index, false);
+      schedulerBitSet(_schedulerLive, index, true);
+      #if CONFIG_SCHEDULER_WARMSTART
+        // Callbacks have no stable identifier
+        if (!change->cron && !change->callback) {
+          schedulerWarmRestore(index);
+        };
+      #endif // CONFIG_SCHEDULER_WARMSTART
+      _schedulerPoolLive++;
+      if (_schedulerQueueValid) {
+        _schedulerQueue[_schedulerQueueCount] = index;
+        schedulerQueueSiftUp(_schedulerQueueCount++);
+      };
+      break;
+
+    case SCHEDULER_CHANGE_UPDATE:
+      if (stale || ((change->cron != nullptr) != schedulerBitGet(_schedulerCrons, index))) {
+        change->type = SCHEDULER_CHANGE_NONE;
+        break;
+      };
+      if (change->cron) {
+        item->cron = change->cron;
+      } else {
+        item->timespan = change->timespan;
+      };
+      item->edge = 0;
+      if (_schedulerQueueValid) {
+        schedulerQueueSiftUp(_schedulerQueuePos[index]);
+      };
+      break;
+
+    case SCHEDULER_CHANGE_UNREGISTER:
+      // The handle is returned for reuse only once
+      if (stale) {
+        change->type = SCHEDULER_CHANGE_NONE;
+        break;
+      };
+      item->timespan = nullptr;
+      schedulerBitSet(_schedulerKnown, index, false);
+      schedulerBitSet(_schedulerStates, index, false);
+      schedulerBitSet(_schedulerLive, index, false);
+      schedulerBitSet(_schedulerCrons, index, false);
+      schedulerBitSet(_schedulerImmediate, index, false);
+      #if CONFIG_SCHEDULER_SOLAR
+        schedulerSolarRelease(change->handle);
+      #endif // CONFIG_SCHEDULER_SOLAR
+      _schedulerPoolLive--;
+      if (_schedulerQueueValid) {
+        uint32_t pos = _schedulerQueuePos[index];
+        _schedulerQueueCount--;
+        if (pos < _schedulerQueueCount) {
+          schedulerIndex_t moved = _schedulerQueue[_schedulerQueueCount];
+          _schedulerQueue[pos] = moved;
+          schedulerQueueSiftUp(pos);
+          schedulerQueueSiftDown(_schedulerQueuePos[moved]);
+        };
+      };
+      break;
+
+    case SCHEDULER_CHANGE_FLAGS:
+      if (!stale) {
+        schedulerBitSet(_schedulerImmediate, index, change->value & SCHEDULER_FLAG_IMMEDIATE);
+      };
+      change->type = SCHEDULER_CHANGE_NONE;
+      break;
+
+    default:
+      break;
+  };
+}
+
+// Apply the changes made by other tasks since the previous tick, in the order they were made
+static void schedulerChangesApply()
+{
+  schedulerChange_t* change = __atomic_exchange_n(&_schedulerChanges, nullptr, __ATOMIC_ACQUIRE);
+  if (change) {
+    #if CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+      __atomic_add_fetch(&_schedulerRegistryVersion, 1, __ATOMIC_ACQ_REL);
+    #endif // CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+    schedulerChange_t* last = change;
+    schedulerChange_t* first = nullptr;
+    while (change) {
+      schedulerChange_t* next = change->next;
+      change->next = first;
+      first = change;
+      change = next;
+    };
+    for (change = first; change; change = change->next) {
+      schedulerChangeApply(change);
+    };
+    schedulerChangesPush(&_schedulerRetired, first, last);
+    #if CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+      __atomic_add_fetch(&_schedulerRegistryVersion, 1, __ATOMIC_RELEASE);
+    #endif // CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_WARMSTART
+  };
+}
+
+#if CONFIG_SCHEDULER_SHARDS > 1
+
+static void schedulerQueueDueShard(uint32_t shard, uint32_t count)
+{
+  uint32_t first, last;
+  schedulerShardRange(shard, count, _schedulerShardDueCount, &first, &last);
+  for (uint32_t k = first; k < last; k++) {
+    uint32_t index = _schedulerShardDue[k];
+    schedulerItem_t* item = &_schedulerPool[index];
+    bool result;
+    if (schedulerBitGet(_schedulerCrons, index)) {
+      result = schedulerCronMatch(item->cron, _schedulerShardNowS);
+      schedulerCronEdge(item, _schedulerShardNowS, _schedulerShardNowT);
+    } else {
+      result = checkTimespan(_schedulerShardNowS, *item->timespan);
+      item->edge = schedulerTimespanNextEdge(_schedulerShardNowS, _schedulerShardNowT, *item->timespan);
+    };
+    _schedulerShardDue[k] = result ? index | SCHEDULER_SHARD_RESULT : index;
+  };
+}
+
+// The due items are taken from the queue in its order, checked by shards (if there are many of them) and posted in 
+// the same order; the list has room for every item of the pool
+static void schedulerQueueDueProcess(struct tm* nowS, time_t nowT)
+{
+  uint32_t count = 0;
+  while ((_schedulerQueueCount > 0) && (_schedulerPool[_schedulerQueue[0]].edge <= nowT)) {
+    schedulerIndex_t index = _schedulerQueue[0];
+    _schedulerShardDue[count++] = index;
+    // Out of the way until its next transition is known
+    _schedulerPool[index].edge = nowT + 1;
+    schedulerQueueSiftDown(0);
+  };
+  if (count == 0) return;
+
+  _schedulerShardDueCount = count;
+  _schedulerShardNowS = nowS;
+  _schedulerShardNowT = nowT;
+  if (count >= CONFIG_SCHEDULER_SHARDS_MIN) {
+    schedulerShardsRun(schedulerQueueDueShard, count);
+  } else {
+    schedulerQueueDueShard(0, 1);
+  };
+  int64_t merged = schedPortMonotonicUs();
+  SCHEDULER_STAT_TICK(Items, count);
+
+  for (uint32_t k = 0; k < count; k++) {
+    uint32_t index = _schedulerShardDue[k] & ~SCHEDULER_SHARD_RESULT;
+    bool result = _schedulerShardDue[k] & SCHEDULER_SHARD_RESULT;
+    if (schedulerBitGet(_schedulerCrons, index)) {
+      if (result) {
+        schedulerCronPost(&_schedulerPool[index]);
+      };
+    } else if (!schedulerBitGet(_schedulerKnown, index) || (result != schedulerBitGet(_schedulerStates, index))) {
+      schedulerBitSet(_schedulerKnown, index, true);
+      schedulerBitSet(_schedulerStates, index, result);
+      schedulerItemPost(&_schedulerPool[index], result);
+    };
+    schedulerQueueSiftDown(_schedulerQueuePos[index]);
+  };
+  if (count >= CONFIG_SCHEDULER_SHARDS_MIN) {
+    _schedulerShardsStats.merge_us += (uint32_t)(schedPortMonotonicUs() - merged);
+  };
+}
+
+#else
+
+static void schedulerQueueDueCheck(struct tm* nowS, time_t nowT)
+{
+  while ((_schedulerQueueCount > 0) && (_schedulerPool[_schedulerQueue[0]].edge <= nowT)) {
+    schedulerItemCheck(_schedulerQueue[0], nowS, nowT);
+    schedulerQueueSiftDown(0);
+  };
+}
+
+#endif // CONFIG_SCHEDULER_SHARDS
+
+// Check only those items whose transition time has arrived
+static void schedulerQueueProcess(struct tm* nowS, time_t nowT)
+{
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    schedulerBatchStart(_schedulerBatch, nowT);
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+
+  // Any change of the clock (or of the daylight saving time) invalidates the precomputed transition times
+  if ((nowT < _schedulerQueueTime) || (nowS->tm_isdst != _schedulerQueueIsDst)) {
+    _schedulerQueueValid = false;
+  };
+  schedulerChangesApply();
+  bool rebuild = !_schedulerQueueValid;
+  if (rebuild) {
+    schedulerQueueRebuild(nowS, nowT);
+  } else {
+    #if CONFIG_SCHEDULER_SHARDS > 1
+      schedulerQueueDueProcess(nowS, nowT);
+    #else
+      schedulerQueueDueCheck(nowS, nowT);
+    #endif // CONFIG_SCHEDULER_SHARDS
+  };
+  #if CONFIG_SCHEDULER_TABLES
+    schedulerTablesCheck(nowS, nowT, rebuild);
+  #endif // CONFIG_SCHEDULER_TABLES
+  _schedulerQueueTime = nowT;
+
+  #if CONFIG_SCHEDULER_BATCH_EVENTS
+    schedulerBatchFlush(_schedulerBatch, true);
+  #endif // CONFIG_SCHEDULER_BATCH_EVENTS
+  #if CONFIG_SCHEDULER_WARMSTART
+    if (!SCHEDULER_REPLAYING) {
+      schedulerWarmSave();
+    };
+  #endif // CONFIG_SCHEDULER_WARMSTART
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Calendar ------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_CALENDAR || CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_SOLAR
+
+// Days since 1970-01-01 of the civil date (H. Hinnant's algorithm)
+static int64_t schedulerCalendarDaysFromCivil(int64_t y, uint32_t m, uint32_t d)
+{
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+#endif // CONFIG_SCHEDULER_CALENDAR || CONFIG_SCHEDULER_FORECAST || CONFIG_SCHEDULER_SOLAR
+
+#if CONFIG_SCHEDULER_CALENDAR || CONFIG_SCHEDULER_FORECAST
+
+// UTC offset by the time zone rules
+static int32_t schedulerCalendarOffset(time_t t, int* isdst)
+{
+  struct tm local;
+  schedulerClockLocal(t, &local);
+  if (isdst) *isdst = local.tm_isdst;
+  int64_t days = schedulerCalendarDaysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+  return (int32_t)(days * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec - t);
+}
+
+// First moment in (from, to] when the UTC offset or the DST flag differ from the given ones (0 if there is none):
+// daily steps, then bisection to a second
+static time_t schedulerCalendarNextChange(time_t from, time_t to, int32_t offset, int isdst)
+{
+  time_t lo = from;
+  while (lo < to) {
+    time_t hi = (to - lo > 86400) ? lo + 86400 : to;
+    int hiDst;
+    if ((schedulerCalendarOffset(hi, &hiDst) != offset) || (hiDst != isdst)) {
+      while (hi - lo > 1) {
+        time_t mid = lo + (hi - lo) / 2;
+        int midDst;
+        int32_t midOffset = schedulerCalendarOffset(mid, &midDst);
+        if ((midOffset == offset) && (midDst == isdst)) {
+          lo = mid;
+        } else {
+          hi = mid;
+        };
+      };
+      return hi;
+    };
+    lo = hi;
+  };
+  return 0;
+}
+
+#endif // CONFIG_SCHEDULER_CALENDAR || CONFIG_SCHEDULER_FORECAST
+
+#if CONFIG_SCHEDULER_CALENDAR
+
+#define SCHEDULER_CALENDAR_PERIODS      8
+#define SCHEDULER_CALENDAR_SPAN         (366 * 86400)     // Time covered by the table of UTC offsets
+#define SCHEDULER_CALENDAR_TOLERANCE_US 10000             // Allowed deviation of the predicted wall time
+
+// Period of the constant UTC offset
+typedef struct {
+  time_t begin;
+  int32_t offset;
+  int isdst;
+} schedulerCalendarPeriod_t;
+
+static schedulerCalendarPeriod_t _schedulerCalendarTable[SCHEDULER_CALENDAR_PERIODS];
+static uint8_t _schedulerCalendarCount = 0;
+static time_t _schedulerCalendarEnd = 0;
+static volatile bool _schedulerCalendarAnchored = false;
+static volatile bool _schedulerCalendarTableValid = false;
+static int64_t _schedulerCalendarMonoBase = 0;
+static int64_t _schedulerCalendarWallBase = 0;
+static int64_t _schedulerCalendarDay = INT64_MIN;
+static struct tm _schedulerCalendarDate;
+static uint32_t _schedulerCalendarAnchors = 0;
+static uint32_t _schedulerCalendarTables = 0;
+
+static void schedulerCalendarCivilFromDays(int64_t z, struct tm* date)
+{
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint32_t d = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+  int64_t y = (int64_t)yoe + era * 400 + (m <= 2);
+  date->tm_year = (int)(y - 1900);
+  date->tm_mon = m - 1;
+  date->tm_mday = d;
+  date->tm_yday = (int)(z - 719468 - schedulerCalendarDaysFromCivil(y, 1, 1));
+}
+
+// Find all changes of the UTC offset during a year from the given moment
+static void schedulerCalendarBuild(time_t from)
+{
+  _schedulerCalendarCount = 1;
+  _schedulerCalendarTable[0].begin = from;
+  _schedulerCalendarTable[0].offset = schedulerCalendarOffset(from, &_schedulerCalendarTable[0].isdst);
+  _schedulerCalendarEnd = from + SCHEDULER_CALENDAR_SPAN;
+  time_t t = from;
+  while (true) {
+    schedulerCalendarPeriod_t* last = &_schedulerCalendarTable[_schedulerCalendarCount - 1];
+    t = schedulerCalendarNextChange(t, from + SCHEDULER_CALENDAR_SPAN, last->offset, last->isdst);
+    if (t == 0) break;
+    if (_schedulerCalendarCount >= SCHEDULER_CALENDAR_PERIODS) {
+      _schedulerCalendarEnd = t;
+      break;
+    };
+    schedulerCalendarPeriod_t* next = &_schedulerCalendarTable[_schedulerCalendarCount++];
+    next->begin = t;
+    next->offset = schedulerCalendarOffset(t, &next->isdst);
+  };
+  _schedulerCalendarDay = INT64_MIN;
+  _schedulerCalendarTableValid = true;
+  _schedulerCalendarTables++;
+}
+
+// Equivalent of localtime_r(): the table gives the UTC offset, the date is recalculated once a day
+static void schedulerCalendarLocal(time_t t, struct tm* local)
+{
+  if (!_schedulerCalendarTableValid || (t < _schedulerCalendarTable[0].begin) || (t >= _schedulerCalendarEnd)) {
+    schedulerCalendarBuild(t);
+  };
+  schedulerCalendarPeriod_t* period = &_schedulerCalendarTable[0];
+  for (uint8_t i = 1; (i < _schedulerCalendarCount) && (_schedulerCalendarTable[i].begin <= t); i++) {
+    period = &_schedulerCalendarTable[i];
+  };
+
+  int64_t seconds = (int64_t)t + period->offset;
+  int64_t day = (seconds >= 0 ? seconds : seconds - 86399) / 86400;
+  if (day != _schedulerCalendarDay) {
+    memset(&_schedulerCalendarDate, 0, sizeof(_schedulerCalendarDate));
+    schedulerCalendarCivilFromDays(day, &_schedulerCalendarDate);
+    _schedulerCalendarDate.tm_wday = (int)((day % 7 + 11) % 7);
+    _schedulerCalendarDay = day;
+  };
+  *local = _schedulerCalendarDate;
+  uint32_t sec = (uint32_t)(seconds - day * 86400);
+  local->tm_hour = sec / 3600;
+  local->tm_min = (sec / 60) % 60;
+  local->tm_sec = sec % 60;
+  local->tm_isdst = period->isdst;
+}
+
+// Wall time predicted from the monotonic clock
+static void schedulerCalendarNow(struct timeval* now)
+{
+  int64_t us = _schedulerCalendarWallBase + (schedPortMonotonicUs() - _schedulerCalendarMonoBase);
+  now->tv_sec = us / 1000000;
+  now->tv_usec = us % 1000000;
+}
+
+// Compare the predicted time with the time of the tick; read the wall clock again only if they diverged
+static void schedulerCalendarCheck(struct timeval* tick_time)
+{
+  if (_schedulerCalendarAnchored) {
+    struct timeval now;
+    schedulerCalendarNow(&now);
+    int64_t deviation = ((int64_t)now.tv_sec - tick_time->tv_sec) * 1000000 + now.tv_usec - tick_time->tv_usec;
+    if ((deviation >= -SCHEDULER_CALENDAR_TOLERANCE_US) && (deviation <= SCHEDULER_CALENDAR_TOLERANCE_US)) {
+      return;
+    };
+  };
+  struct timeval wall;
+  schedulerClockWall(&wall);
+  _schedulerCalendarMonoBase = schedPortMonotonicUs();
+  _schedulerCalendarWallBase = (int64_t)wall.tv_sec * 1000000 + wall.tv_usec;
+  _schedulerCalendarAnchored = true;
+  _schedulerCalendarAnchors++;
+}
+
+void schedulerCalendarReset()
+{
+  _schedulerCalendarAnchored = false;
+  _schedulerCalendarTableValid = false;
+}
+
+void schedulerCalendarStats(uint32_t* anchors, uint32_t* tables)
+{
+  if (anchors) *anchors = _schedulerCalendarAnchors;
+  if (tables) *tables = _schedulerCalendarTables;
+}
+
+#endif // CONFIG_SCHEDULER_CALENDAR
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Forecast ------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_FORECAST
+
+#define SCHEDULER_FORECAST_SLACK    3600  // The cache covers the window and this time, so that it serves while time goes on
+#define SCHEDULER_FORECAST_CHANGES  8     // Changes of the UTC offset taken into account
+
+// The cache belongs to the task that holds _schedulerRegistryLock
+static schedulerForecastItem_t* _schedulerForecastCache = nullptr;
+static uint32_t _schedulerForecastCount = 0;
+static bool _schedulerForecastValid = false;
+static uint32_t _schedulerForecastVersion = 0;
+static schedulerHandle_t _schedulerForecastHandle = SCHEDULER_HANDLE_INVALID;  // Items of the cache (all or one)
+static time_t _schedulerForecastFrom = 0;
+static time_t _schedulerForecastHorizon = 0;    // All transitions up to this time are in the cache
+static uint32_t _schedulerForecastComputed = 0;
+static uint32_t _schedulerForecastCached = 0;
+
+// The cache keeps the earliest transitions ordered by time and handle; returns false if the transition is beyond it
+static bool schedulerForecastInsert(time_t time, uint32_t index, uint8_t state)
+{
+  if (time > _schedulerForecastHorizon) return false;
+  schedulerHandle_t handle = SCHEDULER_HANDLE_MAKE(index, _schedulerPool[index].generation);
+  uint32_t lo = 0, hi = _schedulerForecastCount;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    schedulerForecastItem_t* item = &_schedulerForecastCache[mid];
+    if ((item->time < time) || ((item->time == time) && (item->handle < handle))) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    };
+  };
+  if (_schedulerForecastCount >= CONFIG_SCHEDULER_FORECAST_SIZE) {
+    // The latest transition does not fit, the cache ends before it
+    if (lo >= CONFIG_SCHEDULER_FORECAST_SIZE) {
+      _schedulerForecastHorizon = time - 1;
+      return false;
+    };
+    _schedulerForecastHorizon = _schedulerForecastCache[CONFIG_SCHEDULER_FORECAST_SIZE - 1].time - 1;
+    _schedulerForecastCount--;
+  };
+  memmove(&_schedulerForecastCache[lo + 1], &_schedulerForecastCache[lo], (_schedulerForecastCount - lo) * sizeof(schedulerForecastItem_t));
+  schedulerForecastItem_t* item = &_schedulerForecastCache[lo];
+  item->time = time;
+  item->value = _schedulerPool[index].callback ? 0 : _schedulerPool[index].value;
+  item->handle = handle;
+  item->state = state;
+  item->reserved = 0;
+  _schedulerForecastCount++;
+  return true;
+}
+
+// From edge to edge, as the queue does; after a change of the UTC offset all states are checked at the next tick
+static void schedulerForecastTimespan(uint32_t index, timespan_t timespan, const time_t* changes, uint32_t changesCount)
+{
+  time_t t = _schedulerForecastFrom;
+  struct tm local;
+  schedulerClockLocal(t, &local);
+  bool state = checkTimespan(&local, timespan);
+  uint32_t change = 0;
+  while (true) {
+    time_t next = schedulerTimespanNextEdge(&local, t, timespan);
+    while ((change < changesCount) && (changes[change] <= t)) {
+      change++;
+    };
+    if ((change < changesCount) && (changes[change] < next)) {
+      next = changes[change];
+    };
+    if (next > _schedulerForecastHorizon) break;
+    schedulerClockLocal(next, &local);
+    bool nextState = checkTimespan(&local, timespan);
+    if ((nextState != state) && !schedulerForecastInsert(next, index, nextState)) break;
+    state = nextState;
+    t = next;
+  };
+}
+
+static void schedulerForecastCompute(time_t from, uint32_t window_s, schedulerHandle_t handle)
+{
+  _schedulerForecastCount = 0;
+  _schedulerForecastFrom = from;
+  _schedulerForecastHorizon = from + window_s + SCHEDULER_FORECAST_SLACK;
+  _schedulerForecastHandle = handle;
+  _schedulerForecastComputed++;
+
+  // Ticks that follow the changes of the UTC offset
+  time_t changes[SCHEDULER_FORECAST_CHANGES];
+  uint32_t changesCount = 0;
+  int isdst;
+  int32_t offset = schedulerCalendarOffset(from, &isdst);
+  time_t t = from;
+  while (changesCount < SCHEDULER_FORECAST_CHANGES) {
+    t = schedulerCalendarNextChange(t, _schedulerForecastHorizon, offset, isdst);
+    if (t == 0) break;
+    changes[changesCount++] = t + (60 - t % 60) % 60;
+    offset = schedulerCalendarOffset(t, &isdst);
+  };
+  if (changesCount >= SCHEDULER_FORECAST_CHANGES) {
+    _schedulerForecastHorizon = changes[changesCount - 1];
+  };
+
+  uint32_t first = handle != SCHEDULER_HANDLE_INVALID ? SCHEDULER_HANDLE_INDEX(handle) : 0;
+  uint32_t last = handle != SCHEDULER_HANDLE_INVALID ? first + 1 : _schedulerPoolCount;
+  for (uint32_t i = first; (i < last) && (i < _schedulerPoolCount); i++) {
+    if (schedulerBitGet(_schedulerLive, i)) {
+      schedulerItem_t* item = &_schedulerPool[i];
+      if (schedulerBitGet(_schedulerCrons, i)) {
+        t = from;
+        while ((t = schedulerCronNext(item->cron, t)) > 0) {
+          if (!schedulerForecastInsert(t, i, 1)) break;
+        };
+      } else if (item->timespan) {
+        schedulerForecastTimespan(i, *item->timespan, changes, changesCount);
+      };
+    };
+  };
+}
+
+// Copy the transitions within (now, to]; false if the cache does not cover them all
+static bool schedulerForecastCopy(schedulerHandle_t handle, time_t now, time_t to, schedulerForecastItem_t* items, uint32_t max_count, 
+  uint32_t* count)
+{
+  *count = 0;
+  for (uint32_t i = 0; (i < _schedulerForecastCount) && (*count < max_count); i++) {
+    schedulerForecastItem_t* item = &_schedulerForecastCache[i];
+    if (item->time > to) break;
+    if ((item->time > now) && ((handle == SCHEDULER_HANDLE_INVALID) || (item->handle == handle))) {
+      items[(*count)++] = *item;
+    };
+  };
+  return (to <= _schedulerForecastHorizon) 
+    || ((*count >= max_count) && (max_count > 0) && (items[max_count - 1].time <= _schedulerForecastHorizon));
+}
+
+uint32_t schedulerForecast(schedulerHandle_t handle, uint32_t window_s, schedulerForecastItem_t* items, uint32_t max_count)
+{
+  uint32_t count = 0;
+  if (!_schedulerRegistryLock || !items || (max_count == 0)) return 0;
+  schedPortMutexLock(_schedulerRegistryLock);
+  if (!_schedulerForecastCache) {
+    _schedulerForecastCache = (schedulerForecastItem_t*)esp_calloc(CONFIG_SCHEDULER_FORECAST_SIZE, sizeof(schedulerForecastItem_t));
+  };
+  if (_schedulerForecastCache && _schedulerPool) {
+    struct timeval now;
+    schedulerClockWall(&now);
+    time_t from = now.tv_sec - now.tv_sec % 60;
+    time_t to = now.tv_sec + window_s;
+    // The pool is read while the timer may change it: the result is accepted only if the version has not changed meanwhile
+    for (uint8_t attempt = 0; attempt < 3; attempt++) {
+      uint32_t version = __atomic_load_n(&_schedulerRegistryVersion, __ATOMIC_ACQUIRE);
+      if (version & 1) {
+        schedPortDelayMs(1);
+        continue;
+      };
+      bool cached = _schedulerForecastValid && (_schedulerForecastVersion == version) && (from >= _schedulerForecastFrom)
+        && ((_schedulerForecastHandle == SCHEDULER_HANDLE_INVALID) || (_schedulerForecastHandle == handle));
+      if (cached && schedulerForecastCopy(handle, now.tv_sec, to, items, max_count, &count)) {
+        _schedulerForecastCached++;
+      } else {
+        schedulerForecastCompute(from, window_s, SCHEDULER_HANDLE_INVALID);
+        if (!schedulerForecastCopy(handle, now.tv_sec, to, items, max_count, &count) && (handle != SCHEDULER_HANDLE_INVALID)) {
+          // Transitions of other items have filled the cache
+          schedulerForecastCompute(from, window_s, handle);
+          schedulerForecastCopy(handle, now.tv_sec, to, items, max_count, &count);
+        };
+      };
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      _schedulerForecastValid = __atomic_load_n(&_schedulerRegistryVersion, __ATOMIC_RELAXED) == version;
+      _schedulerForecastVersion = version;
+      if (_schedulerForecastValid) break;
+      count = 0;
+    };
+  };
+  schedPortMutexUnlock(_schedulerRegistryLock);
+  return count;
+}
+
+static void schedulerForecastDiscard()
+{
+  if (_schedulerForecastCache) {
+    free(_schedulerForecastCache);
+    _schedulerForecastCache = nullptr;
+  };
+  _schedulerForecastCount = 0;
+  _schedulerForecastValid = false;
+}
+
+static inline void schedulerForecastPut16(uint8_t* ptr, uint16_t value)
+{
+  ptr[0] = (uint8_t)value;
+  ptr[1] = (uint8_t)(value >> 8);
+}
+
+static inline void schedulerForecastPut32(uint8_t* ptr, uint32_t value)
+{
+  schedulerForecastPut16(ptr, (uint16_t)value);
+  schedulerForecastPut16(ptr + 2, (uint16_t)(value >> 16));
+}
+
+// The items must be ordered by time, as schedulerForecast() returns them
+size_t schedulerForecastExport(const schedulerForecastItem_t* items, uint32_t count, uint8_t* buffer, size_t size)
+{
+  if (!items || (count > UINT16_MAX)) count = 0;
+  size_t required = SCHEDULER_FORECAST_HEADER_SIZE + count * SCHEDULER_FORECAST_RECORD_SIZE;
+  if (buffer && (size >= required)) {
+    time_t base = count > 0 ? items[0].time - items[0].time % 60 : 0;
+    buffer[0] = SCHEDULER_FORECAST_VERSION;
+    buffer[1] = SCHEDULER_FORECAST_RECORD_SIZE;
+    schedulerForecastPut16(buffer + 2, (uint16_t)count);
+    schedulerForecastPut32(buffer + 4, (uint32_t)base);
+    uint8_t* ptr = buffer + SCHEDULER_FORECAST_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t minutes = (uint32_t)((items[i].time - base) / 60) & 0x7FFFFFFF;
+      schedulerForecastPut32(ptr, items[i].handle);
+      schedulerForecastPut32(ptr + 4, minutes | (items[i].state ? 0x80000000 : 0));
+      ptr += SCHEDULER_FORECAST_RECORD_SIZE;
+    };
+  };
+  return required;
+}
+
+void schedulerForecastStats(uint32_t* computed, uint32_t* cached)
+{
+  if (computed) *computed = _schedulerForecastComputed;
+  if (cached) *cached = _schedulerForecastCached;
+}
+
+#endif // CONFIG_SCHEDULER_FORECAST
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Modes --------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#define SCHEDULER_MODES_OFF_SHIFT 12      // Event group: bit N is set while mode N is active, bit N + 12 - while it is not
+
+static_assert(CONFIG_SCHEDULER_MODES_MAX <= SCHEDULER_MODES_OFF_SHIFT, "CONFIG_SCHEDULER_MODES_MAX must not exceed 12");
+static_assert(2 * SCHEDULER_MODES_OFF_SHIFT <= SCHED_PORT_EVENTS_BITS, "Event group is too small");
+
+typedef struct {
+  const char* name;
+  timespan_t* timespan;
+  bool* enabled;
+} schedulerModeSlot_t;
+
+static schedulerModeSlot_t _schedulerModeSlots[CONFIG_SCHEDULER_MODES_MAX];
+static uint32_t _schedulerModesCount = 0;
+static uint32_t _schedulerModesState = 0;                 // Bits of the active modes
+static bool _schedulerModesPending = false;               // A parameter of a mode has changed: the timer re-checks them
+static schedPortEvents_t _schedulerModesEvents = nullptr;
+#if CONFIG_SCHEDULER_REPLAY
+static uint32_t _schedulerReplayModes = 0;                // States of the modes in the simulated time
+#endif // CONFIG_SCHEDULER_REPLAY
+#if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+static schedulerMode_t _schedulerModeSilent = SCHEDULER_MODE_INVALID;
+static const char* tagSM = "TIME";
+#endif // CONFIG_SILENT_MODE_ENABLE
+
+schedulerMode_t schedulerModeFind(const char* name)
+{
+  if (name) {
+    uint32_t count = __atomic_load_n(&_schedulerModesCount, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+      if (strcmp(_schedulerModeSlots[i].name, name) == 0) {
+        return (schedulerMode_t)i;
+      };
+    };
+  };
+  return SCHEDULER_MODE_INVALID;
+}
+
+schedulerMode_t schedulerModeRegister(const char* name, timespan_t* timespan, bool* enabled)
+{
+  if (!name || !timespan) return SCHEDULER_MODE_INVALID;
+  if (!_schedulerModesEvents) {
+    _schedulerModesEvents = schedPortEventsCreate();
+    RE_MEM_CHECK(_schedulerModesEvents, return SCHEDULER_MODE_INVALID);
+  };
+  schedulerMode_t mode = schedulerModeFind(name);
+  if (mode == SCHEDULER_MODE_INVALID) {
+    if (_schedulerModesCount >= CONFIG_SCHEDULER_MODES_MAX) {
+      rlog_e(logTAG, "Too many modes, \"%s\" was not registered", name);
+      return SCHEDULER_MODE_INVALID;
+    };
+    mode = (schedulerMode_t)_schedulerModesCount;
+    _schedulerModeSlots[mode].name = name;
+    _schedulerModeSlots[mode].timespan = timespan;
+    _schedulerModeSlots[mode].enabled = enabled;
+    // The mode is inactive until the next tick
+    schedPortEventsUpdate(_schedulerModesEvents, SCHEDULER_MODE_BIT(mode) << SCHEDULER_MODES_OFF_SHIFT, 0);
+    __atomic_store_n(&_schedulerModesCount, (uint32_t)mode + 1, __ATOMIC_RELEASE);
+  } else {
+    _schedulerModeSlots[mode].timespan = timespan;
+    _schedulerModeSlots[mode].enabled = enabled;
+  };
+  schedulerTimerMainWakeup();
+  return mode;
+}
+
+uint32_t SCHED_PORT_IRAM schedulerModes()
+{
+  return __atomic_load_n(&_schedulerModesState, __ATOMIC_ACQUIRE);
+}
+
+bool SCHED_PORT_IRAM schedulerModeActive(schedulerMode_t mode)
+{
+  return (mode >= 0) && (mode < CONFIG_SCHEDULER_MODES_MAX) && ((schedulerModes() >> mode) & 1);
+}
+
+uint32_t schedulerModesWait(uint32_t modes, bool active, uint32_t timeout_ms)
+{
+  if (!_schedulerModesEvents) return 0;
+  modes &= SCHEDULER_MODE_BIT(SCHEDULER_MODES_OFF_SHIFT) - 1;
+  if (active) {
+    return schedPortEventsWait(_schedulerModesEvents, modes, timeout_ms);
+  };
+  return schedPortEventsWait(_schedulerModesEvents, modes << SCHEDULER_MODES_OFF_SHIFT, timeout_ms) >> SCHEDULER_MODES_OFF_SHIFT;
+}
+
+static inline bool schedulerModeEnabled(schedulerModeSlot_t* slot)
+{
+  return (!slot->enabled || *slot->enabled) && (*slot->timespan > 0);
+}
+
+static uint32_t schedulerModesEvaluate(struct tm* timeinfo)
+{
+  uint32_t bits = 0;
+  uint32_t count = __atomic_load_n(&_schedulerModesCount, __ATOMIC_ACQUIRE);
+  for (uint32_t i = 0; i < count; i++) {
+    schedulerModeSlot_t* slot = &_schedulerModeSlots[i];
+    if (schedulerModeEnabled(slot) && checkTimespan(timeinfo, *slot->timespan)) {
+      bits |= SCHEDULER_MODE_BIT(i);
+    };
+  };
+  return bits;
+}
+
+// Silent mode is still announced by events
+static void schedulerModesPost(uint32_t prev, uint32_t bits)
+{
+  #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+    if ((_schedulerModeSilent != SCHEDULER_MODE_INVALID) && ((prev ^ bits) & SCHEDULER_MODE_BIT(_schedulerModeSilent))) {
+      if (bits & SCHEDULER_MODE_BIT(_schedulerModeSilent)) {
+        rlog_i(tagSM, "Silent mode activated");
+        schedulerEventPost(RE_TIME_SILENT_MODE_ON, nullptr, 0, portMAX_DELAY);
+      } else {
+        schedulerEventPost(RE_TIME_SILENT_MODE_OFF, nullptr, 0, portMAX_DELAY);
+        rlog_i(tagSM, "Silent mode disabled");
+      };
+    };
+  #endif // CONFIG_SILENT_MODE_ENABLE
+}
+
+static void schedulerModesCheck(struct tm* timeinfo)
+{
+  uint32_t bits = schedulerModesEvaluate(timeinfo);
+  #if CONFIG_SCHEDULER_REPLAY
+    if (_schedulerReplayLog) {
+      uint32_t prev = _schedulerReplayModes;
+      _schedulerReplayModes = bits;
+      schedulerModesPost(prev, bits);
+      return;
+    };
+  #endif // CONFIG_SCHEDULER_REPLAY
+  uint32_t prev = __atomic_exchange_n(&_schedulerModesState, bits, __ATOMIC_ACQ_REL);
+  if (prev != bits) {
+    uint32_t inactive = (SCHEDULER_MODE_BIT(__atomic_load_n(&_schedulerModesCount, __ATOMIC_ACQUIRE)) - 1) & ~bits;
+    schedPortEventsUpdate(_schedulerModesEvents, bits | (inactive << SCHEDULER_MODES_OFF_SHIFT), 
+      inactive | (bits << SCHEDULER_MODES_OFF_SHIFT));
+    schedulerModesPost(prev, bits);
+  };
+}
+
+// The states and the event group are only updated by the tick: other tasks ask the timer to fire right away
+static void schedulerModesCheckRequest()
+{
+  __atomic_store_n(&_schedulerModesPending, true, __ATOMIC_RELEASE);
+  schedulerTimerMainFire();
+}
+
+// Parameters of modes are identified by the addresses of their values
+static bool schedulerModesParameter(uint32_t address)
+{
+  uint32_t count = __atomic_load_n(&_schedulerModesCount, __ATOMIC_ACQUIRE);
+  for (uint32_t i = 0; i < count; i++) {
+    if ((address == (uint32_t)(uintptr_t)_schedulerModeSlots[i].timespan) 
+     || (_schedulerModeSlots[i].enabled && (address == (uint32_t)(uintptr_t)_schedulerModeSlots[i].enabled))) {
+      return true;
+    };
+  };
+  return false;
+}
+
+#if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+
+static timespan_t tsSilentModeTimespan = CONFIG_SILENT_MODE_INTERVAL;
+#if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
+static bool enabledSilentMode = true;
+#endif // CONFIG_SILENT_MODE_EXTENDED
+
+void silentModeRegister()
+{
+  #if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
+    paramsGroupHandle_t _pgSilentMode = paramsRegisterGroup(nullptr, CONFIG_SILENT_MODE_PGROUP_KEY, CONFIG_SILENT_MODE_PGROUP_TOPIC, CONFIG_SILENT_MODE_PGROUP_FRIENDLY);
+    if (_pgSilentMode) {
+      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U8, nullptr, _pgSilentMode, 
+        CONFIG_SILENT_MODE_ENABLE_TOPIC, CONFIG_SILENT_MODE_ENABLE_FRIENDLY,
+        CONFIG_MQTT_PARAMS_QOS, (void*)&enabledSilentMode);
+      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, _pgSilentMode, 
+        CONFIG_SILENT_MODE_TIMESPAN_TOPIC, CONFIG_SILENT_MODE_TIMESPAN_FRIENDLY,
+        CONFIG_MQTT_PARAMS_QOS, (void*)&tsSilentModeTimespan);
+    };
+    _schedulerModeSilent = schedulerModeRegister(SCHEDULER_MODE_SILENT_NAME, &tsSilentModeTimespan, &enabledSilentMode);
+  #else
+    paramsRegisterCommonValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, 
+      CONFIG_SILENT_MODE_TOPIC, CONFIG_SILENT_MODE_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&tsSilentModeTimespan);
+    _schedulerModeSilent = schedulerModeRegister(SCHEDULER_MODE_SILENT_NAME, &tsSilentModeTimespan, nullptr);
+  #endif // CONFIG_SILENT_MODE_EXTENDED
+}
+
+bool isSilentMode()
+{
+  return schedulerModeActive(_schedulerModeSilent);
+}
+
+#endif // CONFIG_SILENT_MODE_ENABLE
+
+// -----------------------------------------------------------------------------------------------------------------------
+// --------------------------------------------------- Solar schedules ---------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_SOLAR
+
+// Items are registered with the timespans of their slots, which are rewritten once a day
+typedef struct {
+  const schedulerSolar_t* solar;              // nullptr: the slot is free
+  schedulerHandle_t handle;
+  timespan_t timespan;
+} schedulerSolarSlot_t;
+
+static schedulerSolarSlot_t _schedulerSolarSlots[CONFIG_SCHEDULER_SOLAR_MAX];
+static float _schedulerSolarLatitude = CONFIG_SCHEDULER_SOLAR_LATITUDE;
+static float _schedulerSolarLongitude = CONFIG_SCHEDULER_SOLAR_LONGITUDE;
+static int32_t _schedulerSolarDate = -1;      // Local date of the timespans (days since 1970), -1: calculate on the next tick
+static uint32_t _schedulerSolarDays = 0;      // Days calculated
+static uint32_t _schedulerSolarTables = 0;    // Year tables built
+#if CONFIG_SCHEDULER_SOLAR_TABLE
+static schedulerSolarDay_t* _schedulerSolarTable = nullptr;
+static int _schedulerSolarTableYear = -1;
+#endif // CONFIG_SCHEDULER_SOLAR_TABLE
+
+static void schedulerSolarInvalidate()
+{
+  #if CONFIG_SCHEDULER_SOLAR_TABLE
+    _schedulerSolarTableYear = -1;
+  #endif // CONFIG_SCHEDULER_SOLAR_TABLE
+  __atomic_store_n(&_schedulerSolarDate, -1, __ATOMIC_RELEASE);
+  schedulerTimerMainWakeup();
+}
+
+#if CONFIG_SCHEDULER_SOLAR_TABLE
+
+// The year table is allocated by the registration, never by the tick
+static bool schedulerSolarTableAlloc()
+{
+  if (__atomic_load_n(&_schedulerSolarTable, __ATOMIC_ACQUIRE)) return true;
+  schedulerSolarDay_t* table = (schedulerSolarDay_t*)esp_calloc(366, sizeof(schedulerSolarDay_t));
+  RE_MEM_CHECK(table, return false);
+  schedulerSolarDay_t* expected = nullptr;
+  if (!__atomic_compare_exchange_n(&_schedulerSolarTable, &expected, table, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    free(table);
+  };
+  return true;
+}
+
+#endif // CONFIG_SCHEDULER_SOLAR_TABLE
+
+schedulerHandle_t schedulerRegisterSolar(const schedulerSolar_t* solar, uint32_t value)
+{
+  if (!solar) return SCHEDULER_HANDLE_INVALID;
+  #if CONFIG_SCHEDULER_SOLAR_TABLE
+    if (!schedulerSolarTableAlloc()) return SCHEDULER_HANDLE_INVALID;
+  #endif // CONFIG_SCHEDULER_SOLAR_TABLE
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_SOLAR_MAX; i++) {
+    schedulerSolarSlot_t* slot = &_schedulerSolarSlots[i];
+    const schedulerSolar_t* expected = nullptr;
+    if (__atomic_compare_exchange_n(&slot->solar, &expected, solar, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      slot->timespan = 0;
+      slot->handle = schedulerRegisterItem(&slot->timespan, nullptr, value, nullptr, nullptr);
+      if (slot->handle == SCHEDULER_HANDLE_INVALID) {
+        __atomic_store_n(&slot->solar, nullptr, __ATOMIC_RELEASE);
+      } else {
+        schedulerSolarInvalidate();
+      };
+      return slot->handle;
+    };
+  };
+  rlog_e(logTAG, "Too many solar schedules");
+  return SCHEDULER_HANDLE_INVALID;
+}
+
+static schedulerSolarSlot_t* schedulerSolarFind(schedulerHandle_t handle)
+{
+  if (handle != SCHEDULER_HANDLE_INVALID) {
+    for (uint32_t i = 0; i < CONFIG_SCHEDULER_SOLAR_MAX; i++) {
+      if (__atomic_load_n(&_schedulerSolarSlots[i].solar, __ATOMIC_ACQUIRE) && (_schedulerSolarSlots[i].handle == handle)) {
+        return &_schedulerSolarSlots[i];
+      };
+    };
+  };
+  return nullptr;
+}
+
+timespan_t schedulerSolarTimespan(schedulerHandle_t handle)
+{
+  schedulerSolarSlot_t* slot = schedulerSolarFind(handle);
+  return slot ? slot->timespan : 0;
+}
+
+// Called by the timer when the item has been removed: until then it is still checked against the timespan of the slot,
+// so the slot cannot be claimed by another solar schedule earlier
+static void schedulerSolarRelease(schedulerHandle_t handle)
+{
+  schedulerSolarSlot_t* slot = schedulerSolarFind(handle);
+  if (slot) {
+    slot->handle = SCHEDULER_HANDLE_INVALID;
+    __atomic_store_n(&slot->solar, nullptr, __ATOMIC_RELEASE);
+  };
+}
+
+void schedulerSolarSetLocation(float latitude, float longitude)
+{
+  _schedulerSolarLatitude = latitude;
+  _schedulerSolarLongitude = longitude;
+  schedulerSolarInvalidate();
+}
+
+void schedulerSolarStats(uint32_t* days, uint32_t* tables)
+{
+  if (days) *days = _schedulerSolarDays;
+  if (tables) *tables = _schedulerSolarTables;
+}
+
+static void schedulerSolarDiscard()
+{
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_SOLAR_MAX; i++) {
+    _schedulerSolarSlots[i].handle = SCHEDULER_HANDLE_INVALID;
+    _schedulerSolarSlots[i].solar = nullptr;
+  };
+  _schedulerSolarDate = -1;
+  #if CONFIG_SCHEDULER_SOLAR_TABLE
+    if (_schedulerSolarTable) {
+      free(_schedulerSolarTable);
+      _schedulerSolarTable = nullptr;
+    };
+    _schedulerSolarTableYear = -1;
+  #endif // CONFIG_SCHEDULER_SOLAR_TABLE
+}
+
+static void schedulerSolarRegisterParams()
+{
+  paramsGroupHandle_t _pgSolar = paramsRegisterGroup(nullptr, CONFIG_SCHEDULER_SOLAR_PGROUP_KEY, 
+    CONFIG_SCHEDULER_SOLAR_PGROUP_TOPIC, CONFIG_SCHEDULER_SOLAR_PGROUP_FRIENDLY);
+  if (_pgSolar) {
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, _pgSolar, 
+      CONFIG_SCHEDULER_SOLAR_LATITUDE_TOPIC, CONFIG_SCHEDULER_SOLAR_LATITUDE_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&_schedulerSolarLatitude);
+    paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_FLOAT, nullptr, _pgSolar, 
+      CONFIG_SCHEDULER_SOLAR_LONGITUDE_TOPIC, CONFIG_SCHEDULER_SOLAR_LONGITUDE_FRIENDLY,
+      CONFIG_MQTT_PARAMS_QOS, (void*)&_schedulerSolarLongitude);
+  };
+}
+
+static bool schedulerSolarParameter(uint32_t address)
+{
+  return (address == (uint32_t)(uintptr_t)&_schedulerSolarLatitude) 
+      || (address == (uint32_t)(uintptr_t)&_schedulerSolarLongitude);
+}
+
+static bool schedulerSolarToday(struct tm* nowS, schedulerSolarDay_t* day)
+{
+  int year = nowS->tm_year + 1900;
+  #if CONFIG_SCHEDULER_SOLAR_TABLE
+    // Without a registered schedule there is no table: the day is calculated alone
+    schedulerSolarDay_t* table = __atomic_load_n(&_schedulerSolarTable, __ATOMIC_ACQUIRE);
+    if (table) {
+      if (_schedulerSolarTableYear != year) {
+        for (int i = 0; i < 366; i++) {
+          if (!schedulerSolarCalc(year, i, _schedulerSolarLatitude, _schedulerSolarLongitude, &table[i])) {
+            if (i < 365) return false;
+            break;
+          };
+          _schedulerSolarDays++;
+        };
+        _schedulerSolarTableYear = year;
+        _schedulerSolarTables++;
+      };
+      *day = table[nowS->tm_yday];
+      return true;
+    };
+  #endif // CONFIG_SCHEDULER_SOLAR_TABLE
+  _schedulerSolarDays++;
+  return schedulerSolarCalc(year, nowS->tm_yday, _schedulerSolarLatitude, _schedulerSolarLongitude, day);
+}
+
+// Local minute of the day of the moment plus the offset, -1 if the moment does not occur on this day
+static int schedulerSolarMinute(uint8_t event, int16_t offset, const schedulerSolarDay_t* day, time_t midnightUtc)
+{
+  int minute;
+  if (event == SCHEDULER_SOLAR_TIME) {
+    minute = offset;
+  } else {
+    int utc = day->noon;
+    if (event != SCHEDULER_SOLAR_NOON) {
+      if ((event > SCHEDULER_SOLAR_NAUTICAL_DUSK) || (day->arc[(event - 1) / 2] == 0) || (day->arc[(event - 1) / 2] >= 720)) {
+        return -1;
+      };
+      utc += ((event - 1) % 2) ? day->arc[(event - 1) / 2] : -(int)day->arc[(event - 1) / 2];
+    };
+    struct tm local;
+    schedulerClockLocal(midnightUtc + utc * 60, &local);
+    minute = local.tm_hour * 60 + local.tm_min + offset;
+  };
+  minute %= 1440;
+  return minute < 0 ? minute + 1440 : minute;
+}
+
+static timespan_t schedulerSolarTimespanCalc(const schedulerSolar_t* solar, const schedulerSolarDay_t* day, time_t midnightUtc)
+{
+  int on = schedulerSolarMinute(solar->on_event, solar->on_offset, day, midnightUtc);
+  int off = schedulerSolarMinute(solar->off_event, solar->off_offset, day, midnightUtc);
+  if ((on < 0) || (off < 0) || (on == off)) {
+    return 0;
+  };
+  return (timespan_t)((on / 60) * 1000000 + (on % 60) * 10000 + (off / 60) * 100 + off % 60);
+}
+
+// On the first tick of every day (and after the location or the list has changed): new timespans of all solar items
+static void schedulerSolarCheck(struct tm* nowS)
+{
+  int32_t date = (int32_t)schedulerCalendarDaysFromCivil(nowS->tm_year + 1900, nowS->tm_mon + 1, nowS->tm_mday);
+  int32_t seen = __atomic_load_n(&_schedulerSolarDate, __ATOMIC_ACQUIRE);
+  if (date == seen) return;
+
+  schedulerSolarDay_t day;
+  bool valid = schedulerSolarToday(nowS, &day);
+  bool changed = false;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_SOLAR_MAX; i++) {
+    const schedulerSolar_t* solar = __atomic_load_n(&_schedulerSolarSlots[i].solar, __ATOMIC_ACQUIRE);
+    if (solar) {
+      timespan_t timespan = valid ? schedulerSolarTimespanCalc(solar, &day, (time_t)date * 86400) : 0;
+      if (_schedulerSolarSlots[i].timespan != timespan) {
+        _schedulerSolarSlots[i].timespan = timespan;
+        changed = true;
+      };
+    };
+  };
+  // A registration or a new location during the calculation leaves -1 for the next tick
+  __atomic_compare_exchange_n(&_schedulerSolarDate, &seen, date, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+  if (changed) {
+    schedulerQueueInvalidate();
+  };
+}
+
+#endif // CONFIG_SCHEDULER_SOLAR
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Static tables ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#if CONFIG_SCHEDULER_TABLES
+
+typedef struct {
+  const schedulerTable_t* table;              // nullptr: the slot is free
+  bool known;                                 // The states have been calculated
+} schedulerTableSlot_t;
+
+static schedulerTableSlot_t _schedulerTableSlots[CONFIG_SCHEDULER_TABLES_MAX];
+static uint32_t _schedulerTableItems = 0;
+static uint32_t _schedulerTableChecks = 0;
+static time_t _schedulerTablesTime = 0;       // Tick of the previous check
+static uint32_t _schedulerTablesMinute = 0;   // and its minute of the day
+
+bool schedulerTableRegister(const schedulerTable_t* table)
+{
+  if (!table || (table->count == 0)) return false;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    const schedulerTable_t* expected = nullptr;
+    if (__atomic_compare_exchange_n(&_schedulerTableSlots[i].table, &expected, table, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      __atomic_add_fetch(&_schedulerTableItems, table->count, __ATOMIC_RELAXED);
+      schedulerTimerMainWakeup();
+      return true;
+    };
+  };
+  rlog_e(logTAG, "Too many static tables");
+  return false;
+}
+
+void schedulerTablesStats(uint32_t* items, uint32_t* checks)
+{
+  if (items) *items = _schedulerTableItems;
+  if (checks) *checks = _schedulerTableChecks;
+}
+
+static void schedulerTablesDiscard()
+{
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    _schedulerTableSlots[i].table = nullptr;
+    _schedulerTableSlots[i].known = false;
+  };
+  _schedulerTableItems = 0;
+  _schedulerTableChecks = 0;
+  _schedulerTablesTime = 0;
+  _schedulerTablesMinute = 0;
+}
+
+// Whether any of the count minutes after the minute from is a minute of the table
+static bool schedulerTableDue(const schedulerTable_t* table, uint32_t from, uint32_t count)
+{
+  for (uint32_t k = 1; k <= count; k++) {
+    if (schedulerBitGet(table->minutes, (from + k) % SCHEDULER_MINUTES_PER_DAY)) return true;
+  };
+  return false;
+}
+
+// A table is checked only at the minutes at which its items begin or end, after the clock jumps and when it is new.
+// Minutes passed since the previous check (a step of the clock forward, a late or a tickless tick) are caught up
+static void schedulerTablesCheck(struct tm* nowS, time_t nowT, bool full)
+{
+  uint32_t minute = nowS->tm_hour * 60 + nowS->tm_min;
+  uint16_t now = nowS->tm_hour * 100 + nowS->tm_min;
+  if ((_schedulerTablesTime == 0) || (nowT < _schedulerTablesTime) || (nowT - _schedulerTablesTime >= 86400)) {
+    full = true;
+  };
+  uint32_t from = _schedulerTablesMinute;
+  uint32_t passed = (minute + SCHEDULER_MINUTES_PER_DAY - from) % SCHEDULER_MINUTES_PER_DAY;
+  _schedulerTablesTime = nowT;
+  _schedulerTablesMinute = minute;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    schedulerTableSlot_t* slot = &_schedulerTableSlots[i];
+    const schedulerTable_t* table = __atomic_load_n(&slot->table, __ATOMIC_ACQUIRE);
+    if (!table || (slot->known && !full && !schedulerTableDue(table, from, passed))) continue;
+
+    _schedulerTableChecks++;
+    SCHEDULER_STAT_TICK(Items, table->count);
+    for (uint32_t w = 0; w < SCHEDULER_BITSET_WORDS(table->count); w++) {
+      uint32_t n = table->count - w * 32 < 32 ? table->count - w * 32 : 32;
+      uint32_t eval;
+      schedulerSpanEvaluate(table->begin + w * 32, table->end + w * 32, n, now, &eval);
+      uint32_t changed = slot->known ? eval ^ table->states[w] : (n < 32 ? (1UL << n) - 1 : UINT32_MAX);
+      table->states[w] = eval;
+      while (changed) {
+        uint32_t bit = __builtin_ctz(changed);
+        changed &= changed - 1;
+        SCHEDULER_STAT_TICK(Transitions, 1);
+        schedulerTransitionPost(table->values[w * 32 + bit], (eval >> bit) & 1, false);
+      };
+    };
+    slot->known = true;
+  };
+}
+
+#if CONFIG_SCHEDULER_TICKLESS
+
+// Minutes to the nearest minute of the day at which some table must be checked (1...1440)
+static uint32_t schedulerTablesNextMinutes(struct tm* nowS)
+{
+  uint32_t minute = nowS->tm_hour * 60 + nowS->tm_min;
+  uint32_t ret = SCHEDULER_MINUTES_PER_DAY;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    const schedulerTable_t* table = __atomic_load_n(&_schedulerTableSlots[i].table, __ATOMIC_ACQUIRE);
+    if (!table) continue;
+    if (!_schedulerTableSlots[i].known) return 1;
+    for (uint32_t delta = 1; delta < ret; delta++) {
+      if (schedulerBitGet(table->minutes, (minute + delta) % SCHEDULER_MINUTES_PER_DAY)) {
+        ret = delta;
+        break;
+      };
+    };
+  };
+  return ret;
+}
+
+#endif // CONFIG_SCHEDULER_TICKLESS
+
+#if CONFIG_SCHEDULER_REPLAY
+
+// Words of the states of all tables and their flags
+static uint32_t schedulerTablesWords()
+{
+  uint32_t words = CONFIG_SCHEDULER_TABLES_MAX;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    if (_schedulerTableSlots[i].table) {
+      words += SCHEDULER_BITSET_WORDS(_schedulerTableSlots[i].table->count);
+    };
+  };
+  return words;
+}
+
+static void schedulerTablesCopy(uint32_t* buffer, bool save)
+{
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_TABLES_MAX; i++) {
+    schedulerTableSlot_t* slot = &_schedulerTableSlots[i];
+    if (save) {
+      *buffer++ = slot->known;
+    } else {
+      slot->known = *buffer++;
+    };
+    if (slot->table) {
+      uint32_t words = SCHEDULER_BITSET_WORDS(slot->table->count);
+      if (save) {
+        memcpy(buffer, slot->table->states, words * sizeof(uint32_t));
+      } else {
+        memcpy(slot->table->states, buffer, words * sizeof(uint32_t));
+      };
+      buffer += words;
+    };
+  };
+}
+
+#endif // CONFIG_SCHEDULER_REPLAY
+
+#endif // CONFIG_SCHEDULER_TABLES
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------ Main Timer -----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// Boundaries in the order of posting: intervals within the hour, then the hour, day, week, month and year
+#define SCHEDULER_BOUNDARIES_COUNT      16
+#define SCHEDULER_BOUNDARIES_INTERVALS  11
+#define SCHEDULER_BOUNDARY_BIT_MINUTE   0x0001
+#define SCHEDULER_BOUNDARY_BIT_HOUR     (1UL << SCHEDULER_BOUNDARIES_INTERVALS)
+// Events that were posted regardless of subscribers: the minute, hour, day, week, month and year
+#define SCHEDULER_BOUNDARY_BITS_ALWAYS  (SCHEDULER_BOUNDARY_BIT_MINUTE | (0x1FUL << SCHEDULER_BOUNDARIES_INTERVALS))
+
+static const uint32_t _schedulerBoundaryMinutes[SCHEDULER_BOUNDARIES_COUNT] = { 1, 2, 3, 4, 5, 6, 10, 12, 15, 20, 30, 
+  SCHEDULER_BOUNDARY_HOUR, SCHEDULER_BOUNDARY_DAY, SCHEDULER_BOUNDARY_WEEK, SCHEDULER_BOUNDARY_MONTH, SCHEDULER_BOUNDARY_YEAR };
+static uint32_t _schedulerBoundarySubscribers[SCHEDULER_BOUNDARIES_COUNT];
+static uint32_t _schedulerBoundaryPosted = 0;
+static uint32_t _schedulerBoundarySaved = 0;
+static uint32_t _schedulerBoundaryPostedDay = 0;
+static uint32_t _schedulerBoundarySavedDay = 0;
+static uint32_t _schedulerBoundaryDayPosted = 0;      // Counters at the beginning of the current day
+static uint32_t _schedulerBoundaryDaySaved = 0;
+static int _schedulerBoundaryDay = -1;
+static time_t _schedulerBoundaryLast = 0;             // Minute of the previous tick
+
+static int schedulerBoundaryIndex(uint32_t minutes)
+{
+  for (int i = 0; i < SCHEDULER_BOUNDARIES_COUNT; i++) {
+    if (_schedulerBoundaryMinutes[i] == minutes) return i;
+  };
+  return -1;
+}
+
+bool schedulerBoundarySubscribe(uint32_t minutes)
+{
+  int index = schedulerBoundaryIndex(minutes);
+  if (index < 0) {
+    rlog_e(logTAG, "Unknown boundary: %d minutes", minutes);
+    return false;
+  };
+  __atomic_add_fetch(&_schedulerBoundarySubscribers[index], 1, __ATOMIC_RELAXED);
+  schedulerTimerMainWakeup();
+  return true;
+}
+
+void schedulerBoundaryUnsubscribe(uint32_t minutes)
+{
+  int index = schedulerBoundaryIndex(minutes);
+  if (index >= 0) {
+    uint32_t count = __atomic_load_n(&_schedulerBoundarySubscribers[index], __ATOMIC_RELAXED);
+    while ((count > 0) && !__atomic_compare_exchange_n(&_schedulerBoundarySubscribers[index], &count, count - 1, 
+      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  };
+}
+
+void schedulerEveryMinuteSubscribe()
+{
+  schedulerBoundarySubscribe(SCHEDULER_BOUNDARY_MINUTE);
+}
+
+void schedulerEveryMinuteUnsubscribe()
+{
+  schedulerBoundaryUnsubscribe(SCHEDULER_BOUNDARY_MINUTE);
+}
+
+void schedulerBoundaryStats(schedulerBoundaryStats_t* stats)
+{
+  if (stats) {
+    stats->posted = _schedulerBoundaryPosted;
+    stats->saved = _schedulerBoundarySaved;
+    stats->posted_day = _schedulerBoundaryPostedDay;
+    stats->saved_day = _schedulerBoundarySavedDay;
+  };
+}
+
+// Bits of the boundaries to be posted
+static uint32_t schedulerBoundariesActive()
+{
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < SCHEDULER_BOUNDARIES_COUNT; i++) {
+    if (__atomic_load_n(&_schedulerBoundarySubscribers[i], __ATOMIC_RELAXED) > 0) {
+      bits |= 1UL << i;
+    };
+  };
+  #if !CONFIG_SCHEDULER_BOUNDARIES
+    bits |= SCHEDULER_BOUNDARY_BITS_ALWAYS & ~SCHEDULER_BOUNDARY_BIT_MINUTE;
+    #if !CONFIG_SCHEDULER_TICKLESS
+      bits |= SCHEDULER_BOUNDARY_BIT_MINUTE;
+    #endif // CONFIG_SCHEDULER_TICKLESS
+  #endif // CONFIG_SCHEDULER_BOUNDARIES
+  return bits;
+}
+
+// Bits of the boundaries that begin at this minute
+static uint32_t schedulerBoundariesDue(struct tm* nowS)
+{
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < SCHEDULER_BOUNDARIES_INTERVALS; i++) {
+    if (nowS->tm_min % _schedulerBoundaryMinutes[i] == 0) {
+      bits |= 1UL << i;
+    };
+  };
+  if (nowS->tm_min == 0) {
+    bits |= SCHEDULER_BOUNDARY_BIT_HOUR;
+    if (nowS->tm_hour == 0) {
+      bits |= SCHEDULER_BOUNDARY_BIT_HOUR << 1;
+      if (nowS->tm_wday == CONFIG_FORMAT_FIRST_DAY_OF_WEEK) {
+        bits |= SCHEDULER_BOUNDARY_BIT_HOUR << 2;
+      };
+      if (nowS->tm_mday <= 1) {
+        bits |= SCHEDULER_BOUNDARY_BIT_HOUR << 3;
+        if (nowS->tm_mon == 0) {
+          bits |= SCHEDULER_BOUNDARY_BIT_HOUR << 4;
+        };
+      };
+    };
+  };
+  return bits;
+}
+
+#if CONFIG_SCHEDULER_TICKLESS
+
+// Minutes from the current one to the next boundary within the hour that has subscribers (1...60)
+static uint32_t schedulerBoundariesNextMinutes(struct tm* nowS)
+{
+  uint32_t active = schedulerBoundariesActive();
+  uint32_t ret = 60 - nowS->tm_min;
+  for (uint32_t i = 0; i < SCHEDULER_BOUNDARIES_INTERVALS; i++) {
+    if (active & (1UL << i)) {
+      uint32_t delta = _schedulerBoundaryMinutes[i] - nowS->tm_min % _schedulerBoundaryMinutes[i];
+      if (delta < ret) ret = delta;
+    };
+  };
+  return ret;
+}
+
+#endif // CONFIG_SCHEDULER_TICKLESS
+
+// Value passed with the event of the boundary
+static int schedulerBoundaryValue(uint32_t index, struct tm* local)
+{
+  switch (_schedulerBoundaryMinutes[index]) {
+    case SCHEDULER_BOUNDARY_HOUR:  return local->tm_hour;
+    case SCHEDULER_BOUNDARY_DAY:   return local->tm_mday;
+    case SCHEDULER_BOUNDARY_WEEK:  return local->tm_wday;
+    case SCHEDULER_BOUNDARY_MONTH: return local->tm_mon;
+    case SCHEDULER_BOUNDARY_YEAR:  return local->tm_year;
+    default:                       return local->tm_min;
+  };
+}
+
+static void schedulerBoundaryPostEvent(uint32_t index, int value)
+{
+  int32_t event_id;
+  switch (_schedulerBoundaryMinutes[index]) {
+    case SCHEDULER_BOUNDARY_MINUTE: event_id = RE_TIME_EVERY_MINUTE; break;
+    case SCHEDULER_BOUNDARY_HOUR:   event_id = RE_TIME_START_OF_HOUR; break;
+    case SCHEDULER_BOUNDARY_DAY:    event_id = RE_TIME_START_OF_DAY; break;
+    case SCHEDULER_BOUNDARY_WEEK:   event_id = RE_TIME_START_OF_WEEK; break;
+    case SCHEDULER_BOUNDARY_MONTH:  event_id = RE_TIME_START_OF_MONTH; break;
+    case SCHEDULER_BOUNDARY_YEAR:   event_id = RE_TIME_START_OF_YEAR; break;
+    default:                        event_id = RE_TIME_EVERY_MINUTES(_schedulerBoundaryMinutes[index]); break;
+  };
+  schedulerEventPost(event_id, &value, sizeof(int), TIME_EVENTS_POST_TIMEOUT);
+}
+
+// Publish the events about beginning of next intervals
+static void schedulerBoundariesPost(struct tm* nowS, time_t nowT)
+{
+  uint32_t due = schedulerBoundariesDue(nowS);
+  uint32_t post = due & schedulerBoundariesActive();
+  for (uint32_t bits = post; bits; bits &= bits - 1) {
+    uint32_t i = __builtin_ctz(bits);
+    schedulerBoundaryPostEvent(i, schedulerBoundaryValue(i, nowS));
+  };
+
+  if (!SCHEDULER_REPLAYING) {
+    // Minutes skipped by the tickless timer (never the start of an hour) had no every-minute events either
+    time_t minute = nowT - nowS->tm_sec;
+    if ((_schedulerBoundaryLast > 0) && (minute > _schedulerBoundaryLast + 60) && (minute <= _schedulerBoundaryLast + 3600)) {
+      _schedulerBoundarySaved += (minute - _schedulerBoundaryLast) / 60 - 1;
+    };
+    _schedulerBoundaryLast = minute;
+    if (nowS->tm_yday != _schedulerBoundaryDay) {
+      if (_schedulerBoundaryDay >= 0) {
+        _schedulerBoundaryPostedDay = _schedulerBoundaryPosted - _schedulerBoundaryDayPosted;
+        _schedulerBoundarySavedDay = _schedulerBoundarySaved - _schedulerBoundaryDaySaved;
+      };
+      _schedulerBoundaryDay = nowS->tm_yday;
+      _schedulerBoundaryDayPosted = _schedulerBoundaryPosted;
+      _schedulerBoundaryDaySaved = _schedulerBoundarySaved;
+    };
+    _schedulerBoundaryPosted += __builtin_popcount(post);
+    _schedulerBoundarySaved += __builtin_popcount(due & ~post & SCHEDULER_BOUNDARY_BITS_ALWAYS);
+  };
+}
+
+#if CONFIG_SCHEDULER_TICKLESS
+
+void schedulerTicklessStats(uint32_t* wakeups, uint32_t* skipped)
+{
+  if (wakeups) *wakeups = _schedulerTicklessWakeups;
+  if (skipped) *skipped = _schedulerTicklessSkipped;
+}
+
+// Number of minutes from the beginning of the current minute to the next instant that needs processing (1...60)
+static uint32_t schedulerTicklessNextMinutes(struct tm* nowS, time_t nowT)
+{
+  // Every minute is needed by the time publication and until the transition queue is built
+  bool everyMinute = !_schedulerQueueValid || __atomic_load_n(&_schedulerChanges, __ATOMIC_RELAXED);
+  #if CONFIG_MQTT_TIME_ENABLE
+    everyMinute = true;
+  #endif // CONFIG_MQTT_TIME_ENABLE
+  if (everyMinute) {
+    return 1;
+  };
+
+  // Next boundary with subscribers, but no later than the beginning of the next hour (and all longer intervals)
+  uint32_t ret = schedulerBoundariesNextMinutes(nowS);
+
+  // Next transition in the schedule list
+  if (_schedulerQueueCount > 0) {
+    time_t edge = _schedulerPool[_schedulerQueue[0]].edge;
+    uint32_t delta = (edge > nowT - nowS->tm_sec) ? (edge - (nowT - nowS->tm_sec)) / 60 : 1;
+    if (delta < ret) ret = delta;
+  };
+
+  // Next minute at which a static table is checked
+  #if CONFIG_SCHEDULER_TABLES
+    uint32_t tables = schedulerTablesNextMinutes(nowS);
+    if (tables < ret) ret = tables;
+  #endif // CONFIG_SCHEDULER_TABLES
+
+  // Next transitions of modes
+  uint32_t modes = __atomic_load_n(&_schedulerModesCount, __ATOMIC_ACQUIRE);
+  for (uint32_t i = 0; i < modes; i++) {
+    schedulerModeSlot_t* slot = &_schedulerModeSlots[i];
+    if (schedulerModeEnabled(slot)) {
+      uint32_t delta = schedulerTimespanEdgeDelta(nowS->tm_hour * 60 + nowS->tm_min, *slot->timespan);
+      if (delta < ret) ret = delta;
+    };
+  };
+
+  return ret > 0 ? ret : 1;
+}
+
+#endif // CONFIG_SCHEDULER_TICKLESS
+
+// Calculate the operating time of the device
+static void schedulerWorkTimeUpdate()
+{
+  #if CONFIG_SCHEDULER_TICKLESS
+    // Several minutes could have passed since the previous wakeup
+    int64_t nowUs = schedPortMonotonicUs();
+    if (_schedulerWorkTimeLast > 0) {
+      _schedulerWorkTimeUs += nowUs - _schedulerWorkTimeLast;
+    } else {
+      _schedulerWorkTimeUs += 60000000;
+    };
+    _schedulerWorkTimeLast = nowUs;
+    while (_schedulerWorkTimeUs >= 59000000) {
+      sysinfoWorkTimeInc();
+      _schedulerWorkTimeUs -= 60000000;
+    };
+  #else
+    sysinfoWorkTimeInc();
+  #endif // CONFIG_SCHEDULER_TICKLESS
+}
+
+// Create and post strings with date and time
+static void schedulerDateTimeUpdate(struct tm* nowS, time_t nowT)
+{
+  sysinfoFixDateTime(nowS);
+  #if CONFIG_MQTT_TIME_ENABLE
+    #if CONFIG_SCHEDULER_SPREAD
+      schedulerSpreadDateTime(nowS, nowT);
+    #else
+      mqttPublishDateTime(nowS);
+    #endif // CONFIG_SCHEDULER_SPREAD
+  #endif // CONFIG_MQTT_TIME_ENABLE
+}
+
+static void schedulerTimerMainExec(struct tm* nowS, time_t nowT, bool isCorrectTime)
+{
+  // Publish events about beginning of next intervals
+  schedulerBoundariesPost(nowS, nowT);
+
+  // The operating time and the date strings belong to the device, not to the simulated time
+  if (!SCHEDULER_REPLAYING) {
+    schedulerWorkTimeUpdate();
+  };
+
+  if (isCorrectTime) {
+    if (!SCHEDULER_REPLAYING) {
+      schedulerDateTimeUpdate(nowS, nowT);
+    };
 
-typedef struct schedulerItem_t {
-  timespan_t* timespan;
-  int8_t state;
-  uint_fast32_t value;
-  STAILQ_ENTRY(schedulerItem_t) next;
-} schedulerItem_t;
-typedef struct schedulerItem_t *schedulerItemHandle_t;
-STAILQ_HEAD(schedulerItemHead_t, schedulerItem_t);
-typedef struct schedulerItemHead_t *schedulerItemHeadHandle_t;
-static schedulerItemHeadHandle_t schedulerItems = nullptr;
+    // Timespans of solar schedules for the new day
+    #if CONFIG_SCHEDULER_SOLAR
+      schedulerSolarCheck(nowS);
+    #endif // CONFIG_SCHEDULER_SOLAR
 
-static bool _handlersRegistered = false;
-static esp_timer_handle_t _schedulerTimerMain = nullptr;
-#if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-static esp_timer_handle_t _schedulerTimerSysInfo = nullptr;
-#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-#if CONFIG_MQTT_TASKLIST_ENABLE
-static esp_timer_handle_t _schedulerTimerTasks = nullptr;
-#endif // CONFIG_MQTT_TASKLIST_ENABLE
+    // Check schedule list
+    if (_schedulerPool) {
+      schedulerQueueProcess(nowS, nowT);
+    };
 
-// -----------------------------------------------------------------------------------------------------------------------
-// ------------------------------------------------- Common functions ----------------------------------------------------
-// -----------------------------------------------------------------------------------------------------------------------
+    // Check modes (night / silent mode and others)
+    schedulerModesCheck(nowS);
 
-bool schedulerInit()
-{
-  if (!schedulerItems) {
-    schedulerItems = (schedulerItemHeadHandle_t)esp_calloc(1, sizeof(schedulerItemHead_t));
-    RE_MEM_CHECK(schedulerItems, return false);
-    STAILQ_INIT(schedulerItems);
+    #if CONFIG_SCHEDULER_SPREAD
+      if (!SCHEDULER_REPLAYING) {
+        schedulerSpreadArm(nowT - nowS->tm_sec);
+      };
+    #endif // CONFIG_SCHEDULER_SPREAD
   };
-  return true;
 }
 
-void schedulerFree()
+// Current wall time: predicted by the calendar (if it is anchored) or read from the clock
+static void schedulerTimerWallNow(struct timeval* now)
 {
-  if (schedulerItems) {
-    schedulerItemHandle_t itemL, tmpL;
-    STAILQ_FOREACH_SAFE(itemL, schedulerItems, next, tmpL) {
-      STAILQ_REMOVE(schedulerItems, itemL, schedulerItem_t, next);
-      free(itemL);
+  #if CONFIG_SCHEDULER_CALENDAR
+    if (_schedulerCalendarAnchored) {
+      schedulerCalendarNow(now);
+      return;
     };
-    free(schedulerItems);
-    schedulerItems = nullptr;
-  };
+  #endif // CONFIG_SCHEDULER_CALENDAR
+  schedulerClockWall(now);
 }
 
-bool schedulerRegister(timespan_t* timespan, uint32_t value)
+static void schedulerLocalTime(time_t time, struct tm* local)
 {
-  if (schedulerItems) {
-    schedulerItemHandle_t item = (schedulerItemHandle_t)esp_calloc(1, sizeof(schedulerItem_t));
-    RE_MEM_CHECK(item, return false);
-    item->timespan = timespan;
-    item->value = value;
-    item->state = -1;
-    STAILQ_INSERT_TAIL(schedulerItems, item, next);
-    return true;
+  #if CONFIG_SCHEDULER_CALENDAR
+    schedulerCalendarLocal(time, local);
+  #else
+    schedulerClockLocal(time, local);
+  #endif // CONFIG_SCHEDULER_CALENDAR
+}
+
+// Start the timer at the beginning of the minute next_t (or of the nearest minute if next_t has already passed).
+// The deadline is kept on the monotonic clock; it is shifted only when the wall clock has moved relative to it.
+// Called only by the tick, so the deadline is never written by two tasks at once
+static void schedulerTimerMainArm(time_t next_t)
+{
+  struct timeval wall;
+  schedulerTimerWallNow(&wall);
+  int64_t nowUs = schedPortMonotonicUs();
+  int64_t wallUs = (int64_t)wall.tv_sec * 1000000 + wall.tv_usec;
+  int64_t offset = wallUs - nowUs;
+  if ((_schedulerTimerOffset == INT64_MIN) || (offset - _schedulerTimerOffset > SCHEDULER_TIMER_TOLERANCE_US) 
+   || (_schedulerTimerOffset - offset > SCHEDULER_TIMER_TOLERANCE_US)) {
+    if (_schedulerTimerOffset != INT64_MIN) {
+      _schedulerTimingResyncs++;
+    };
+    _schedulerTimerOffset = offset;
   };
-  return false;
+  if ((int64_t)next_t * 1000000 <= wallUs) {
+    next_t = wall.tv_sec - wall.tv_sec % 60 + 60;
+  };
+  _schedulerTimerExpected = next_t;
+  _schedulerTimerTarget = (int64_t)next_t * 1000000 - _schedulerTimerOffset;
+  int64_t timeout_us = _schedulerTimerTarget - nowUs;
+  // Another task has already restarted the timer: it will come back here right away
+  if (schedPortTimerIsActive(_schedulerTimerMain)) return;
+  RE_OK_CHECK(schedPortTimerStartOnce(_schedulerTimerMain, timeout_us > 0 ? timeout_us : 1), return);
+  rlog_d(logTAG, "Restart schedule timer for %lld microseconds", timeout_us);
 }
 
-// -----------------------------------------------------------------------------------------------------------------------
-// ----------------------------------------------------- Silent mode -----------------------------------------------------
-// -----------------------------------------------------------------------------------------------------------------------
+// Boundaries that fell on minutes missed after a stall are posted once each (the latest one), with the same subscriptions
+// and counters as on a tick; the every-minute event is not replayed, the skipped minutes are counted by the tick
+static void schedulerTimerMainReplay(time_t from, time_t to)
+{
+  uint32_t minutes = (uint32_t)((to - from) / 60);
+  _schedulerTimingMissed += minutes;
+  if (minutes > SCHEDULER_REPLAY_MINUTES_MAX) {
+    // This is a jump of the clock rather than a stall
+    return;
+  };
 
-#if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+  uint32_t due = 0;
+  int values[SCHEDULER_BOUNDARIES_COUNT];
+  struct tm missed;
+  for (time_t t = from; t < to; t += 60) {
+    schedulerLocalTime(t, &missed);
+    uint32_t bits = schedulerBoundariesDue(&missed) & ~SCHEDULER_BOUNDARY_BIT_MINUTE;
+    for (uint32_t b = bits; b; b &= b - 1) {
+      uint32_t i = __builtin_ctz(b);
+      values[i] = schedulerBoundaryValue(i, &missed);
+    };
+    due |= bits;
+  };
 
-static timespan_t tsSilentModeTimespan = CONFIG_SILENT_MODE_INTERVAL;
-#if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
-static bool enabledSilentMode = true;
-#endif // CONFIG_SILENT_MODE_EXTENDED
-static bool stateSilentMode = false;
-static const char* tagSM = "TIME";
+  uint32_t post = due & schedulerBoundariesActive();
+  if (post) {
+    rlog_w(logTAG, "%d minutes were missed, boundary events are replayed", minutes);
+    for (uint32_t bits = post; bits; bits &= bits - 1) {
+      uint32_t i = __builtin_ctz(bits);
+      schedulerBoundaryPostEvent(i, values[i]);
+    };
+  };
+  _schedulerTimingReplayed += __builtin_popcount(post);
+  _schedulerBoundaryPosted += __builtin_popcount(post);
+  _schedulerBoundarySaved += __builtin_popcount(due & ~post & SCHEDULER_BOUNDARY_BITS_ALWAYS);
+}
 
-void silentModeRegister()
+// Processing of one tick: schedules, events and restart of the timer
+static void schedulerTimerMainProcess(struct timeval* tick_time)
 {
-  #if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
-    paramsGroupHandle_t _pgSilentMode = paramsRegisterGroup(nullptr, CONFIG_SILENT_MODE_PGROUP_KEY, CONFIG_SILENT_MODE_PGROUP_TOPIC, CONFIG_SILENT_MODE_PGROUP_FRIENDLY);
-    if (_pgSilentMode) {
-      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_U8, nullptr, _pgSilentMode, 
-        CONFIG_SILENT_MODE_ENABLE_TOPIC, CONFIG_SILENT_MODE_ENABLE_FRIENDLY,
-        CONFIG_MQTT_PARAMS_QOS, (void*)&enabledSilentMode);
-      paramsRegisterValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, _pgSilentMode, 
-        CONFIG_SILENT_MODE_TIMESPAN_TOPIC, CONFIG_SILENT_MODE_TIMESPAN_FRIENDLY,
-        CONFIG_MQTT_PARAMS_QOS, (void*)&tsSilentModeTimespan);
+  static struct timeval now_time;
+  static struct tm now_tm;
+  
+  // Get time of the tick
+  now_time = *tick_time;
+  #if CONFIG_SCHEDULER_CALENDAR
+    schedulerCalendarCheck(&now_time);
+  #endif // CONFIG_SCHEDULER_CALENDAR
+  time_t expected = _schedulerTimerExpected;
+  if ((now_time.tv_sec < expected) && (expected - now_time.tv_sec <= 1)) {
+    // The wall clock lags slightly behind the monotonic one: the tick still belongs to the expected minute
+    now_time.tv_sec = expected;
+    now_time.tv_usec = 0;
+  };
+  if (now_time.tv_sec < expected) {
+    // Fired early by schedulerTimerMainFire(): only the modes are re-checked if asked, the next tick moves to the
+    // beginning of the next minute
+    if (__atomic_exchange_n(&_schedulerModesPending, false, __ATOMIC_ACQ_REL) && (now_time.tv_sec > 1000000000)) {
+      schedulerLocalTime(now_time.tv_sec, &now_tm);
+      schedulerModesCheck(&now_tm);
+    };
+    schedulerTimerMainArm(0);
+    return;
+  };
+  __atomic_store_n(&_schedulerModesPending, false, __ATOMIC_RELEASE);
+  schedulerLocalTime(now_time.tv_sec, &now_tm);
+  bool isCorrectTime = now_time.tv_sec > 1000000000;
+
+  // Minutes between the expected and the actual tick were missed
+  time_t minute = now_time.tv_sec - now_time.tv_sec % 60;
+  if (isCorrectTime && (expected > 1000000000) && (minute > expected)) {
+    schedulerTimerMainReplay(expected, minute);
+  };
+
+  // Minutes slept through since the previous wakeup (those after the expected one were missed rather than skipped)
+  #if CONFIG_SCHEDULER_TICKLESS
+    time_t planned = (expected > 0) && (expected < minute) ? expected : minute;
+    if ((_schedulerTicklessLast > 0) && (planned > _schedulerTicklessLast + 60)) {
+      _schedulerTicklessSkipped += (uint32_t)((planned - _schedulerTicklessLast) / 60) - 1;
     };
+    _schedulerTicklessLast = minute;
+    _schedulerTicklessWakeups++;
+  #endif // CONFIG_SCHEDULER_TICKLESS
+  
+  // Process schedules
+  #if CONFIG_SCHEDULER_STATS
+    int64_t started = schedPortMonotonicUs();
+    schedulerTimerMainExec(&now_tm, now_time.tv_sec, isCorrectTime);
+    schedulerStatTickDone((uint32_t)(schedPortMonotonicUs() - started));
   #else
-    paramsRegisterCommonValue(OPT_KIND_PARAMETER, OPT_TYPE_TIMESPAN, nullptr, 
-      CONFIG_SILENT_MODE_TOPIC, CONFIG_SILENT_MODE_FRIENDLY,
-      CONFIG_MQTT_PARAMS_QOS, (void*)&tsSilentModeTimespan);
-  #endif // CONFIG_SILENT_MODE_EXTENDED
+    schedulerTimerMainExec(&now_tm, now_time.tv_sec, isCorrectTime);
+  #endif // CONFIG_SCHEDULER_STATS
+
+  // Restart the timer at the beginning of the next minute
+  #if CONFIG_SCHEDULER_TICKLESS
+    schedulerTimerMainArm(minute + 60 * (time_t)schedulerTicklessNextMinutes(&now_tm, now_time.tv_sec));
+  #else
+    schedulerTimerMainArm(minute + 60);
+  #endif // CONFIG_SCHEDULER_TICKLESS
 }
 
-void silentModeCheck(struct tm* timeinfo)
+#if CONFIG_SCHEDULER_WORKER
+
+// Single producer (timer callback), single consumer (worker) queue of tick times
+static bool schedulerWorkerPush(struct timeval* tick_time)
 {
-  #if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
-  if (enabledSilentMode && (tsSilentModeTimespan > 0)) {
-  #else
-  if (tsSilentModeTimespan > 0) {
-  #endif // CONFIG_SILENT_MODE_EXTENDED
-    bool newSilentMode = checkTimespan(timeinfo, tsSilentModeTimespan);
-    // If the mode has changed
-    if (stateSilentMode != newSilentMode) {
-      stateSilentMode = newSilentMode;
-      if (newSilentMode) {
-        rlog_i(tagSM, "Silent mode activated");
-        eventLoopPost(RE_TIME_EVENTS, RE_TIME_SILENT_MODE_ON, nullptr, 0, portMAX_DELAY);
-      } else {
-        eventLoopPost(RE_TIME_EVENTS, RE_TIME_SILENT_MODE_OFF, nullptr, 0, portMAX_DELAY);
-        rlog_i(tagSM, "Silent mode disabled");
-      };
-    };
+  uint32_t head = _schedulerWorkerHead;
+  if (head - __atomic_load_n(&_schedulerWorkerTail, __ATOMIC_ACQUIRE) >= SCHEDULER_WORKER_QUEUE_SIZE) {
+    return false;
   };
+  _schedulerWorkerQueue[head % SCHEDULER_WORKER_QUEUE_SIZE] = *tick_time;
+  __atomic_store_n(&_schedulerWorkerHead, head + 1, __ATOMIC_RELEASE);
+  return true;
 }
 
-void silentModeCheckExternal()
+static bool schedulerWorkerPop(struct timeval* tick_time)
 {
-  time_t nowT;
-  struct tm nowS;
-  nowT = time(nullptr);
-  localtime_r(&nowT, &nowS);
-  silentModeCheck(&nowS);
+  uint32_t tail = _schedulerWorkerTail;
+  if (tail == __atomic_load_n(&_schedulerWorkerHead, __ATOMIC_ACQUIRE)) {
+    return false;
+  };
+  *tick_time = _schedulerWorkerQueue[tail % SCHEDULER_WORKER_QUEUE_SIZE];
+  __atomic_store_n(&_schedulerWorkerTail, tail + 1, __ATOMIC_RELEASE);
+  return true;
 }
 
-bool isSilentMode()
+static void schedulerWorkerExec(void* arg)
 {
-  #if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
-    return enabledSilentMode && stateSilentMode;
-  #else
-    return stateSilentMode;
-  #endif // CONFIG_SILENT_MODE_EXTENDED
+  struct timeval tick_time;
+  while (_schedulerWorkerRun) {
+    schedPortTaskWait();
+    while (_schedulerWorkerRun && schedulerWorkerPop(&tick_time)) {
+      schedulerTimerMainProcess(&tick_time);
+    };
+  };
+  _schedulerWorker = nullptr;
+  schedPortTaskExit();
 }
 
-#endif // CONFIG_SILENT_MODE_ENABLE
-
-// -----------------------------------------------------------------------------------------------------------------------
-// ------------------------------------------------------ Main Timer -----------------------------------------------------
-// -----------------------------------------------------------------------------------------------------------------------
-
-static void schedulerTimerMainExec(struct tm* nowS, bool isCorrectTime)
+static bool schedulerWorkerStart()
 {
-  // Publish an event every minute
-  eventLoopPost(RE_TIME_EVENTS, RE_TIME_EVERY_MINUTE, &(nowS->tm_min), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
+  if (!_schedulerWorker) {
+    _schedulerWorkerHead = 0;
+    _schedulerWorkerTail = 0;
+    _schedulerWorkerRun = true;
+    schedPortTask_t worker = nullptr;
+    RE_OK_CHECK(schedPortTaskCreate("scheduler", schedulerWorkerExec, 
+      CONFIG_SCHEDULER_WORKER_STACK_SIZE, CONFIG_SCHEDULER_WORKER_PRIORITY, CONFIG_SCHEDULER_WORKER_CORE, &worker), 
+      _schedulerWorkerRun = false; return false);
+    _schedulerWorker = worker;
+    rlog_i(logTAG, "Task [scheduler] was created");
+  };
+  return true;
+}
 
-  // Publish an event about beginning of next interval
-  if (nowS->tm_min == 0) {
-    eventLoopPost(RE_TIME_EVENTS, RE_TIME_START_OF_HOUR, &(nowS->tm_hour), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
-    if (nowS->tm_hour == 0) {
-      eventLoopPost(RE_TIME_EVENTS, RE_TIME_START_OF_DAY, &(nowS->tm_mday), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
-      if (nowS->tm_wday == CONFIG_FORMAT_FIRST_DAY_OF_WEEK) {
-        eventLoopPost(RE_TIME_EVENTS, RE_TIME_START_OF_WEEK, &(nowS->tm_wday), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
-      };
-      if (nowS->tm_mday <= 1) {
-        eventLoopPost(RE_TIME_EVENTS, RE_TIME_START_OF_MONTH, &(nowS->tm_mon), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
-        if (nowS->tm_mon == 0) {
-          eventLoopPost(RE_TIME_EVENTS, RE_TIME_START_OF_YEAR, &(nowS->tm_year), sizeof(int), TIME_EVENTS_POST_TIMEOUT);
-        };
-      };
+static void schedulerWorkerStop()
+{
+  if (_schedulerWorker) {
+    _schedulerWorkerRun = false;
+    schedPortTaskNotify(_schedulerWorker);
+    while (_schedulerWorker) {
+      schedPortDelayMs(10);
     };
+    rlog_i(logTAG, "Task [scheduler] was deleted");
   };
+}
 
-  // Calculate the operating time of the device
-  sysinfoWorkTimeInc();
+#endif // CONFIG_SCHEDULER_WORKER
 
-  if (isCorrectTime) {
-    // Create strings with date and time
-    sysinfoFixDateTime(nowS);
+static void schedulerTimerMainTimeout(void* arg)
+{
+  int64_t started = schedPortMonotonicUs();
+  struct timeval tick_time;
+  schedulerClockWall(&tick_time);
 
-    // Post generated strings with date and time
-    #if CONFIG_MQTT_TIME_ENABLE
-    mqttPublishDateTime(nowS);
-    #endif // CONFIG_MQTT_TIME_ENABLE
+  // Lateness against the ideal boundary (early wakeups are not ticks)
+  if ((_schedulerTimerTarget > 0) && (started >= _schedulerTimerTarget)) {
+    int64_t late = started - _schedulerTimerTarget;
+    _schedulerTimingLateLast = late >= UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+    if (_schedulerTimingLateLast > _schedulerTimingLateMax) {
+      _schedulerTimingLateMax = _schedulerTimingLateLast;
+    };
+    _schedulerTimingLateSum += _schedulerTimingLateLast;
+    _schedulerTimingTicks++;
+    #if CONFIG_SCHEDULER_STATS
+      schedulerStatHistogram(_schedulerStats.late_hist, _schedulerTimingLateLast);
+    #endif // CONFIG_SCHEDULER_STATS
+  };
 
-    // Check schedule list
-    if (schedulerItems) {
-      schedulerItemHandle_t item;
-      STAILQ_FOREACH(item, schedulerItems, next) {
-        int8_t newState = checkTimespan(nowS, *item->timespan);
-        if (newState != item->state) {
-          item->state = newState;
-          if (newState == 1) {
-            eventLoopPost(RE_TIME_EVENTS, RE_TIME_TIMESPAN_ON, (void*)(item->value), sizeof(item->value), TIME_EVENTS_POST_TIMEOUT);
-          } else {
-            eventLoopPost(RE_TIME_EVENTS, RE_TIME_TIMESPAN_OFF, (void*)(item->value), sizeof(item->value), TIME_EVENTS_POST_TIMEOUT);
-          };
-        };
+  #if CONFIG_SCHEDULER_WORKER
+    // Only pass the time of the tick to the worker
+    if (_schedulerWorker) {
+      if (schedulerWorkerPush(&tick_time)) {
+        schedPortTaskNotify(_schedulerWorker);
+      } else {
+        rlog_w(logTAG, "Scheduler worker is overloaded, tick skipped");
       };
+    } else {
+      schedulerTimerMainProcess(&tick_time);
     };
+  #else
+    schedulerTimerMainProcess(&tick_time);
+  #endif // CONFIG_SCHEDULER_WORKER
 
-    // Check night (silent) mode
-    #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
-    silentModeCheck(nowS);
-    #endif // CONFIG_SILENT_MODE_ENABLE
+  _schedulerCallbackLast = (uint32_t)(schedPortMonotonicUs() - started);
+  if (_schedulerCallbackLast > _schedulerCallbackMax) {
+    _schedulerCallbackMax = _schedulerCallbackLast;
   };
 }
 
-static void schedulerTimerMainTimeout(void* arg)
+void schedulerTimerCallbackTime(uint32_t* last_us, uint32_t* max_us)
 {
-  static struct timeval now_time;
-  static struct tm now_tm;
-  
-  // Get current time
-  gettimeofday(&now_time, nullptr);
-  localtime_r(&now_time.tv_sec, &now_tm);
-  
-  // Process schedules
-  schedulerTimerMainExec(&now_tm, now_time.tv_sec > 1000000000);
+  if (last_us) *last_us = _schedulerCallbackLast;
+  if (max_us) *max_us = _schedulerCallbackMax;
+}
+
+void schedulerTimingStats(schedulerTimingStats_t* stats)
+{
+  if (stats) {
+    stats->ticks = _schedulerTimingTicks;
+    stats->late_last_us = _schedulerTimingLateLast;
+    stats->late_max_us = _schedulerTimingLateMax;
+    stats->late_avg_us = _schedulerTimingTicks > 0 ? (uint32_t)(_schedulerTimingLateSum / _schedulerTimingTicks) : 0;
+    stats->missed = _schedulerTimingMissed;
+    stats->replayed = _schedulerTimingReplayed;
+    stats->resyncs = _schedulerTimingResyncs;
+  };
+}
+
+// Fire the timer right away. Any task may call it: the tick itself sets the new deadline
+static void schedulerTimerMainFire()
+{
+  if (_schedulerTimerMain) {
+    if (schedPortTimerIsActive(_schedulerTimerMain)) {
+      schedPortTimerStop(_schedulerTimerMain);
+    };
+    // Fails only if another task or the tick has just started it
+    schedPortTimerStartOnce(_schedulerTimerMain, 1);
+  };
+}
 
-  // Calculate the timeout until the beginning of the next minute
-  gettimeofday(&now_time, nullptr);
-  localtime_r(&now_time.tv_sec, &now_tm);
-  uint32_t timeout_us = (((int)60 - (int)now_tm.tm_sec) * 1000000 - now_time.tv_usec) + 1;
-  RE_OK_CHECK(esp_timer_start_once(_schedulerTimerMain, timeout_us), return);
-  rlog_d(logTAG, "Restart schedule timer for %d microseconds (sec=%d, usec=%d)", timeout_us, (int)now_tm.tm_sec, now_time.tv_usec);  
+// Restart the timer at the beginning of the next minute if it sleeps longer (tickless mode only)
+static void schedulerTimerMainWakeup()
+{
+  #if CONFIG_SCHEDULER_TICKLESS
+    schedulerTimerMainFire();
+  #endif // CONFIG_SCHEDULER_TICKLESS
 }
 
 static bool schedulerTimerMainCreate()
 {
   if (!_schedulerTimerMain) {
-    esp_timer_create_args_t cfgTimer;
-    memset(&cfgTimer, 0, sizeof(cfgTimer));
-    cfgTimer.name = "scheduler_main";
-    cfgTimer.callback = schedulerTimerMainTimeout;
-    RE_OK_CHECK(esp_timer_create(&cfgTimer, &_schedulerTimerMain), return false);
+    #if CONFIG_SCHEDULER_WORKER
+      if (!schedulerWorkerStart()) return false;
+    #endif // CONFIG_SCHEDULER_WORKER
+    RE_OK_CHECK(schedPortTimerCreate("scheduler_main", schedulerTimerMainTimeout, &_schedulerTimerMain), return false);
     if (_schedulerTimerMain) {
-      RE_OK_CHECK(esp_timer_start_once(_schedulerTimerMain, 1000000), return false);
+      RE_OK_CHECK(schedPortTimerStartOnce(_schedulerTimerMain, 1000000), return false);
     };
     return true;
   };
@@ -255,155 +3533,396 @@ static bool schedulerTimerMainCreate()
 static void schedulerTimerMainDelete()
 {
   if (_schedulerTimerMain) {
-    if (esp_timer_is_active(_schedulerTimerMain)) {
-      esp_timer_stop(_schedulerTimerMain);
+    if (schedPortTimerIsActive(_schedulerTimerMain)) {
+      schedPortTimerStop(_schedulerTimerMain);
     };
-    RE_OK_CHECK(esp_timer_delete(_schedulerTimerMain), return);
+    RE_OK_CHECK(schedPortTimerDelete(_schedulerTimerMain), return);
     _schedulerTimerMain = nullptr;
+    _schedulerTimerOffset = INT64_MIN;
+    _schedulerTimerTarget = 0;
+    _schedulerTimerExpected = 0;
+    #if CONFIG_SCHEDULER_TICKLESS
+      _schedulerTicklessLast = 0;
+    #endif // CONFIG_SCHEDULER_TICKLESS
+  };
+  #if CONFIG_SCHEDULER_WORKER
+    schedulerWorkerStop();
+  #endif // CONFIG_SCHEDULER_WORKER
+}
+
+void schedulerSetClock(const schedulerClock_t* clock)
+{
+  _schedulerClock = clock;
+  #if CONFIG_SCHEDULER_CALENDAR
+    schedulerCalendarReset();
+  #endif // CONFIG_SCHEDULER_CALENDAR
+  #if CONFIG_SCHEDULER_SOLAR
+    schedulerSolarInvalidate();
+  #endif // CONFIG_SCHEDULER_SOLAR
+  schedulerQueueInvalidate();
+}
+
+#if CONFIG_SCHEDULER_REPLAY
+
+bool schedulerReplay(time_t from, time_t to, schedulerReplayLog_t log, void* arg, schedulerReplayStats_t* stats)
+{
+  if (!log || (to <= from)) return false;
+  if (_schedulerTimerMain) {
+    rlog_e(logTAG, "Replay is not possible while the scheduler is running");
+    return false;
+  };
+
+  // Pending changes are applied first, so that the pool does not move during the replay
+  schedulerChangesApply();
+  uint32_t words = SCHEDULER_BITSET_WORDS(_schedulerPoolCount);
+  uint32_t tableWords = 0;
+  #if CONFIG_SCHEDULER_TABLES
+    tableWords = schedulerTablesWords();
+  #endif // CONFIG_SCHEDULER_TABLES
+  uint32_t* saved = nullptr;
+  if (words + tableWords > 0) {
+    saved = (uint32_t*)esp_calloc(2 * words + tableWords, sizeof(uint32_t));
+    RE_MEM_CHECK(saved, return false);
+    memcpy(saved, _schedulerStates, words * sizeof(uint32_t));
+    memcpy(saved + words, _schedulerKnown, words * sizeof(uint32_t));
+    #if CONFIG_SCHEDULER_TABLES
+      schedulerTablesCopy(saved + 2 * words, true);
+    #endif // CONFIG_SCHEDULER_TABLES
+  };
+  time_t queueTime = _schedulerQueueTime;
+  int queueIsDst = _schedulerQueueIsDst;
+  _schedulerReplayModes = schedulerModes();
+
+  _schedulerReplayArg = arg;
+  _schedulerReplayEvents = 0;
+  _schedulerReplayTransitions = 0;
+  _schedulerReplayLog = log;
+  _schedulerQueueValid = false;
+  uint32_t ticks = 0;
+  int64_t started = schedPortMonotonicUs();
+  struct tm nowS;
+  for (time_t t = from + (60 - from % 60) % 60; t < to; t += 60) {
+    _schedulerReplayRecord.time = t;
+    schedulerLocalTime(t, &nowS);
+    schedulerTimerMainExec(&nowS, t, true);
+    ticks++;
+  };
+  uint32_t elapsed = (uint32_t)(schedPortMonotonicUs() - started);
+  _schedulerReplayLog = nullptr;
+
+  // Back to the real time
+  if (saved) {
+    memcpy(_schedulerStates, saved, words * sizeof(uint32_t));
+    memcpy(_schedulerKnown, saved + words, words * sizeof(uint32_t));
+    #if CONFIG_SCHEDULER_TABLES
+      schedulerTablesCopy(saved + 2 * words, false);
+    #endif // CONFIG_SCHEDULER_TABLES
+    free(saved);
+  };
+  _schedulerQueueTime = queueTime;
+  _schedulerQueueIsDst = queueIsDst;
+  _schedulerQueueValid = false;
+  #if CONFIG_SCHEDULER_SOLAR
+    _schedulerSolarDate = -1;
+  #endif // CONFIG_SCHEDULER_SOLAR
+  #if CONFIG_SCHEDULER_STATS
+    _schedulerTickItems = 0;
+    _schedulerTickTransitions = 0;
+  #endif // CONFIG_SCHEDULER_STATS
+
+  if (stats) {
+    stats->ticks = ticks;
+    stats->events = _schedulerReplayEvents;
+    stats->transitions = _schedulerReplayTransitions;
+    stats->elapsed_us = elapsed;
+    stats->ticks_per_sec = elapsed > 0 ? (uint32_t)((uint64_t)ticks * 1000000 / elapsed) : 0;
   };
+  rlog_i(logTAG, "Replay: %d minutes, %d events in %d ms", ticks, _schedulerReplayEvents, elapsed / 1000);
+  return true;
 }
 
+#endif // CONFIG_SCHEDULER_REPLAY
+
 // -----------------------------------------------------------------------------------------------------------------------
-// ----------------------------------------------------- Status Timer ----------------------------------------------------
+// ---------------------------------------------------- Periodic jobs ----------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
+// All jobs share one timer. It wakes up at the earliest time when some job can no longer be delayed 
+// (deadline + slack) and runs every job whose deadline has come by then.
+// A slot is claimed by a registering task (FREE -> RESERVED -> NEW); only the timer changes deadlines and restarts itself.
+typedef enum {
+  SCHEDULER_JOB_FREE = 0,
+  SCHEDULER_JOB_RESERVED,
+  SCHEDULER_JOB_NEW,            // The first deadline has yet to be calculated
+  SCHEDULER_JOB_ACTIVE
+} schedulerJobState_t;
+
+typedef struct {
+  uint8_t state;
+  const char* name;
+  schedulerJobCallback_t callback;
+  void* arg;
+  int64_t interval_us;
+  int64_t slack_us;
+  int64_t phase_us;             // < 0: no alignment
+  int64_t deadline_us;          // Monotonic time of the next run
+} schedulerJob_t;
+
+static schedulerJob_t _schedulerJobs[CONFIG_SCHEDULER_JOBS_MAX];
+// With load smoothing, publications of different devices are spread over the interval
+#if CONFIG_SCHEDULER_SPREAD
+#define SCHEDULER_JOBS_BUILTIN_PHASE ((int32_t)_schedulerSpreadDelayMs)
+#else
+#define SCHEDULER_JOBS_BUILTIN_PHASE SCHEDULER_JOB_PHASE_NONE
+#endif // CONFIG_SCHEDULER_SPREAD
+static schedPortTimer_t _schedulerTimerJobs = nullptr;
+static volatile bool _schedulerJobsSuspended = false;
+static schedulerJobsStats_t _schedulerJobsStats = { 0, 0, 0, 0 };
+
 #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+static schedulerJobHandle_t _schedulerJobSysInfo = SCHEDULER_JOB_INVALID;
+#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+#if CONFIG_MQTT_TASKLIST_ENABLE
+static schedulerJobHandle_t _schedulerJobTasks = SCHEDULER_JOB_INVALID;
+#endif // CONFIG_MQTT_TASKLIST_ENABLE
 
-static void schedulerTimerSysInfoExec(void* arg)
+// The first deadline: one interval from now, or the next instant of the wall clock that is "phase" past a multiple of the interval
+static int64_t schedulerJobFirstDeadline(schedulerJob_t* job, int64_t nowUs)
 {
-  sysinfoPublishSysInfo();
+  if (job->phase_us < 0) {
+    return nowUs + job->interval_us;
+  };
+  struct timeval wall;
+  schedulerClockWall(&wall);
+  int64_t wallUs = (int64_t)wall.tv_sec * 1000000 + wall.tv_usec;
+  int64_t sincePhase = ((wallUs - job->phase_us) % job->interval_us + job->interval_us) % job->interval_us;
+  return nowUs + job->interval_us - sincePhase;
 }
 
-static bool schedulerTimerSysInfoStart()
+static void schedulerJobsExec(void* arg)
 {
-  if (_schedulerTimerSysInfo) {
-    if (esp_timer_is_active(_schedulerTimerSysInfo)) {
-      esp_timer_stop(_schedulerTimerSysInfo);
+  int64_t nowUs = schedPortMonotonicUs();
+  int64_t wakeUs = INT64_MAX;
+  uint32_t runs = 0;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_JOBS_MAX; i++) {
+    schedulerJob_t* job = &_schedulerJobs[i];
+    uint8_t state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+    if (state == SCHEDULER_JOB_NEW) {
+      job->deadline_us = schedulerJobFirstDeadline(job, nowUs);
+      uint8_t expected = SCHEDULER_JOB_NEW;
+      if (!__atomic_compare_exchange_n(&job->state, &expected, SCHEDULER_JOB_ACTIVE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) continue;
+    } else if (state != SCHEDULER_JOB_ACTIVE) {
+      continue;
+    } else if (!_schedulerJobsSuspended && (job->deadline_us <= nowUs)) {
+      job->callback(job->arg);
+      runs++;
+      // Missed runs are skipped, the job stays on its grid
+      job->deadline_us += job->interval_us * ((nowUs - job->deadline_us) / job->interval_us + 1);
+    };
+    if (job->deadline_us + job->slack_us < wakeUs) {
+      wakeUs = job->deadline_us + job->slack_us;
     };
-    RE_OK_CHECK(esp_timer_start_periodic(_schedulerTimerSysInfo, CONFIG_MQTT_SYSINFO_INTERVAL * 1000), return false);
-    rlog_i(logTAG, "Timer [scheduler_sysinfo] was started");
-    return true;
   };
-  return false;
+  if (runs > 0) {
+    _schedulerJobsStats.wakeups++;
+    _schedulerJobsStats.runs += runs;
+    _schedulerJobsStats.merged += runs - 1;
+  };
+
+  if (!_schedulerJobsSuspended && (wakeUs != INT64_MAX)) {
+    int64_t timeout_us = wakeUs - schedPortMonotonicUs();
+    RE_OK_CHECK(schedPortTimerStartOnce(_schedulerTimerJobs, timeout_us > 0 ? timeout_us : 1), return);
+  };
 }
 
-static bool schedulerTimerSysInfoCreate(bool createSuspened)
+// Let the timer recalculate its wakeup right away
+static void schedulerJobsWakeup()
 {
-  if (!_schedulerTimerSysInfo) {
-    esp_timer_create_args_t cfgTimer;
-    memset(&cfgTimer, 0, sizeof(cfgTimer));
-    cfgTimer.name = "scheduler_sysinfo";
-    cfgTimer.callback = schedulerTimerSysInfoExec;
-    RE_OK_CHECK(esp_timer_create(&cfgTimer, &_schedulerTimerSysInfo), return false);
-    if (!createSuspened) {
-      return schedulerTimerSysInfoStart();
+  if (_schedulerTimerJobs && !_schedulerJobsSuspended) {
+    if (schedPortTimerIsActive(_schedulerTimerJobs)) {
+      schedPortTimerStop(_schedulerTimerJobs);
     };
-    return true;
+    schedPortTimerStartOnce(_schedulerTimerJobs, 1);
   };
-  return false;
 }
 
-static bool schedulerTimerSysInfoStop()
+schedulerJobHandle_t schedulerJobRegister(const char* name, uint32_t interval_ms, uint32_t slack_ms, int32_t phase_ms, 
+  schedulerJobCallback_t callback, void* arg)
 {
-  if (_schedulerTimerSysInfo) {
-    if (esp_timer_is_active(_schedulerTimerSysInfo)) {
-      if (esp_timer_stop(_schedulerTimerSysInfo) == ESP_OK) {
-        rlog_i(logTAG, "Timer [scheduler_sysinfo] was stopped");
-      };
+  if (!callback || (interval_ms == 0)) return SCHEDULER_JOB_INVALID;
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_JOBS_MAX; i++) {
+    schedulerJob_t* job = &_schedulerJobs[i];
+    uint8_t expected = SCHEDULER_JOB_FREE;
+    if (__atomic_compare_exchange_n(&job->state, &expected, SCHEDULER_JOB_RESERVED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      job->name = name;
+      job->callback = callback;
+      job->arg = arg;
+      job->interval_us = (int64_t)interval_ms * 1000;
+      job->slack_us = (int64_t)(slack_ms < interval_ms ? slack_ms : interval_ms) * 1000;
+      job->phase_us = phase_ms < 0 ? -1 : ((int64_t)phase_ms * 1000) % job->interval_us;
+      __atomic_store_n(&job->state, SCHEDULER_JOB_NEW, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&_schedulerJobsStats.jobs, 1, __ATOMIC_RELAXED);
+      rlog_i(logTAG, "Job [%s] registered: every %d ms", name ? name : "", interval_ms);
+      schedulerJobsWakeup();
+      return i + 1;
     };
-    return true;
   };
-  return false;
+  rlog_e(logTAG, "Too many periodic jobs");
+  return SCHEDULER_JOB_INVALID;
 }
 
-static void schedulerTimerSysInfoDelete()
+// The callback of the job may still be running when the function returns
+bool schedulerJobUnregister(schedulerJobHandle_t handle)
 {
-  if (_schedulerTimerSysInfo) {
-    if (esp_timer_is_active(_schedulerTimerSysInfo)) {
-      esp_timer_stop(_schedulerTimerSysInfo);
+  if ((handle == SCHEDULER_JOB_INVALID) || (handle > CONFIG_SCHEDULER_JOBS_MAX)) return false;
+  schedulerJob_t* job = &_schedulerJobs[handle - 1];
+  uint8_t state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+  while ((state == SCHEDULER_JOB_NEW) || (state == SCHEDULER_JOB_ACTIVE)) {
+    if (__atomic_compare_exchange_n(&job->state, &state, SCHEDULER_JOB_FREE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      __atomic_sub_fetch(&_schedulerJobsStats.jobs, 1, __ATOMIC_RELAXED);
+      rlog_i(logTAG, "Job [%s] unregistered", job->name ? job->name : "");
+      return true;
     };
-    RE_OK_CHECK(esp_timer_delete(_schedulerTimerSysInfo), return);
-    _schedulerTimerSysInfo = nullptr;
-    rlog_i(logTAG, "Timer [scheduler_sysinfo] was deleted");
   };
+  return false;
 }
 
-#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-
-// -----------------------------------------------------------------------------------------------------------------------
-// ---------------------------------------------------- TaskList Timer ---------------------------------------------------
-// -----------------------------------------------------------------------------------------------------------------------
-
-#if CONFIG_MQTT_TASKLIST_ENABLE
+void schedulerJobsStats(schedulerJobsStats_t* stats)
+{
+  if (stats) {
+    *stats = _schedulerJobsStats;
+  };
+}
 
-static void schedulerTimerTasksExec(void* arg)
+// Active jobs get their first deadline again: all of them or only those aligned to the wall clock
+static void schedulerJobsRestart(bool aligned)
 {
-  sysinfoPublishTaskList();
+  for (uint32_t i = 0; i < CONFIG_SCHEDULER_JOBS_MAX; i++) {
+    schedulerJob_t* job = &_schedulerJobs[i];
+    uint8_t expected = SCHEDULER_JOB_ACTIVE;
+    if (__atomic_load_n(&job->state, __ATOMIC_ACQUIRE) != expected) continue;
+    if (aligned && (job->phase_us < 0)) continue;
+    __atomic_compare_exchange_n(&job->state, &expected, SCHEDULER_JOB_NEW, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+  };
 }
 
-static bool schedulerTimerTasksStart()
+// Only a real suspend resets the deadlines: they are counted again from now
+static bool schedulerJobsStart()
 {
-  if (_schedulerTimerTasks) {
-    if (esp_timer_is_active(_schedulerTimerTasks)) {
-      esp_timer_stop(_schedulerTimerTasks);
+  if (_schedulerTimerJobs) {
+    if (_schedulerJobsSuspended) {
+      schedulerJobsRestart(false);
+      _schedulerJobsSuspended = false;
+      schedulerJobsWakeup();
+      rlog_i(logTAG, "Timer [scheduler_jobs] was started");
     };
-    RE_OK_CHECK(esp_timer_start_periodic(_schedulerTimerTasks, CONFIG_MQTT_TASKLIST_INTERVAL * 1000), return false);
-    rlog_i(logTAG, "Timer [scheduler_tasks] was started");
     return true;
   };
   return false;
 }
 
-static bool schedulerTimerTasksCreate(bool createSuspened)
+// The wall clock has been set or corrected: jobs aligned to it follow the new time, the others keep their monotonic deadlines
+static void schedulerJobsRealign()
+{
+  if (_schedulerTimerJobs && !_schedulerJobsSuspended) {
+    schedulerJobsRestart(true);
+    schedulerJobsWakeup();
+  };
+}
+
+static bool schedulerJobsStop()
 {
-  if (!_schedulerTimerTasks) {
-    esp_timer_create_args_t cfgTimer;
-    memset(&cfgTimer, 0, sizeof(cfgTimer));
-    cfgTimer.name = "scheduler_tasks";
-    cfgTimer.callback = schedulerTimerTasksExec;
-    RE_OK_CHECK(esp_timer_create(&cfgTimer, &_schedulerTimerTasks), return false);
-    if (!createSuspened) {
-      return schedulerTimerTasksStart();
+  if (_schedulerTimerJobs) {
+    _schedulerJobsSuspended = true;
+    if (schedPortTimerIsActive(_schedulerTimerJobs)) {
+      if (schedPortTimerStop(_schedulerTimerJobs) == ESP_OK) {
+        rlog_i(logTAG, "Timer [scheduler_jobs] was stopped");
+      };
     };
     return true;
   };
   return false;
 }
 
-static bool schedulerTimerTasksStop()
+#if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+
+static void schedulerJobSysInfoExec(void* arg)
 {
-  if (_schedulerTimerTasks) {
-    if (esp_timer_is_active(_schedulerTimerTasks)) {
-      if (esp_timer_stop(_schedulerTimerTasks) == ESP_OK) {
-        rlog_i(logTAG, "Timer [scheduler_tasks] was stopped");
-      };
-    };
+  sysinfoPublishSysInfo();
+  #if CONFIG_SCHEDULER_STATS && CONFIG_SCHEDULER_STATS_PUBLISH
+    schedulerStats_t stats;
+    schedulerStats(&stats);
+    schedulerEventPost(RE_TIME_SCHEDULER_STATS, &stats, sizeof(stats), TIME_EVENTS_POST_TIMEOUT);
+  #endif // CONFIG_SCHEDULER_STATS && CONFIG_SCHEDULER_STATS_PUBLISH
+}
+
+#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+
+#if CONFIG_MQTT_TASKLIST_ENABLE
+
+static void schedulerJobTasksExec(void* arg)
+{
+  sysinfoPublishTaskList();
+}
+
+#endif // CONFIG_MQTT_TASKLIST_ENABLE
+
+static bool schedulerJobsCreate(bool createSuspened)
+{
+  if (!_schedulerTimerJobs) {
+    _schedulerJobsSuspended = createSuspened;
+    RE_OK_CHECK(schedPortTimerCreate("scheduler_jobs", schedulerJobsExec, &_schedulerTimerJobs), return false);
+    #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+      _schedulerJobSysInfo = schedulerJobRegister("sysinfo", CONFIG_MQTT_SYSINFO_INTERVAL, 
+        CONFIG_MQTT_SYSINFO_INTERVAL / SCHEDULER_JOBS_SLACK_DIVIDER, SCHEDULER_JOBS_BUILTIN_PHASE, schedulerJobSysInfoExec, nullptr);
+      if (_schedulerJobSysInfo == SCHEDULER_JOB_INVALID) return false;
+    #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+    #if CONFIG_MQTT_TASKLIST_ENABLE
+      _schedulerJobTasks = schedulerJobRegister("tasklist", CONFIG_MQTT_TASKLIST_INTERVAL, 
+        CONFIG_MQTT_TASKLIST_INTERVAL / SCHEDULER_JOBS_SLACK_DIVIDER, SCHEDULER_JOBS_BUILTIN_PHASE, schedulerJobTasksExec, nullptr);
+      if (_schedulerJobTasks == SCHEDULER_JOB_INVALID) return false;
+    #endif // CONFIG_MQTT_TASKLIST_ENABLE
+    // Jobs registered before the start are picked up by the first call
+    schedulerJobsWakeup();
     return true;
   };
   return false;
 }
 
-static void schedulerTimerTasksDelete()
+// Jobs registered by the application remain registered
+static void schedulerJobsDelete()
 {
-  if (_schedulerTimerTasks) {
-    if (esp_timer_is_active(_schedulerTimerTasks)) {
-      esp_timer_stop(_schedulerTimerTasks);
+  #if CONFIG_MQTT_TASKLIST_ENABLE
+    schedulerJobUnregister(_schedulerJobTasks);
+    _schedulerJobTasks = SCHEDULER_JOB_INVALID;
+  #endif // CONFIG_MQTT_TASKLIST_ENABLE
+  #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+    schedulerJobUnregister(_schedulerJobSysInfo);
+    _schedulerJobSysInfo = SCHEDULER_JOB_INVALID;
+  #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+  if (_schedulerTimerJobs) {
+    if (schedPortTimerIsActive(_schedulerTimerJobs)) {
+      schedPortTimerStop(_schedulerTimerJobs);
     };
-    RE_OK_CHECK(esp_timer_delete(_schedulerTimerTasks), return);
-    _schedulerTimerTasks = nullptr;
-    rlog_i(logTAG, "Timer [scheduler_tasks] was deleted");
+    RE_OK_CHECK(schedPortTimerDelete(_schedulerTimerJobs), return);
+    _schedulerTimerJobs = nullptr;
+    rlog_i(logTAG, "Timer [scheduler_jobs] was deleted");
   };
 }
 
-#endif // CONFIG_MQTT_TASKLIST_ENABLE
-
 // -----------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------- Еvent handlers ---------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
 static void schedulerEventHandlerTime(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
+  // The clock has been set: all transition times must be recalculated
+  #if CONFIG_SCHEDULER_CALENDAR
+    _schedulerCalendarAnchored = false;
+  #endif // CONFIG_SCHEDULER_CALENDAR
+  schedulerQueueInvalidate();
   if (_schedulerTimerMain) {
+    schedulerJobsRealign();
     schedulerResume();
   } else {
     schedulerStart(false);
@@ -415,6 +3934,10 @@ static void schedulerOtaEventHandler(void* arg, esp_event_base_t event_base, int
   if ((event_id == RE_SYS_OTA) && (event_data)) {
     re_system_event_data_t* data = (re_system_event_data_t*)event_data;
     if (data->type == RE_SYS_SET) {
+      #if CONFIG_SCHEDULER_WARMSTART
+        // The device will be restarted after the update: the states are written before the handler returns
+        schedulerWarmStartSave();
+      #endif // CONFIG_SCHEDULER_WARMSTART
       schedulerSuspend();
     } else {
       schedulerResume();
@@ -422,34 +3945,45 @@ static void schedulerOtaEventHandler(void* arg, esp_event_base_t event_base, int
   };
 }
 
-#if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+#if CONFIG_SCHEDULER_WARMSTART
+
+static void schedulerEventHandlerWarmStart(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+  schedulerWarmWrite();
+}
+
+#endif // CONFIG_SCHEDULER_WARMSTART
 
 static void schedulerEventHandlerParams(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
   if (event_id == RE_PARAMS_CHANGED)  {
-    #if defined(CONFIG_SILENT_MODE_EXTENDED) && CONFIG_SILENT_MODE_EXTENDED
-      if ((*(uint32_t*)event_data == (uint32_t)&tsSilentModeTimespan) 
-      || (*(uint32_t*)event_data == (uint32_t)&enabledSilentMode)) {
-    #else
-      if (*(uint32_t*)event_data == (uint32_t)&tsSilentModeTimespan) {
-    #endif // CONFIG_SILENT_MODE_EXTENDED
-      silentModeCheckExternal();
+    // Registered timespans could have been changed: transition times must be recalculated
+    schedulerQueueInvalidate();
+    // Timespans and switches of modes take effect immediately
+    if (event_data && schedulerModesParameter(*(uint32_t*)event_data)) {
+      schedulerModesCheckRequest();
     };
+    // New location: solar schedules are recalculated on the next tick
+    #if CONFIG_SCHEDULER_SOLAR
+      if (event_data && schedulerSolarParameter(*(uint32_t*)event_data)) {
+        schedulerSolarInvalidate();
+      };
+    #endif // CONFIG_SCHEDULER_SOLAR
   };
 }
 
-#endif // defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
-
 bool schedulerEventHandlerRegister()
 {
   rlog_d(logTAG, "Register scheduler event handlers...");
   if (!_handlersRegistered) {
     _handlersRegistered = eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_RTC_ENABLED, &schedulerEventHandlerTime, nullptr)
             && eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_SNTP_SYNC_OK, &schedulerEventHandlerTime, nullptr)
-            && eventHandlerRegister(RE_SYSTEM_EVENTS, RE_SYS_OTA, &schedulerOtaEventHandler, nullptr);
-    #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
-      _handlersRegistered = _handlersRegistered && eventHandlerRegister(RE_PARAMS_EVENTS, RE_PARAMS_CHANGED, &schedulerEventHandlerParams, nullptr);
-    #endif // defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+            && eventHandlerRegister(RE_SYSTEM_EVENTS, RE_SYS_OTA, &schedulerOtaEventHandler, nullptr)
+            && eventHandlerRegister(RE_PARAMS_EVENTS, RE_PARAMS_CHANGED, &schedulerEventHandlerParams, nullptr);
+    #if CONFIG_SCHEDULER_WARMSTART
+      _handlersRegistered = _handlersRegistered
+        && eventHandlerRegister(RE_TIME_EVENTS, RE_TIME_WARMSTART_SAVE, &schedulerEventHandlerWarmStart, nullptr);
+    #endif // CONFIG_SCHEDULER_WARMSTART
     #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
       _handlersRegistered = _handlersRegistered && sysinfoEventHandlerRegister();
     #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
@@ -463,9 +3997,11 @@ void schedulerEventHandlerUnregister()
     _handlersRegistered = false;
     eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_RTC_ENABLED, &schedulerEventHandlerTime);
     eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_SNTP_SYNC_OK, &schedulerEventHandlerTime);
-    #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
-      eventHandlerUnregister(RE_PARAMS_EVENTS, RE_PARAMS_CHANGED, &schedulerEventHandlerParams);
-    #endif // defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
+    eventHandlerUnregister(RE_SYSTEM_EVENTS, RE_SYS_OTA, &schedulerOtaEventHandler);
+    eventHandlerUnregister(RE_PARAMS_EVENTS, RE_PARAMS_CHANGED, &schedulerEventHandlerParams);
+    #if CONFIG_SCHEDULER_WARMSTART
+      eventHandlerUnregister(RE_TIME_EVENTS, RE_TIME_WARMSTART_SAVE, &schedulerEventHandlerWarmStart);
+    #endif // CONFIG_SCHEDULER_WARMSTART
     #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
       sysinfoEventHandlerUnregister();
     #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
@@ -480,16 +4016,23 @@ bool schedulerStart(bool createSuspended)
 {
   bool ret = false;
   if (!_schedulerTimerMain) {
+    #if CONFIG_SCHEDULER_WARMSTART
+      schedulerWarmLoad();
+    #endif // CONFIG_SCHEDULER_WARMSTART
     ret = schedulerInit() && schedulerTimerMainCreate() && schedulerEventHandlerRegister();
     #if defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
       silentModeRegister();
     #endif // defined(CONFIG_SILENT_MODE_ENABLE) && CONFIG_SILENT_MODE_ENABLE
-    #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-      ret = ret && schedulerTimerSysInfoCreate(createSuspended);
-    #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    #if CONFIG_MQTT_TASKLIST_ENABLE
-      ret = ret && schedulerTimerTasksCreate(createSuspended);
-    #endif // CONFIG_MQTT_TASKLIST_ENABLE
+    #if CONFIG_SCHEDULER_SOLAR
+      schedulerSolarRegisterParams();
+    #endif // CONFIG_SCHEDULER_SOLAR
+    #if CONFIG_SCHEDULER_SPREAD
+      ret = ret && schedulerSpreadCreate();
+    #endif // CONFIG_SCHEDULER_SPREAD
+    #if CONFIG_SCHEDULER_SHARDS > 1
+      ret = ret && schedulerShardsCreate();
+    #endif // CONFIG_SCHEDULER_SHARDS
+    ret = ret && schedulerJobsCreate(createSuspended);
   };
   if (!ret) {
     schedulerDelete();
@@ -497,40 +4040,28 @@ bool schedulerStart(bool createSuspended)
   return ret;
 }
 
+// Periodic jobs are suspended, schedules keep working
 bool schedulerSuspend()
 {
-  bool ret = true;
-  #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    ret = ret && schedulerTimerSysInfoStop();
-  #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    #if CONFIG_MQTT_TASKLIST_ENABLE
-      ret = ret && schedulerTimerTasksStop();
-    #endif // CONFIG_MQTT_TASKLIST_ENABLE
-  return ret;
+  return schedulerJobsStop();
 }
 
 bool schedulerResume()
 {
-  bool ret = true;
-  #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    ret = ret && schedulerTimerSysInfoStart();
-  #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    #if CONFIG_MQTT_TASKLIST_ENABLE
-      ret = ret && schedulerTimerTasksStart();
-    #endif // CONFIG_MQTT_TASKLIST_ENABLE
-  return ret;
+  return schedulerJobsStart();
 }
 
 void schedulerDelete()
 {
-  #if CONFIG_MQTT_TASKLIST_ENABLE
-    schedulerTimerTasksDelete();
-  #endif // CONFIG_MQTT_TASKLIST_ENABLE
-  #if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
-    schedulerTimerSysInfoDelete();
-  #endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+  schedulerJobsDelete();
+  #if CONFIG_SCHEDULER_SPREAD
+    schedulerSpreadDelete();
+  #endif // CONFIG_SCHEDULER_SPREAD
   schedulerEventHandlerUnregister();
   schedulerTimerMainDelete();
+  #if CONFIG_SCHEDULER_SHARDS > 1
+    schedulerShardsDelete();
+  #endif // CONFIG_SCHEDULER_SHARDS
   schedulerFree();
 }
 
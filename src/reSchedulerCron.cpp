@@ -0,0 +1,280 @@
+/*
+   EN: Cron-style schedules: "minute hour day-of-month month day-of-week" compiled into bitmasks
+   RU: Расписания в стиле cron: "минута час день-месяца месяц день-недели", преобразованные в битовые маски
+   --------------------------
+   (с) 2021 Разживин Александр | Razzhivin Alexander
+   kotyara12@yandex.ru | https://kotyara12.ru | tg: @kotyara1971
+*/
+
+#include <ctype.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#define SCHEDULER_CRON_SEARCH_DAYS  (4 * 366 + 1)  // Long enough for February 29
+
+static const char* logTAG = "CRON";
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Parser -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static bool schedulerCronNumber(const char** ptr, uint32_t* value)
+{
+  if (!isdigit((unsigned char)**ptr)) return false;
+  *value = 0;
+  while (isdigit((unsigned char)**ptr)) {
+    *value = *value * 10 + (**ptr - '0');
+    if (*value > 1000) return false;
+    (*ptr)++;
+  };
+  return true;
+}
+
+// One field: list of "*", "N", "N-M", each optionally with "/step"; "?" is the same as "*"
+static bool schedulerCronField(const char** ptr, uint32_t min, uint32_t max, uint64_t* mask, bool* any)
+{
+  *mask = 0;
+  *any = false;
+  while (true) {
+    uint32_t from, to, step = 1;
+    if ((**ptr == '*') || (**ptr == '?')) {
+      from = min;
+      to = max;
+      (*ptr)++;
+      if (**ptr != '/') *any = true;
+    } else {
+      if (!schedulerCronNumber(ptr, &from)) return false;
+      to = from;
+      if (**ptr == '-') {
+        (*ptr)++;
+        if (!schedulerCronNumber(ptr, &to)) return false;
+      };
+    };
+    if (**ptr == '/') {
+      (*ptr)++;
+      if (!schedulerCronNumber(ptr, &step) || (step == 0)) return false;
+      // "N/step" means from N to the end of the range
+      if (to == from) to = max;
+    };
+    if ((from < min) || (to > max) || (from > to)) return false;
+    for (uint32_t i = from; i <= to; i += step) {
+      *mask |= 1ULL << i;
+    };
+    if (**ptr != ',') break;
+    (*ptr)++;
+  };
+  return (**ptr == 0) || isspace((unsigned char)**ptr);
+}
+
+static void schedulerCronSkipSpaces(const char** ptr)
+{
+  while (isspace((unsigned char)**ptr)) {
+    (*ptr)++;
+  };
+}
+
+bool schedulerCronParse(const char* expression, schedulerCron_t* cron)
+{
+  if (!expression || !cron) return false;
+  memset(cron, 0, sizeof(schedulerCron_t));
+
+  const char* ptr = expression;
+  uint64_t mask;
+  bool any;
+  schedulerCronSkipSpaces(&ptr);
+  if (!schedulerCronField(&ptr, 0, 59, &mask, &any)) goto error;
+  cron->minutes = mask;
+  schedulerCronSkipSpaces(&ptr);
+  if (!schedulerCronField(&ptr, 0, 23, &mask, &any)) goto error;
+  cron->hours = (uint32_t)mask;
+  schedulerCronSkipSpaces(&ptr);
+  if (!schedulerCronField(&ptr, 1, 31, &mask, &any)) goto error;
+  cron->days = (uint32_t)mask;
+  if (any) cron->flags |= SCHEDULER_CRON_ANY_DAY;
+  schedulerCronSkipSpaces(&ptr);
+  if (!schedulerCronField(&ptr, 1, 12, &mask, &any)) goto error;
+  cron->months = (uint16_t)(mask >> 1);
+  schedulerCronSkipSpaces(&ptr);
+  if (!schedulerCronField(&ptr, 0, 7, &mask, &any)) goto error;
+  // Both 0 and 7 are Sunday
+  cron->weekdays = (uint8_t)((mask | (mask >> 7)) & 0x7F);
+  if (any) cron->flags |= SCHEDULER_CRON_ANY_WEEKDAY;
+  schedulerCronSkipSpaces(&ptr);
+  if (*ptr == 0) return true;
+
+error:
+  rlog_e(logTAG, "Invalid cron expression: \"%s\"", expression);
+  memset(cron, 0, sizeof(schedulerCron_t));
+  return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Matching ------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+// As in cron: if both the day of the month and the day of the week are restricted, either of them is enough
+static inline bool schedulerCronDayMatch(const schedulerCron_t* cron, int mday, int wday)
+{
+  bool dayMatch = (cron->days >> mday) & 1;
+  bool weekdayMatch = (cron->weekdays >> wday) & 1;
+  if (cron->flags & SCHEDULER_CRON_ANY_DAY) return weekdayMatch;
+  if (cron->flags & SCHEDULER_CRON_ANY_WEEKDAY) return dayMatch;
+  return dayMatch || weekdayMatch;
+}
+
+bool schedulerCronMatch(const schedulerCron_t* cron, struct tm* timeinfo)
+{
+  return cron
+    && ((cron->minutes >> timeinfo->tm_min) & 1)
+    && ((cron->hours >> timeinfo->tm_hour) & 1)
+    && ((cron->months >> timeinfo->tm_mon) & 1)
+    && schedulerCronDayMatch(cron, timeinfo->tm_mday, timeinfo->tm_wday);
+}
+
+static int schedulerCronDaysInMonth(int year, int mon)
+{
+  static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  if (mon == 1) {
+    int y = year + 1900;
+    return ((y % 4 == 0) && ((y % 100 != 0) || (y % 400 == 0))) ? 29 : 28;
+  };
+  return days[mon];
+}
+
+// Lowest set bit of the mask not less than from, or -1
+static inline int schedulerCronNextBit(uint64_t mask, int from)
+{
+  mask = from < 64 ? mask >> from : 0;
+  return mask ? from + __builtin_ctzll(mask) : -1;
+}
+
+// Local time of the clock (nullptr: the system one)
+static void schedulerCronLocal(const schedulerClock_t* clock, time_t time, struct tm* local)
+{
+  if (clock && clock->local_time) {
+    clock->local_time(&time, local);
+  } else {
+    localtime_r(&time, local);
+  };
+}
+
+// The local time fields counted as seconds since 1970 (as if the local time were UTC)
+static int64_t schedulerCronFields(const struct tm* local)
+{
+  int y = local->tm_year + 1900 - (local->tm_mon < 2);
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int mp = (local->tm_mon + 10) % 12;
+  int doy = (153 * mp + 2) / 5 + local->tm_mday - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = (int64_t)era * 146097 + doe - 719468;
+  return days * 86400 + local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec;
+}
+
+// UTC offset of the local time in seconds (tm_gmtoff is not available everywhere)
+static long schedulerCronOffset(time_t value, struct tm* local)
+{
+  return (long)(schedulerCronFields(local) - (int64_t)value);
+}
+
+// The search goes over local time fields: months, days and hours that do not match are skipped entirely,
+// minutes and hours are found by a bit scan. Local times are converted back with the offsets of the same clock
+// (mktime() would use the system time zone): first the expected one, then the one at the time it gives
+static time_t schedulerCronSearch(const schedulerCron_t* cron, const schedulerClock_t* clock, struct tm t, time_t after, long offset)
+{
+  t.tm_sec = 0;
+  t.tm_min++;
+  int days = 0;
+  while (days <= SCHEDULER_CRON_SEARCH_DAYS) {
+    bool nextDay = false;
+    if (!((cron->months >> t.tm_mon) & 1) || !schedulerCronDayMatch(cron, t.tm_mday, t.tm_wday)) {
+      nextDay = true;
+    } else {
+      int hour = schedulerCronNextBit(cron->hours, t.tm_hour);
+      if (hour < 0) {
+        nextDay = true;
+      } else {
+        if (hour != t.tm_hour) {
+          t.tm_hour = hour;
+          t.tm_min = 0;
+        };
+        int minute = schedulerCronNextBit(cron->minutes, t.tm_min);
+        if (minute < 0) {
+          t.tm_hour++;
+          t.tm_min = 0;
+          if (t.tm_hour > 23) nextDay = true;
+        } else {
+          t.tm_min = minute;
+          // The local time may occur twice when DST ends (the earliest one after "after" is taken) or not at all
+          // when it begins (neither offset gives it back)
+          int64_t fields = schedulerCronFields(&t);
+          time_t best = 0;
+          long tried = offset;
+          for (int pass = 0; pass < 2; pass++) {
+            struct tm found;
+            time_t ret = (time_t)(fields - tried);
+            schedulerCronLocal(clock, ret, &found);
+            if ((ret > after) && (found.tm_mday == t.tm_mday) && (found.tm_hour == t.tm_hour) && (found.tm_min == t.tm_min)
+             && ((best == 0) || (ret < best))) {
+              best = ret;
+            };
+            long next = schedulerCronOffset(ret, &found);
+            if (next == tried) break;
+            tried = next;
+          };
+          if (best > 0) {
+            return best;
+          };
+          t.tm_min++;
+          if (t.tm_min > 59) {
+            t.tm_hour++;
+            t.tm_min = 0;
+            if (t.tm_hour > 23) nextDay = true;
+          };
+        };
+      };
+    };
+    if (nextDay) {
+      days++;
+      t.tm_hour = 0;
+      t.tm_min = 0;
+      t.tm_wday = (t.tm_wday + 1) % 7;
+      if (++t.tm_mday > schedulerCronDaysInMonth(t.tm_year, t.tm_mon)) {
+        t.tm_mday = 1;
+        if (++t.tm_mon > 11) {
+          t.tm_mon = 0;
+          t.tm_year++;
+        };
+      };
+    };
+  };
+  return 0;
+}
+
+time_t schedulerCronNextClock(const schedulerCron_t* cron, time_t after, const schedulerClock_t* clock)
+{
+  if (!cron || !cron->minutes || !cron->hours || !cron->months || (!cron->days && !cron->weekdays)) {
+    return 0;
+  };
+
+  struct tm t;
+  schedulerCronLocal(clock, after, &t);
+  long offsetAfter = schedulerCronOffset(after, &t);
+  time_t ret = schedulerCronSearch(cron, clock, t, after, offsetAfter);
+  if (ret > 0) {
+    // When DST ends, the local time goes back and the repeated hour is not seen by the first pass:
+    // repeat the search from the local time that "after" has in the new offset
+    struct tm found;
+    schedulerCronLocal(clock, ret, &found);
+    long offsetFound = schedulerCronOffset(ret, &found);
+    if (offsetFound < offsetAfter) {
+      time_t shifted = after + offsetFound;
+      gmtime_r(&shifted, &t);
+      time_t repeated = schedulerCronSearch(cron, clock, t, after, offsetFound);
+      if ((repeated > 0) && (repeated < ret)) {
+        ret = repeated;
+      };
+    };
+  };
+  return ret;
+}
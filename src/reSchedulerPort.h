@@ -0,0 +1,393 @@
+/*
+   EN: Platform abstraction layer of the scheduler: ESP-IDF (target) and POSIX / Linux (host)
+   RU: Слой абстракции платформы для планировщика: ESP-IDF (устройство) и POSIX / Linux (хост)
+   --------------------------
+   (с) 2021 Разживин Александр | Razzhivin Alexander
+   kotyara12@yandex.ru | https://kotyara12.ru | tg: @kotyara1971
+*/
+
+#ifndef __RE_SCHEDULER_PORT_H__
+#define __RE_SCHEDULER_PORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include "rLog.h"
+#include "rTypes.h"
+#include "project_config.h"
+#include "def_consts.h"
+
+#if defined(ESP_PLATFORM)
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- ESP-IDF -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#include "reEvents.h"
+#include "reNvs.h"
+#include "reEsp32.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "reParams.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_attr.h"
+#if CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+#include "reSysInfo.h"
+#endif // CONFIG_MQTT_STATUS_ONLINE || CONFIG_MQTT_SYSINFO_ENABLE
+
+typedef esp_timer_handle_t schedPortTimer_t;
+
+static inline esp_err_t schedPortTimerCreate(const char* name, esp_timer_cb_t callback, schedPortTimer_t* timer)
+{
+  esp_timer_create_args_t cfgTimer;
+  memset(&cfgTimer, 0, sizeof(cfgTimer));
+  cfgTimer.name = name;
+  cfgTimer.callback = callback;
+  return esp_timer_create(&cfgTimer, timer);
+}
+
+static inline esp_err_t schedPortTimerStartOnce(schedPortTimer_t timer, uint64_t timeout_us)
+{
+  return esp_timer_start_once(timer, timeout_us);
+}
+
+static inline esp_err_t schedPortTimerStartPeriodic(schedPortTimer_t timer, uint64_t period_us)
+{
+  return esp_timer_start_periodic(timer, period_us);
+}
+
+static inline esp_err_t schedPortTimerStop(schedPortTimer_t timer)
+{
+  return esp_timer_stop(timer);
+}
+
+static inline esp_err_t schedPortTimerDelete(schedPortTimer_t timer)
+{
+  return esp_timer_delete(timer);
+}
+
+static inline bool schedPortTimerIsActive(schedPortTimer_t timer)
+{
+  return esp_timer_is_active(timer);
+}
+
+// Monotonic time since boot, in microseconds
+static inline int64_t schedPortMonotonicUs()
+{
+  return esp_timer_get_time();
+}
+
+// Wall clock time
+static inline void schedPortWallTime(struct timeval* now)
+{
+  gettimeofday(now, nullptr);
+}
+
+// Tasks
+typedef TaskHandle_t schedPortTask_t;
+
+static inline esp_err_t schedPortTaskCreate(const char* name, TaskFunction_t function, uint32_t stack_size, uint32_t priority, int core, schedPortTask_t* task)
+{
+  return xTaskCreatePinnedToCore(function, name, stack_size, nullptr, priority, task, core < 0 ? tskNO_AFFINITY : core) == pdPASS ? ESP_OK : ESP_FAIL;
+}
+
+static inline void schedPortTaskExit()
+{
+  vTaskDelete(nullptr);
+}
+
+static inline void schedPortTaskNotify(schedPortTask_t task)
+{
+  xTaskNotifyGive(task);
+}
+
+static inline void schedPortTaskWait()
+{
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static inline void schedPortDelayMs(uint32_t ms)
+{
+  vTaskDelay(pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1);
+}
+
+#define SCHED_PORT_CORES portNUM_PROCESSORS
+
+// Mutexes (never taken by the timer)
+typedef SemaphoreHandle_t schedPortMutex_t;
+
+static inline schedPortMutex_t schedPortMutexCreate()
+{
+  return xSemaphoreCreateMutex();
+}
+
+static inline void schedPortMutexLock(schedPortMutex_t mutex)
+{
+  xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+static inline void schedPortMutexUnlock(schedPortMutex_t mutex)
+{
+  xSemaphoreGive(mutex);
+}
+
+static inline void schedPortMutexDelete(schedPortMutex_t mutex)
+{
+  vSemaphoreDelete(mutex);
+}
+
+// Event groups (24 bits); bits are cleared before others are set, so that a bit and its opposite are never set together
+typedef EventGroupHandle_t schedPortEvents_t;
+#define SCHED_PORT_EVENTS_BITS 24
+
+static inline schedPortEvents_t schedPortEventsCreate()
+{
+  return xEventGroupCreate();
+}
+
+static inline void schedPortEventsUpdate(schedPortEvents_t events, uint32_t set, uint32_t clear)
+{
+  xEventGroupClearBits(events, clear);
+  xEventGroupSetBits(events, set);
+}
+
+// Wait until any of the bits is set (timeout_ms == UINT32_MAX: forever), returns those of them that are set
+static inline uint32_t schedPortEventsWait(schedPortEvents_t events, uint32_t bits, uint32_t timeout_ms)
+{
+  TickType_t ticks = timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+  return xEventGroupWaitBits(events, bits, pdFALSE, pdFALSE, ticks) & bits;
+}
+
+// Functions that may be called from interrupts
+#define SCHED_PORT_IRAM IRAM_ATTR
+
+// Identifier of the device: hash of the MAC address
+static inline uint32_t schedPortDeviceId()
+{
+  uint8_t mac[6] = { 0 };
+  esp_read_mac(mac, ESP_MAC_WIFI_STA);
+  uint32_t id = 2166136261UL;
+  for (uint32_t i = 0; i < sizeof(mac); i++) {
+    id = (id ^ mac[i]) * 16777619UL;
+  };
+  return id;
+}
+
+// Persistent storage of small blobs (NVS); with data == nullptr only the size is read
+#define SCHED_PORT_STORE_GROUP "scheduler"
+
+static inline bool schedPortStoreRead(const char* key, void* data, size_t* size)
+{
+  nvs_handle_t nvs;
+  if (!nvsOpen(SCHED_PORT_STORE_GROUP, NVS_READONLY, &nvs)) return false;
+  bool ret = nvs_get_blob(nvs, key, data, size) == ESP_OK;
+  nvs_close(nvs);
+  return ret;
+}
+
+static inline bool schedPortStoreWrite(const char* key, const void* data, size_t size)
+{
+  nvs_handle_t nvs;
+  if (!nvsOpen(SCHED_PORT_STORE_GROUP, NVS_READWRITE, &nvs)) return false;
+  bool ret = (nvs_set_blob(nvs, key, data, size) == ESP_OK) && (nvs_commit(nvs) == ESP_OK);
+  nvs_close(nvs);
+  return ret;
+}
+
+#else
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- POSIX / Linux ----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <sys/queue.h>
+
+#ifndef STAILQ_FOREACH_SAFE
+#define STAILQ_FOREACH_SAFE(var, head, field, tvar) \
+  for ((var) = STAILQ_FIRST((head)); (var) && ((tvar) = STAILQ_NEXT((var), field), 1); (var) = (tvar))
+#endif // STAILQ_FOREACH_SAFE
+
+typedef int esp_err_t;
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NO_MEM              0x101
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_STATE       0x103
+
+#ifndef RE_MEM_CHECK
+#define RE_MEM_CHECK(a, action) if (!(a)) { \
+  rlog_e(logTAG, "Failed to allocate memory in %s:%d", __FUNCTION__, __LINE__); \
+  action; \
+}
+#endif // RE_MEM_CHECK
+
+#ifndef RE_OK_CHECK
+#define RE_OK_CHECK(a, action) if ((a) != ESP_OK) { \
+  rlog_e(logTAG, "Error %d in %s:%d", (int)(a), __FUNCTION__, __LINE__); \
+  action; \
+}
+#endif // RE_OK_CHECK
+
+// FreeRTOS
+typedef uint32_t TickType_t;
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(ms))
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+
+// reEvents: in-process event queue
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
+#define ESP_EVENT_ANY_ID            -1
+
+extern esp_event_base_t RE_TIME_EVENTS;
+extern esp_event_base_t RE_SYSTEM_EVENTS;
+extern esp_event_base_t RE_PARAMS_EVENTS;
+
+typedef enum {
+  RE_TIME_RTC_ENABLED = 0,
+  RE_TIME_SNTP_SYNC_OK,
+  RE_TIME_EVERY_MINUTE,
+  RE_TIME_START_OF_HOUR,
+  RE_TIME_START_OF_DAY,
+  RE_TIME_START_OF_WEEK,
+  RE_TIME_START_OF_MONTH,
+  RE_TIME_START_OF_YEAR,
+  RE_TIME_TIMESPAN_ON,
+  RE_TIME_TIMESPAN_OFF,
+  RE_TIME_SILENT_MODE_ON,
+  RE_TIME_SILENT_MODE_OFF
+} re_time_event_id_t;
+
+typedef enum {
+  RE_SYS_OTA = 0
+} re_system_event_id_t;
+
+typedef enum {
+  RE_SYS_CLEAR = 0,
+  RE_SYS_SET
+} re_system_event_type_t;
+
+typedef struct {
+  re_system_event_type_t type;
+  bool forced;
+} re_system_event_data_t;
+
+typedef enum {
+  RE_PARAMS_CHANGED = 0
+} re_params_event_id_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool eventLoopPost(esp_event_base_t event_base, int32_t event_id, void* event_data, size_t event_data_size, TickType_t ticks_to_wait);
+bool eventHandlerRegister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void* event_handler_arg);
+void eventHandlerUnregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler);
+
+// reEsp32: allocations are counted
+void* esp_calloc(size_t count, size_t size);
+
+// Timers, executed by the timer thread (or by schedulerPortAdvance() in simulation mode)
+typedef void (*schedPortTimerCb_t)(void* arg);
+typedef struct schedPortTimer_s* schedPortTimer_t;
+
+esp_err_t schedPortTimerCreate(const char* name, schedPortTimerCb_t callback, schedPortTimer_t* timer);
+esp_err_t schedPortTimerStartOnce(schedPortTimer_t timer, uint64_t timeout_us);
+esp_err_t schedPortTimerStartPeriodic(schedPortTimer_t timer, uint64_t period_us);
+esp_err_t schedPortTimerStop(schedPortTimer_t timer);
+esp_err_t schedPortTimerDelete(schedPortTimer_t timer);
+bool schedPortTimerIsActive(schedPortTimer_t timer);
+
+// Clocks (real or simulated)
+int64_t schedPortMonotonicUs();
+void schedPortWallTime(struct timeval* now);
+
+// Tasks are executed by threads (the core and priority are ignored); in simulation mode schedulerPortAdvance() waits
+// after each timer until all of them wait for a notification
+typedef void (*schedPortTaskFunc_t)(void* arg);
+typedef struct schedPortTask_s* schedPortTask_t;
+
+esp_err_t schedPortTaskCreate(const char* name, schedPortTaskFunc_t function, uint32_t stack_size, uint32_t priority, int core, schedPortTask_t* task);
+void schedPortTaskExit();
+void schedPortTaskNotify(schedPortTask_t task);
+void schedPortTaskWait();
+void schedPortDelayMs(uint32_t ms);
+
+#define SCHED_PORT_CORES 2
+
+// Mutexes (never taken by the timer)
+typedef struct schedPortMutex_s* schedPortMutex_t;
+
+schedPortMutex_t schedPortMutexCreate();
+void schedPortMutexLock(schedPortMutex_t mutex);
+void schedPortMutexUnlock(schedPortMutex_t mutex);
+void schedPortMutexDelete(schedPortMutex_t mutex);
+
+// Event groups
+typedef struct schedPortEvents_s* schedPortEvents_t;
+#define SCHED_PORT_EVENTS_BITS 24
+
+schedPortEvents_t schedPortEventsCreate();
+void schedPortEventsUpdate(schedPortEvents_t events, uint32_t set, uint32_t clear);
+uint32_t schedPortEventsWait(schedPortEvents_t events, uint32_t bits, uint32_t timeout_ms);
+
+#define SCHED_PORT_IRAM
+
+// Identifier of the device (gethostid() unless set by schedulerPortSetDeviceId())
+uint32_t schedPortDeviceId();
+
+// Persistent storage of small blobs (kept in memory while the process runs); with data == nullptr only the size is read
+bool schedPortStoreRead(const char* key, void* data, size_t* size);
+bool schedPortStoreWrite(const char* key, const void* data, size_t size);
+
+// Control of the host environment
+typedef struct {
+  uint32_t allocs;          // Calls of esp_calloc()
+  uint32_t posts;           // Events posted
+  uint32_t post_failures;   // Events rejected because the queue was full
+  uint32_t timer_waits;     // Events posted by timer callbacks with a timeout (they could block the timer task)
+  uint32_t timer_fires;     // Timer callbacks executed
+  uint32_t store_writes;    // Blobs written to the persistent storage
+  uint32_t store_writes_timer; // ... of them by timer callbacks
+} schedulerPortStats_t;
+
+bool schedulerPortStart(bool simulate);
+void schedulerPortStop();
+void schedulerPortSetTime(time_t wall_time);
+void schedulerPortAdvance(int64_t delta_us);
+uint32_t schedulerPortDispatch();
+void schedulerPortStats(schedulerPortStats_t* stats);
+void schedulerPortStatsReset();
+void schedulerPortStoreClear();
+void schedulerPortSetDeviceId(uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+// reParams and reSysInfo are not available on the host
+typedef void* paramsGroupHandle_t;
+static inline paramsGroupHandle_t paramsRegisterGroup(paramsGroupHandle_t parent_group, const char* name_key, const char* name_topic, const char* name_friendly)
+  { return nullptr; }
+static inline void* paramsRegisterValue(param_kind_t type_param, param_type_t type_value, void* change_handler, paramsGroupHandle_t parent_group,
+  const char* name_key, const char* name_friendly, const int qos, void * value)
+  { return nullptr; }
+static inline void* paramsRegisterCommonValue(param_kind_t type_param, param_type_t type_value, void* change_handler,
+  const char* name_key, const char* name_friendly, const int qos, void * value)
+  { return nullptr; }
+static inline void sysinfoWorkTimeInc() {}
+static inline void sysinfoFixDateTime(struct tm* timeinfo) {}
+static inline void mqttPublishDateTime(struct tm* timeinfo) {}
+static inline void sysinfoPublishSysInfo() {}
+static inline void sysinfoPublishTaskList() {}
+static inline bool sysinfoEventHandlerRegister() { return true; }
+static inline void sysinfoEventHandlerUnregister() {}
+
+#endif // ESP_PLATFORM
+
+#endif // __RE_SCHEDULER_PORT_H__
@@ -0,0 +1,744 @@
+/*
+   EN: POSIX / Linux host backend of the scheduler: timer thread, in-process event queue and simulated wall clock
+   RU: Хостовая (POSIX / Linux) реализация для планировщика: поток таймеров, очередь событий и имитация часов
+   --------------------------
+   (с) 2021 Разживин Александр | Razzhivin Alexander
+   kotyara12@yandex.ru | https://kotyara12.ru | tg: @kotyara1971
+*/
+
+#if !defined(ESP_PLATFORM)
+
+#include <pthread.h>
+#include <unistd.h>
+#include "reSchedulerPort.h"
+
+#define PORT_EVENTS_QUEUE_SIZE    1024
+#define PORT_EVENTS_HANDLERS_MAX  64
+
+static const char* logTAG = "PORT";
+
+esp_event_base_t RE_TIME_EVENTS = "RE_TIME_EVENTS";
+esp_event_base_t RE_SYSTEM_EVENTS = "RE_SYSTEM_EVENTS";
+esp_event_base_t RE_PARAMS_EVENTS = "RE_PARAMS_EVENTS";
+
+struct schedPortTimer_s {
+  const char* name;
+  schedPortTimerCb_t callback;
+  bool active;
+  uint64_t period_us;
+  int64_t deadline_us;
+  schedPortTimer_s* next;
+};
+
+typedef struct {
+  esp_event_base_t base;
+  int32_t id;
+  void* data;
+} portEvent_t;
+
+typedef struct {
+  esp_event_base_t base;
+  int32_t id;
+  esp_event_handler_t handler;
+  void* arg;
+} portHandler_t;
+
+static pthread_mutex_t _portLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _portTimerCond;
+static pthread_cond_t _portEventsCond;
+static pthread_t _portTimerThread;
+static pthread_t _portEventsThread;
+static bool _portRunning = false;
+static bool _portSimulate = false;
+
+static schedPortTimer_s* _portTimers = nullptr;
+
+static int64_t _portSimMonotonic = 0;
+static int64_t _portWallBase = 0;
+static int64_t _portMonoBase = 0;
+
+static portEvent_t _portEvents[PORT_EVENTS_QUEUE_SIZE];
+static uint32_t _portEventsHead = 0;
+static uint32_t _portEventsCount = 0;
+static portHandler_t _portHandlers[PORT_EVENTS_HANDLERS_MAX];
+static uint32_t _portHandlersCount = 0;
+
+static schedulerPortStats_t _portStats = { 0, 0, 0, 0, 0, 0, 0 };
+static __thread bool _portInTimer = false;         // The thread is executing a timer callback
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Clocks -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+static int64_t portRealMonotonicUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t schedPortMonotonicUs()
+{
+  return _portSimulate ? __atomic_load_n(&_portSimMonotonic, __ATOMIC_ACQUIRE) : portRealMonotonicUs();
+}
+
+void schedPortWallTime(struct timeval* now)
+{
+  pthread_mutex_lock(&_portLock);
+  int64_t wall_us = _portWallBase + (schedPortMonotonicUs() - _portMonoBase);
+  pthread_mutex_unlock(&_portLock);
+  now->tv_sec = (time_t)(wall_us / 1000000);
+  now->tv_usec = (suseconds_t)(wall_us % 1000000);
+}
+
+void schedulerPortSetTime(time_t wall_time)
+{
+  pthread_mutex_lock(&_portLock);
+  _portWallBase = (int64_t)wall_time * 1000000;
+  _portMonoBase = schedPortMonotonicUs();
+  pthread_mutex_unlock(&_portLock);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Timers -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+esp_err_t schedPortTimerCreate(const char* name, schedPortTimerCb_t callback, schedPortTimer_t* timer)
+{
+  if (!callback || !timer) return ESP_ERR_INVALID_ARG;
+  schedPortTimer_s* tmr = (schedPortTimer_s*)calloc(1, sizeof(schedPortTimer_s));
+  if (!tmr) return ESP_ERR_NO_MEM;
+  tmr->name = name;
+  tmr->callback = callback;
+  pthread_mutex_lock(&_portLock);
+  tmr->next = _portTimers;
+  _portTimers = tmr;
+  pthread_mutex_unlock(&_portLock);
+  *timer = tmr;
+  return ESP_OK;
+}
+
+static esp_err_t portTimerStart(schedPortTimer_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+  if (!timer) return ESP_ERR_INVALID_ARG;
+  esp_err_t ret = ESP_OK;
+  pthread_mutex_lock(&_portLock);
+  if (timer->active) {
+    ret = ESP_ERR_INVALID_STATE;
+  } else {
+    timer->active = true;
+    timer->period_us = period_us;
+    timer->deadline_us = schedPortMonotonicUs() + timeout_us;
+    pthread_cond_signal(&_portTimerCond);
+  };
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+esp_err_t schedPortTimerStartOnce(schedPortTimer_t timer, uint64_t timeout_us)
+{
+  return portTimerStart(timer, timeout_us, 0);
+}
+
+esp_err_t schedPortTimerStartPeriodic(schedPortTimer_t timer, uint64_t period_us)
+{
+  return portTimerStart(timer, period_us, period_us);
+}
+
+esp_err_t schedPortTimerStop(schedPortTimer_t timer)
+{
+  if (!timer) return ESP_ERR_INVALID_ARG;
+  esp_err_t ret = ESP_OK;
+  pthread_mutex_lock(&_portLock);
+  if (timer->active) {
+    timer->active = false;
+  } else {
+    ret = ESP_ERR_INVALID_STATE;
+  };
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+esp_err_t schedPortTimerDelete(schedPortTimer_t timer)
+{
+  if (!timer) return ESP_ERR_INVALID_ARG;
+  pthread_mutex_lock(&_portLock);
+  if (timer->active) {
+    pthread_mutex_unlock(&_portLock);
+    return ESP_ERR_INVALID_STATE;
+  };
+  schedPortTimer_s** prev = &_portTimers;
+  while (*prev && (*prev != timer)) {
+    prev = &(*prev)->next;
+  };
+  if (*prev) {
+    *prev = timer->next;
+  };
+  pthread_mutex_unlock(&_portLock);
+  free(timer);
+  return ESP_OK;
+}
+
+bool schedPortTimerIsActive(schedPortTimer_t timer)
+{
+  pthread_mutex_lock(&_portLock);
+  bool ret = timer && timer->active;
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+// Earliest active timer whose deadline does not exceed limit_us (must be called under _portLock)
+static schedPortTimer_s* portTimerNext(int64_t limit_us)
+{
+  schedPortTimer_s* ret = nullptr;
+  for (schedPortTimer_s* tmr = _portTimers; tmr; tmr = tmr->next) {
+    if (tmr->active && (tmr->deadline_us <= limit_us) && (!ret || (tmr->deadline_us < ret->deadline_us))) {
+      ret = tmr;
+    };
+  };
+  return ret;
+}
+
+// Take the timer as fired and return its callback (must be called under _portLock)
+static schedPortTimerCb_t portTimerFire(schedPortTimer_s* tmr)
+{
+  if (tmr->period_us > 0) {
+    tmr->deadline_us += tmr->period_us;
+  } else {
+    tmr->active = false;
+  };
+  _portStats.timer_fires++;
+  return tmr->callback;
+}
+
+static void* portTimerThread(void* arg)
+{
+  pthread_mutex_lock(&_portLock);
+  while (_portRunning) {
+    schedPortTimer_s* tmr = portTimerNext(INT64_MAX);
+    if (!tmr) {
+      pthread_cond_wait(&_portTimerCond, &_portLock);
+    } else if (tmr->deadline_us > portRealMonotonicUs()) {
+      struct timespec ts;
+      ts.tv_sec = tmr->deadline_us / 1000000;
+      ts.tv_nsec = (tmr->deadline_us % 1000000) * 1000;
+      pthread_cond_timedwait(&_portTimerCond, &_portLock, &ts);
+    } else {
+      schedPortTimerCb_t callback = portTimerFire(tmr);
+      pthread_mutex_unlock(&_portLock);
+      _portInTimer = true;
+      callback(nullptr);
+      _portInTimer = false;
+      pthread_mutex_lock(&_portLock);
+    };
+  };
+  pthread_mutex_unlock(&_portLock);
+  return nullptr;
+}
+
+static void portTasksIdleWait();
+
+// Simulation mode: move the monotonic clock forward, executing all timers that become due on the way. After each timer
+// the tasks finish the work it gave them (for example the worker processes the tick), then the events are dispatched
+void schedulerPortAdvance(int64_t delta_us)
+{
+  if (!_portSimulate) return;
+  int64_t target_us = _portSimMonotonic + delta_us;
+  pthread_mutex_lock(&_portLock);
+  schedPortTimer_s* tmr;
+  while ((tmr = portTimerNext(target_us))) {
+    if (tmr->deadline_us > _portSimMonotonic) {
+      __atomic_store_n(&_portSimMonotonic, tmr->deadline_us, __ATOMIC_RELEASE);
+    };
+    schedPortTimerCb_t callback = portTimerFire(tmr);
+    pthread_mutex_unlock(&_portLock);
+    _portInTimer = true;
+    callback(nullptr);
+    _portInTimer = false;
+    portTasksIdleWait();
+    schedulerPortDispatch();
+    pthread_mutex_lock(&_portLock);
+  };
+  __atomic_store_n(&_portSimMonotonic, target_us, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&_portLock);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Tasks --------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+struct schedPortTask_s {
+  schedPortTaskFunc_t function;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t notified;
+  bool waiting;
+};
+
+static __thread schedPortTask_s* _portTaskCurrent = nullptr;
+// Tasks that are not waiting for a notification
+static pthread_mutex_t _portIdleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _portIdleCond = PTHREAD_COND_INITIALIZER;
+static uint32_t _portTasksBusy = 0;
+
+static void portTasksBusyAdd(int32_t delta)
+{
+  pthread_mutex_lock(&_portIdleLock);
+  _portTasksBusy += delta;
+  if (_portTasksBusy == 0) {
+    pthread_cond_broadcast(&_portIdleCond);
+  };
+  pthread_mutex_unlock(&_portIdleLock);
+}
+
+static void portTasksIdleWait()
+{
+  pthread_mutex_lock(&_portIdleLock);
+  while (_portTasksBusy > 0) {
+    pthread_cond_wait(&_portIdleCond, &_portIdleLock);
+  };
+  pthread_mutex_unlock(&_portIdleLock);
+}
+
+static void* portTaskThread(void* arg)
+{
+  _portTaskCurrent = (schedPortTask_s*)arg;
+  _portTaskCurrent->function(nullptr);
+  return nullptr;
+}
+
+esp_err_t schedPortTaskCreate(const char* name, schedPortTaskFunc_t function, uint32_t stack_size, uint32_t priority, int core, schedPortTask_t* task)
+{
+  if (!function || !task) return ESP_ERR_INVALID_ARG;
+  schedPortTask_s* tsk = (schedPortTask_s*)calloc(1, sizeof(schedPortTask_s));
+  if (!tsk) return ESP_ERR_NO_MEM;
+  tsk->function = function;
+  pthread_mutex_init(&tsk->lock, nullptr);
+  pthread_cond_init(&tsk->cond, nullptr);
+  *task = tsk;
+  portTasksBusyAdd(1);
+  if (pthread_create(&tsk->thread, nullptr, portTaskThread, tsk) != 0) {
+    portTasksBusyAdd(-1);
+    pthread_cond_destroy(&tsk->cond);
+    pthread_mutex_destroy(&tsk->lock);
+    free(tsk);
+    *task = nullptr;
+    return ESP_FAIL;
+  };
+  pthread_detach(tsk->thread);
+  return ESP_OK;
+}
+
+// Analogue of vTaskDelete(nullptr): must be the last call of the task function
+void schedPortTaskExit()
+{
+  schedPortTask_s* tsk = _portTaskCurrent;
+  if (tsk) {
+    _portTaskCurrent = nullptr;
+    pthread_cond_destroy(&tsk->cond);
+    pthread_mutex_destroy(&tsk->lock);
+    free(tsk);
+    portTasksBusyAdd(-1);
+  };
+}
+
+void schedPortTaskNotify(schedPortTask_t task)
+{
+  if (task) {
+    pthread_mutex_lock(&task->lock);
+    task->notified++;
+    if (task->waiting) {
+      task->waiting = false;
+      portTasksBusyAdd(1);
+    };
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+  };
+}
+
+void schedPortTaskWait()
+{
+  schedPortTask_s* tsk = _portTaskCurrent;
+  if (tsk) {
+    pthread_mutex_lock(&tsk->lock);
+    if (tsk->notified == 0) {
+      tsk->waiting = true;
+      portTasksBusyAdd(-1);
+      while (tsk->notified == 0) {
+        pthread_cond_wait(&tsk->cond, &tsk->lock);
+      };
+    };
+    tsk->notified = 0;
+    pthread_mutex_unlock(&tsk->lock);
+  };
+}
+
+void schedPortDelayMs(uint32_t ms)
+{
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000;
+  nanosleep(&ts, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Mutexes -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+struct schedPortMutex_s {
+  pthread_mutex_t lock;
+};
+
+schedPortMutex_t schedPortMutexCreate()
+{
+  schedPortMutex_s* mutex = (schedPortMutex_s*)calloc(1, sizeof(schedPortMutex_s));
+  if (mutex) {
+    pthread_mutex_init(&mutex->lock, nullptr);
+  };
+  return mutex;
+}
+
+void schedPortMutexLock(schedPortMutex_t mutex)
+{
+  if (mutex) pthread_mutex_lock(&mutex->lock);
+}
+
+void schedPortMutexUnlock(schedPortMutex_t mutex)
+{
+  if (mutex) pthread_mutex_unlock(&mutex->lock);
+}
+
+void schedPortMutexDelete(schedPortMutex_t mutex)
+{
+  if (mutex) {
+    pthread_mutex_destroy(&mutex->lock);
+    free(mutex);
+  };
+}
+
+static bool _portDeviceIdSet = false;
+static uint32_t _portDeviceId = 0;
+
+uint32_t schedPortDeviceId()
+{
+  return _portDeviceIdSet ? _portDeviceId : (uint32_t)gethostid();
+}
+
+void schedulerPortSetDeviceId(uint32_t id)
+{
+  _portDeviceId = id;
+  _portDeviceIdSet = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------- Event groups -----------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+struct schedPortEvents_s {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  uint32_t bits;
+};
+
+schedPortEvents_t schedPortEventsCreate()
+{
+  schedPortEvents_s* events = (schedPortEvents_s*)calloc(1, sizeof(schedPortEvents_s));
+  if (events) {
+    pthread_mutex_init(&events->lock, nullptr);
+    pthread_cond_init(&events->changed, nullptr);
+  };
+  return events;
+}
+
+void schedPortEventsUpdate(schedPortEvents_t events, uint32_t set, uint32_t clear)
+{
+  if (events) {
+    pthread_mutex_lock(&events->lock);
+    events->bits = (events->bits & ~clear) | set;
+    pthread_cond_broadcast(&events->changed);
+    pthread_mutex_unlock(&events->lock);
+  };
+}
+
+uint32_t schedPortEventsWait(schedPortEvents_t events, uint32_t bits, uint32_t timeout_ms)
+{
+  if (!events) return 0;
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  };
+  pthread_mutex_lock(&events->lock);
+  while (!(events->bits & bits)) {
+    if (timeout_ms == UINT32_MAX) {
+      pthread_cond_wait(&events->changed, &events->lock);
+    } else if (pthread_cond_timedwait(&events->changed, &events->lock, &deadline) != 0) {
+      break;
+    };
+  };
+  uint32_t ret = events->bits & bits;
+  pthread_mutex_unlock(&events->lock);
+  return ret;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Storage -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+#define PORT_STORE_KEYS           8
+
+typedef struct {
+  char key[16];
+  void* data;
+  size_t size;
+} portBlob_t;
+
+// Survives schedulerPortStop(), so a restart of the scheduler can be simulated
+static portBlob_t _portStore[PORT_STORE_KEYS];
+
+static portBlob_t* portStoreFind(const char* key, bool create)
+{
+  portBlob_t* empty = nullptr;
+  for (uint32_t i = 0; i < PORT_STORE_KEYS; i++) {
+    if (_portStore[i].data && (strncmp(_portStore[i].key, key, sizeof(_portStore[i].key)) == 0)) {
+      return &_portStore[i];
+    };
+    if (!empty && !_portStore[i].data) {
+      empty = &_portStore[i];
+    };
+  };
+  return create ? empty : nullptr;
+}
+
+bool schedPortStoreRead(const char* key, void* data, size_t* size)
+{
+  bool ret = false;
+  pthread_mutex_lock(&_portLock);
+  portBlob_t* blob = portStoreFind(key, false);
+  if (blob) {
+    if (!data) {
+      *size = blob->size;
+      ret = true;
+    } else if (*size >= blob->size) {
+      memcpy(data, blob->data, blob->size);
+      *size = blob->size;
+      ret = true;
+    };
+  };
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+bool schedPortStoreWrite(const char* key, const void* data, size_t size)
+{
+  void* copy = malloc(size > 0 ? size : 1);
+  if (!copy) return false;
+  memcpy(copy, data, size);
+  bool ret = false;
+  pthread_mutex_lock(&_portLock);
+  portBlob_t* blob = portStoreFind(key, true);
+  if (blob) {
+    if (blob->data) free(blob->data);
+    strncpy(blob->key, key, sizeof(blob->key) - 1);
+    blob->data = copy;
+    blob->size = size;
+    _portStats.store_writes++;
+    if (_portInTimer) _portStats.store_writes_timer++;
+    ret = true;
+  };
+  pthread_mutex_unlock(&_portLock);
+  if (!ret) free(copy);
+  return ret;
+}
+
+void schedulerPortStoreClear()
+{
+  pthread_mutex_lock(&_portLock);
+  for (uint32_t i = 0; i < PORT_STORE_KEYS; i++) {
+    if (_portStore[i].data) free(_portStore[i].data);
+  };
+  memset(_portStore, 0, sizeof(_portStore));
+  pthread_mutex_unlock(&_portLock);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// -------------------------------------------------------- Events -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+bool eventHandlerRegister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler, void* event_handler_arg)
+{
+  bool ret = false;
+  pthread_mutex_lock(&_portLock);
+  if (_portHandlersCount < PORT_EVENTS_HANDLERS_MAX) {
+    _portHandlers[_portHandlersCount].base = event_base;
+    _portHandlers[_portHandlersCount].id = event_id;
+    _portHandlers[_portHandlersCount].handler = event_handler;
+    _portHandlers[_portHandlersCount].arg = event_handler_arg;
+    _portHandlersCount++;
+    ret = true;
+  } else {
+    rlog_e(logTAG, "Too many event handlers");
+  };
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+void eventHandlerUnregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler)
+{
+  pthread_mutex_lock(&_portLock);
+  for (uint32_t i = 0; i < _portHandlersCount; i++) {
+    if ((_portHandlers[i].base == event_base) && (_portHandlers[i].id == event_id) && (_portHandlers[i].handler == event_handler)) {
+      _portHandlers[i] = _portHandlers[--_portHandlersCount];
+      break;
+    };
+  };
+  pthread_mutex_unlock(&_portLock);
+}
+
+bool eventLoopPost(esp_event_base_t event_base, int32_t event_id, void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+  void* data = nullptr;
+  if (event_data && (event_data_size > 0)) {
+    data = malloc(event_data_size);
+    if (!data) return false;
+    memcpy(data, event_data, event_data_size);
+  };
+  bool ret = false;
+  pthread_mutex_lock(&_portLock);
+  if (_portEventsCount < PORT_EVENTS_QUEUE_SIZE) {
+    portEvent_t* event = &_portEvents[(_portEventsHead + _portEventsCount) % PORT_EVENTS_QUEUE_SIZE];
+    event->base = event_base;
+    event->id = event_id;
+    event->data = data;
+    _portEventsCount++;
+    _portStats.posts++;
+    if (_portInTimer && (ticks_to_wait > 0)) _portStats.timer_waits++;
+    pthread_cond_signal(&_portEventsCond);
+    ret = true;
+  } else {
+    _portStats.post_failures++;
+  };
+  pthread_mutex_unlock(&_portLock);
+  if (!ret && data) free(data);
+  return ret;
+}
+
+// Deliver all queued events to the handlers, returns the number of events
+uint32_t schedulerPortDispatch()
+{
+  uint32_t ret = 0;
+  pthread_mutex_lock(&_portLock);
+  while (_portEventsCount > 0) {
+    portEvent_t event = _portEvents[_portEventsHead];
+    _portEventsHead = (_portEventsHead + 1) % PORT_EVENTS_QUEUE_SIZE;
+    _portEventsCount--;
+    for (uint32_t i = 0; i < _portHandlersCount; i++) {
+      if ((_portHandlers[i].base == event.base) && ((_portHandlers[i].id == ESP_EVENT_ANY_ID) || (_portHandlers[i].id == event.id))) {
+        portHandler_t handler = _portHandlers[i];
+        pthread_mutex_unlock(&_portLock);
+        handler.handler(handler.arg, event.base, event.id, event.data);
+        pthread_mutex_lock(&_portLock);
+      };
+    };
+    if (event.data) free(event.data);
+    ret++;
+  };
+  pthread_mutex_unlock(&_portLock);
+  return ret;
+}
+
+static void* portEventsThread(void* arg)
+{
+  pthread_mutex_lock(&_portLock);
+  while (_portRunning) {
+    if (_portEventsCount == 0) {
+      pthread_cond_wait(&_portEventsCond, &_portLock);
+    } else {
+      pthread_mutex_unlock(&_portLock);
+      schedulerPortDispatch();
+      pthread_mutex_lock(&_portLock);
+    };
+  };
+  pthread_mutex_unlock(&_portLock);
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------- Control -------------------------------------------------------
+// -----------------------------------------------------------------------------------------------------------------------
+
+void* esp_calloc(size_t count, size_t size)
+{
+  __atomic_add_fetch(&_portStats.allocs, 1, __ATOMIC_RELAXED);
+  return calloc(count, size);
+}
+
+void schedulerPortStats(schedulerPortStats_t* stats)
+{
+  pthread_mutex_lock(&_portLock);
+  *stats = _portStats;
+  pthread_mutex_unlock(&_portLock);
+}
+
+void schedulerPortStatsReset()
+{
+  pthread_mutex_lock(&_portLock);
+  memset(&_portStats, 0, sizeof(_portStats));
+  pthread_mutex_unlock(&_portLock);
+}
+
+// In simulation mode the clocks are advanced only by schedulerPortAdvance(), timers and events are executed
+// in the calling thread, tasks (the worker, shard helpers) run until they wait for a notification before the clock
+// moves on. Otherwise, the real monotonic clock is used and timers and events have their own threads.
+bool schedulerPortStart(bool simulate)
+{
+  if (_portRunning) return false;
+  _portSimulate = simulate;
+  _portSimMonotonic = 0;
+  _portWallBase = 0;
+  _portMonoBase = schedPortMonotonicUs();
+  if (!simulate) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    _portWallBase = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&_portTimerCond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&_portEventsCond, nullptr);
+    _portRunning = true;
+    if ((pthread_create(&_portTimerThread, nullptr, portTimerThread, nullptr) != 0)
+     || (pthread_create(&_portEventsThread, nullptr, portEventsThread, nullptr) != 0)) {
+      rlog_e(logTAG, "Failed to create host threads");
+      _portRunning = false;
+      return false;
+    };
+  } else {
+    pthread_cond_init(&_portTimerCond, nullptr);
+    pthread_cond_init(&_portEventsCond, nullptr);
+  };
+  return true;
+}
+
+void schedulerPortStop()
+{
+  if (_portRunning) {
+    pthread_mutex_lock(&_portLock);
+    _portRunning = false;
+    pthread_cond_broadcast(&_portTimerCond);
+    pthread_cond_broadcast(&_portEventsCond);
+    pthread_mutex_unlock(&_portLock);
+    pthread_join(_portTimerThread, nullptr);
+    pthread_join(_portEventsThread, nullptr);
+  };
+  pthread_cond_destroy(&_portTimerCond);
+  pthread_cond_destroy(&_portEventsCond);
+}
+
+#endif // !ESP_PLATFORM
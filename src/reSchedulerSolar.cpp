@@ -0,0 +1,52 @@
+/*
+   EN: Times of sunrise, sunset and twilight (general solar position equations of NOAA, accuracy is about a minute)
+   RU: Время восхода, заката и сумерек (общие уравнения положения Солнца NOAA, точность около минуты)
+   --------------------------
+   (с) 2021 Разживин Александр | Razzhivin Alexander
+   kotyara12@yandex.ru | https://kotyara12.ru | tg: @kotyara1971
+*/
+
+#include <math.h>
+#include "reScheduler.h"
+#include "reSchedulerPort.h"
+
+#if CONFIG_SCHEDULER_SOLAR
+
+#define SCHEDULER_SOLAR_RAD 0.0174532925f   // Radians in a degree
+
+// Zenith angles of the sun: the upper limb on the horizon (with the refraction), civil and nautical twilight
+static const float _schedulerSolarZenith[SCHEDULER_SOLAR_ARCS] = { 90.833f, 96.0f, 102.0f };
+
+// Single precision is enough here and is calculated by the FPU of ESP32
+bool schedulerSolarCalc(int year, int yday, float latitude, float longitude, schedulerSolarDay_t* day)
+{
+  int days = ((year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0))) ? 366 : 365;
+  if (!day || (yday < 0) || (yday >= days) || !(fabsf(latitude) <= 90.0f) || !(fabsf(longitude) <= 180.0f)) {
+    return false;
+  };
+
+  // Fractional year at the local noon
+  float gamma = 2.0f * (float)M_PI / days * (yday - longitude / 360.0f);
+  float eqtime = 229.18f * (0.000075f + 0.001868f * cosf(gamma) - 0.032077f * sinf(gamma)
+    - 0.014615f * cosf(2.0f * gamma) - 0.040849f * sinf(2.0f * gamma));
+  float decl = 0.006918f - 0.399912f * cosf(gamma) + 0.070257f * sinf(gamma) - 0.006758f * cosf(2.0f * gamma)
+    + 0.000907f * sinf(2.0f * gamma) - 0.002697f * cosf(3.0f * gamma) + 0.00148f * sinf(3.0f * gamma);
+  float lat = latitude * SCHEDULER_SOLAR_RAD;
+
+  day->noon = (int16_t)lroundf(720.0f - 4.0f * longitude - eqtime);
+  for (int i = 0; i < SCHEDULER_SOLAR_ARCS; i++) {
+    // Cosine of the hour angle at which the sun crosses the height
+    float ha = cosf(_schedulerSolarZenith[i] * SCHEDULER_SOLAR_RAD) / (cosf(lat) * cosf(decl)) - tanf(lat) * tanf(decl);
+    if (ha >= 1.0f) {
+      day->arc[i] = 0;
+    } else if (ha <= -1.0f) {
+      day->arc[i] = 720;
+    } else {
+      // 4 minutes per degree
+      day->arc[i] = (uint16_t)lroundf(4.0f * acosf(ha) / SCHEDULER_SOLAR_RAD);
+    };
+  };
+  return true;
+}
+
+#endif // CONFIG_SCHEDULER_SOLAR